@@ -0,0 +1,61 @@
+#!/bin/sh
+
+# 文本 IR 链路测试：(.m --emit-ir-->) .ir --cyrilcc-opt -O2--> .ir --cyrilcc-llc--> .s
+set -e
+
+if [ "$#" -ne 8 ]; then
+    echo "Usage: $0 <compiler> <opt> <llc> <asm> <machine> <m-or-ir-file> <in-file> <expected-out-file>"
+    exit 1
+fi
+
+COMPILER_PATH=$1
+OPT_PATH=$2
+LLC_PATH=$3
+ASM_PATH=$4
+MACHINE_PATH=$5
+SRC_FILE_PATH=$6
+IN_FILE_PATH=$7
+EXPECTED_OUT_FILE_PATH=$8
+
+WORK_DIR=$(mktemp -d -t cyrilcc_ir_test.XXXXXX)
+
+IR_FILE="$WORK_DIR/input.ir"
+OPT_IR_FILE="$WORK_DIR/opt.ir"
+ASM_FILE="$WORK_DIR/test_output.s"
+OBJ_FILE="$WORK_DIR/test_output.o"
+ACTUAL_RAW_OUT_FILE="$WORK_DIR/actual_raw.out"
+ACTUAL_PARSED_OUT_FILE="$WORK_DIR/actual_parsed.out"
+
+case "$SRC_FILE_PATH" in
+    *.m)
+        echo "--- Emitting IR: $SRC_FILE_PATH ---"
+        $COMPILER_PATH $SRC_FILE_PATH -O0 -emit-ir -o $IR_FILE
+        ;;
+    *)
+        cp "$SRC_FILE_PATH" $IR_FILE
+        ;;
+esac
+
+echo "--- Optimizing: $IR_FILE ---"
+$OPT_PATH $IR_FILE -O2 -o $OPT_IR_FILE
+
+echo "--- Lowering: $OPT_IR_FILE ---"
+$LLC_PATH $OPT_IR_FILE -o $ASM_FILE
+
+echo "--- Assembling: $ASM_FILE ---"
+$ASM_PATH $ASM_FILE
+
+echo "--- Running: $OBJ_FILE (Input: $IN_FILE_PATH) ---"
+$MACHINE_PATH $OBJ_FILE < "$IN_FILE_PATH" > "$ACTUAL_RAW_OUT_FILE"
+
+awk '/---/{exit} {print}' "$ACTUAL_RAW_OUT_FILE" > "$ACTUAL_PARSED_OUT_FILE"
+
+echo "--- Comparing Results ---"
+if diff -u -B "$EXPECTED_OUT_FILE_PATH" "$ACTUAL_PARSED_OUT_FILE"; then
+    echo "SUCCESS: $SRC_FILE_PATH"
+    exit 0
+else
+    echo "FAILURE: $SRC_FILE_PATH"
+    cat "$ACTUAL_RAW_OUT_FILE"
+    exit 1
+fi
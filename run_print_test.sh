@@ -0,0 +1,29 @@
+#!/bin/sh
+
+# 分析打印测试：.ir --cyrilcc-opt --passes=<print-pass>--> 标准错误，与期望的输出逐行比较
+set -e
+
+if [ "$#" -ne 4 ]; then
+    echo "Usage: $0 <opt> <ir-file> <passes> <expected-file>"
+    exit 1
+fi
+
+OPT_PATH=$1
+IR_FILE_PATH=$2
+PASSES=$3
+EXPECTED_FILE_PATH=$4
+
+WORK_DIR=$(mktemp -d -t cyrilcc_print_test.XXXXXX)
+ACTUAL_FILE="$WORK_DIR/actual.txt"
+
+echo "--- Printing: $IR_FILE_PATH (--passes=$PASSES) ---"
+$OPT_PATH "$IR_FILE_PATH" --passes="$PASSES" -o "$WORK_DIR/out.ir" 2> "$ACTUAL_FILE"
+
+echo "--- Comparing Results ---"
+if diff -u "$EXPECTED_FILE_PATH" "$ACTUAL_FILE"; then
+    echo "SUCCESS: $IR_FILE_PATH"
+    exit 0
+else
+    echo "FAILURE: $IR_FILE_PATH"
+    exit 1
+fi
@@ -0,0 +1,66 @@
+#include "stats.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// 替换全局 operator new/delete，统计分配次数与堆占用。
+// 每块内存前面放一个头部记录大小，释放时据此更新当前占用。
+
+namespace {
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+std::atomic<size_t> live_bytes{ 0 };
+std::atomic<size_t> high_water{ 0 };
+thread_local size_t thread_count = 0;
+thread_local size_t thread_bytes = 0;
+
+void *counted_alloc(size_t size) {
+    auto *raw = static_cast<unsigned char *>(std::malloc(size + HEADER));
+    if (!raw) return nullptr;
+    *reinterpret_cast<size_t *>(raw) = size;
+
+    thread_count++;
+    thread_bytes += size;
+    size_t now = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = high_water.load(std::memory_order_relaxed);
+    while (now > peak && !high_water.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+    return raw + HEADER;
+}
+
+void counted_free(void *ptr) {
+    if (!ptr) return;
+    auto *raw = static_cast<unsigned char *>(ptr) - HEADER;
+    live_bytes.fetch_sub(*reinterpret_cast<size_t *>(raw), std::memory_order_relaxed);
+    std::free(raw);
+}
+} // namespace
+
+namespace alloc_stats {
+size_t thread_alloc_count() {
+    return thread_count;
+}
+size_t thread_alloc_bytes() {
+    return thread_bytes;
+}
+size_t current_bytes() {
+    return live_bytes.load(std::memory_order_relaxed);
+}
+size_t peak_bytes() {
+    return high_water.load(std::memory_order_relaxed);
+}
+} // namespace alloc_stats
+
+void *operator new(size_t size) {
+    if (void *p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    counted_free(ptr);
+}
@@ -1,15 +1,24 @@
 #pragma once
 
 #include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dataflow_analyses.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 #include "type.hpp"
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstring>
+#include <memory>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 // --- ABI 寄存器约定 ---
 const int REG_FLAG = 0; // 标志
@@ -40,7 +49,21 @@ class AsmGenerator {
   public:
     AsmGenerator(IRModule &mod, std::ostream &out) : module(mod), os(out) {};
 
-    void generate() {
+    // 设置后记录每个函数的代码生成耗时与分配
+    void set_report(CompileReport *r) {
+        report = r;
+    }
+
+    // -print-liveness 打开时在（-print-func 选中的）函数的块标签后注释活跃信息
+    void set_trace_options(const TraceOptions &options) {
+        trace = options;
+    }
+
+    /**
+     * @brief 生成整个模块的汇编
+     * @param jobs 并行线程数；各函数生成到独立缓冲区后按原顺序拼接，输出与线程数无关
+     */
+    void generate(unsigned jobs = 1) {
         // 生成符号表
         gen_symbol();
 
@@ -54,9 +77,32 @@ class AsmGenerator {
         emit_label("EXIT");
         emit("END");
 
-        // 遍历所有函数
-        for (auto &func : module.functions) {
-            visit_function(func);
+        // 遍历所有函数，每个函数使用独立的生成器状态
+        std::vector<std::ostringstream> buffers(module.functions.size());
+        std::vector<StageRecord> records(module.functions.size());
+        ThreadPool pool(jobs);
+        pool.parallel_for(module.functions.size(), [&](size_t i) {
+            const IRFunction &func = module.functions[i];
+            StageMeter meter;
+            meter.start();
+
+            AsmGenerator func_gen{ module, buffers[i] };
+            func_gen.global_label_map = global_label_map;
+            func_gen.func_index = static_cast<int>(i);
+            func_gen.annotate_liveness = trace.print_liveness && trace.matches_func(func.name);
+            func_gen.visit_function(func);
+
+            meter.stop(records[i]);
+            records[i].stage = "codegen";
+            records[i].func = func.name;
+            records[i].has_ir = true;
+            records[i].before = records[i].after = measure_ir(func);
+        });
+        for (const auto &buf : buffers) {
+            os << buf.str();
+        }
+        if (report) {
+            for (auto &rec : records) report->add(std::move(rec));
         }
 
         // 数据段
@@ -66,6 +112,8 @@ class AsmGenerator {
   private:
     IRModule &module;
     std::ostream &os;
+    CompileReport *report = nullptr;
+    TraceOptions trace;
 
     // --- 状态量 ---
     std::unordered_map<std::string, std::string>
@@ -77,7 +125,15 @@ class AsmGenerator {
     std::unordered_map<int, std::string> reg_cache_rev;      // 物理寄存器 (R8) -> 临时变量名 (%1)
     std::unordered_set<int> dirty_regs;                      // 记录当前持有"脏"数据的寄存器
 
+    // 活跃信息：写回寄存器前先看值之后还会不会被读，死值不必写回主页
+    std::unique_ptr<InstructionLiveness<>> liveness;
+    const IRInstruction *current_inst = nullptr; // 正在生成的指令
+    const BitVector *current_live = nullptr;     // current_inst 之后的活跃集合
+    bool block_closed = false; // 上一条指令是 br / ret，下一个标签只能通过跳转到达
+    bool annotate_liveness = false; // 块标签后注释入口活跃值个数与块内最大寄存器压力
+
     int current_frame_size = 0;
+    int func_index = 0; // 用于区分不同函数生成的内部标签
     int label_counter = 0;
 
     // --- visitor ---
@@ -200,20 +256,71 @@ class AsmGenerator {
         }
 
         // 访问指令
-        for (const auto &block : func.blocks) {
+        liveness = std::make_unique<InstructionLiveness<>>(func);
+        block_closed = false;
+        for (size_t b = 0; b < func.blocks.size(); ++b) {
+            const IRBasicBlock *block = func.blocks[b].get();
+            const IRBasicBlock *next = b + 1 < func.blocks.size() ? func.blocks[b + 1].get()
+                                                                  : nullptr;
+            auto live_after = liveness->live_after(block);
+            size_t i = 0;
             for (const auto &inst : block->insts) {
-                visit_instruction(inst);
+                current_inst = &inst;
+                current_live = &live_after[i++];
+                if (inst.op == IROp::LABEL) {
+                    visit_label(inst, block, b > 0 ? func.blocks[b - 1].get() : nullptr);
+                } else if (inst.op == IROp::BR && next && falls_into(block, next) &&
+                           inst.args[0].name == next->label) {
+                    // 直接落入的唯一后继：寄存器里的值在标签处仍然有效，不必写回
+                    emit("JMP " + get_asm_label(inst.args[0]));
+                } else {
+                    visit_instruction(inst);
+                }
+                block_closed = inst.op == IROp::BR || inst.op == IROp::RET;
             }
         }
+        current_inst = nullptr;
+        current_live = nullptr;
+        liveness.reset();
+    }
+
+    // next 只能从紧挨着的 prev 末尾的 br 到达（prev 中没有条件跳转指向它）
+    static bool falls_into(const IRBasicBlock *prev, const IRBasicBlock *next) {
+        if (next->predecessors.size() != 1 || next->predecessors[0] != prev) return false;
+        return std::none_of(prev->insts.begin(), prev->insts.end(), [&](const IRInstruction &i) {
+            return i.is_cond_b() && i.args[0].name == next->label;
+        });
+    }
+
+    void visit_label(const IRInstruction &inst, const IRBasicBlock *block,
+                     const IRBasicBlock *prev) {
+        if (prev && falls_into(prev, block)) {
+            // 缓存原样保留，包括尚未写回的脏值
+        } else if (block_closed) {
+            // 只能跳转到达：上一个块末尾的寄存器内容与这里无关，已在跳转前写回
+            forget_regs();
+        } else {
+            spill_all_live_regs("Label"); // 上一个块没有终结指令，顺序执行落入
+        }
+        emit_label(get_asm_label(inst.args[0]));
+        if (!annotate_liveness) return;
+        emit("# live-in " + std::to_string(liveness->blocks().live_in(block).count()) +
+             ", max pressure " + std::to_string(liveness->max_pressure(block)));
+    }
+
+    // 寄存器中 name 的值在当前指令之后（或被当前指令自身）还会被读
+    bool is_needed(const std::string &name) const {
+        if (!current_live) return true;
+        int r = liveness->blocks().reg_index(name);
+        if (r < 0 || current_live->test(r)) return true;
+        return std::any_of(current_inst->args.begin(), current_inst->args.end(),
+                           [&](const IROperand &arg) {
+                               return arg.op_type == IROperandType::REG && arg.name == name;
+                           });
     }
 
     void visit_instruction(const IRInstruction &inst) {
         switch (inst.op) {
-            case IROp::LABEL:
-                spill_all_live_regs("Label");
-                emit_label(get_asm_label(inst.args[0]));
-                break;
-
             case IROp::RET: {
                 if (!inst.args.empty()) {
                     ensure_in_reg(inst.args[0], REG_RETVAL);
@@ -247,16 +354,17 @@ class AsmGenerator {
                 emit("TST R" + std::to_string(SCRATCH_REGS[2]));
                 break;
 
+            // 条件跳转只需写回，不跳转时后面的指令还能直接用寄存器里的值
             case IROp::BRZ:
-                spill_all_live_regs("BRZ");
+                spill_all_live_regs("BRZ", true);
                 emit("JEZ " + get_asm_label(inst.args[0]));
                 break;
             case IROp::BRLT:
-                spill_all_live_regs("BRLT");
+                spill_all_live_regs("BRLT", true);
                 emit("JLZ " + get_asm_label(inst.args[0]));
                 break;
             case IROp::BRGT:
-                spill_all_live_regs("BRGT");
+                spill_all_live_regs("BRGT", true);
                 emit("JGZ " + get_asm_label(inst.args[0]));
                 break;
 
@@ -328,6 +436,19 @@ class AsmGenerator {
                 const auto &result_op = inst.result.value();
 
                 ensure_in_reg(base_op, SCRATCH_REGS[0]);
+                // 下面会原地改写 R8：基址之后还要用就先写回，再让 R8 与它脱钩
+                if (liveness && liveness->is_last_use(inst, 0)) dirty_regs.erase(SCRATCH_REGS[0]);
+                spill_reg(SCRATCH_REGS[0], "GEP base");
+
+                // R8 += 编译期已知的字节偏移
+                auto add_const_offset = [&](int offset, const std::string &what) {
+                    if (offset == 0) return;
+                    // 汇编器不接受负的立即数，负偏移改用 SUB
+                    emit(std::string(offset < 0 ? "SUB" : "ADD") + " R" +
+                             std::to_string(SCRATCH_REGS[0]) + ", " +
+                             std::to_string(offset < 0 ? -offset : offset),
+                         "GEP: constant " + what + " offset " + std::to_string(offset));
+                };
 
                 IRType *current_type = base_op.type->get_pointee_type();
                 for (size_t i = 1; i < inst.args.size(); ++i) {
@@ -337,6 +458,9 @@ class AsmGenerator {
                         if (idx_op.op_type == IROperandType::IMM && idx_op.imm_value == 0) {
                             // 常见情况: i32 0, 无需操作
                             emit("# GEP: idx1 is 0, no base offset");
+                        } else if (idx_op.op_type == IROperandType::IMM) {
+                            // 常量下标：偏移在编译期算好，不需要 MUL
+                            add_const_offset(idx_op.imm_value * current_type->size(), "idx1");
                         } else {
                             int pointee_size = current_type->size();
                             spill_reg(SCRATCH_REGS[2], "GEP pointee size");
@@ -377,6 +501,11 @@ class AsmGenerator {
                         } else if (current_type->is_array()) {
                             IRType *element_type = current_type->get_array_element_type();
                             int element_size = element_type->size();
+                            if (idx_op.op_type == IROperandType::IMM) {
+                                add_const_offset(idx_op.imm_value * element_size, "index");
+                                current_type = element_type;
+                                continue;
+                            }
                             spill_reg(SCRATCH_REGS[2], "GEP elem size");
                             emit("LOD R" + std::to_string(SCRATCH_REGS[2]) + ", " +
                                      std::to_string(element_size),
@@ -405,6 +534,8 @@ class AsmGenerator {
                 if (src_op.op_type == IROperandType::REG && reg_cache.count(src_op.name) &&
                     !reg_cache_rev.count(SCRATCH_REGS[0])) {
                     int src_reg = reg_cache.at(src_op.name);
+                    // 源在这里最后一次使用：寄存器直接交给结果，旧值不必写回
+                    if (liveness && liveness->is_last_use(inst, 0)) dirty_regs.erase(src_reg);
                     assign_to_reg(res_op, src_reg);
                 } else {
                     ensure_in_reg(src_op, SCRATCH_REGS[0]);
@@ -467,6 +598,10 @@ class AsmGenerator {
                 emit("LOD R" + std::to_string(REG_RA) + ", " + ret_label, "Set return address");
                 emit("JMP " + get_asm_label(inst.args[0]), "Call function");
                 emit_label(ret_label);
+                // 被调函数会改写传参寄存器和压栈用的 R8，其中缓存的实参已不可信
+                size_t reg_args = std::min(inst.args.size() - 1, size_t(MAX_REGS_FOR_PARAMS));
+                for (size_t i = 0; i <= reg_args; ++i) forget_reg(REG_RETVAL + i);
+                forget_reg(SCRATCH_REGS[0]);
 
                 if (stack_arg_size > 0) {
                     emit("ADD R" + std::to_string(REG_SP) + ", " + std::to_string(stack_arg_size),
@@ -518,7 +653,7 @@ class AsmGenerator {
         os << label << ':' << std::endl;
     }
     std::string new_asm_label() {
-        return "LL" + std::to_string(label_counter++);
+        return "LL" + std::to_string(func_index) + "R" + std::to_string(label_counter++);
     }
 
     // --- core code ---
@@ -528,8 +663,8 @@ class AsmGenerator {
         if (reg_cache_rev.count(reg)) {
             std::string name_to_spill = reg_cache_rev.at(reg);
 
-            // 只有当寄存器是 Dirty 的时候，才真正写回内存
-            if (dirty_regs.count(reg)) {
+            // 只有当寄存器是 Dirty 且值之后还会被读的时候，才真正写回内存
+            if (dirty_regs.count(reg) && is_needed(name_to_spill)) {
                 if (!temp_home_map.count(name_to_spill)) {
                     throw std::runtime_error("Spill failed: No home for " + name_to_spill);
                 }
@@ -545,9 +680,9 @@ class AsmGenerator {
                          "), R" + std::to_string(reg),
                      "Spill " + name_to_spill + " (" + reason + ")");
 
-                // 写回后，寄存器变干净了（其实马上就要被擦除了，但这保持逻辑一致）
-                dirty_regs.erase(reg);
             }
+            // 写回后，寄存器变干净了（其实马上就要被擦除了，但这保持逻辑一致）
+            dirty_regs.erase(reg);
 
             reg_cache.erase(name_to_spill);
             reg_cache_rev.erase(reg);
@@ -584,6 +719,14 @@ class AsmGenerator {
         // Case 1: 立即数
         if (op.op_type == IROperandType::IMM) {
             spill_reg(target_reg, "load imm"); // 确保目标寄存器可用
+            if (op.imm_value < 0) {
+                // 汇编器不接受负的立即数：按 0 - |imm| 装入
+                emit("LOD R" + target_reg_str + ", 0", "Load immediate");
+                long long magnitude = -static_cast<long long>(op.imm_value);
+                emit("SUB R" + target_reg_str + ", " + std::to_string(magnitude),
+                     "Negate immediate");
+                return;
+            }
             emit("LOD R" + target_reg_str + ", " + std::to_string(op.imm_value), "Load immediate");
             return;
         }
@@ -687,11 +830,12 @@ class AsmGenerator {
         dirty_regs.insert(target_reg);
     }
 
-    // spill所有缓存的寄存器
-    void spill_all_live_regs(std::string reason) {
+    // 把缓存中之后还会被读的脏值写回主页；keep 为 true 时寄存器继续持有（变干净）这些值
+    void spill_all_live_regs(std::string reason, bool keep = false) {
         if (reg_cache.empty()) return;
         emit("# Spilling all regs: " + reason);
         for (auto const &[name, reg] : reg_cache) {
+            if (!dirty_regs.count(reg) || !is_needed(name)) continue;
             if (!temp_home_map.count(name)) {
                 throw std::runtime_error("Spill all failed: No home for " + name);
             }
@@ -707,8 +851,24 @@ class AsmGenerator {
                      "), R" + std::to_string(reg),
                  "Spill " + name);
         }
+        dirty_regs.clear();
+        if (!keep) forget_regs();
+    }
+
+    // 清空寄存器缓存，不写回
+    void forget_regs() {
         reg_cache.clear();
         reg_cache_rev.clear();
+        dirty_regs.clear();
+    }
+
+    // 丢弃寄存器 reg 的缓存，不写回
+    void forget_reg(int reg) {
+        auto it = reg_cache_rev.find(reg);
+        if (it == reg_cache_rev.end()) return;
+        reg_cache.erase(it->second);
+        reg_cache_rev.erase(it);
+        dirty_regs.erase(reg);
     }
 
     // 获取 IR 变量地址
@@ -2,12 +2,15 @@
 
 #include "ast.hpp"  // 包含 ast.hpp
 #include "type.hpp" // 包含 type.hpp
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <optional>
 #include <ostream>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -175,9 +178,19 @@ struct IRInstruction {
     bool is_cond_b() const {
         return op == IROp::BRZ || op == IROp::BRLT || op == IROp::BRGT;
     }
+
+    // PHI 从标签为 label 的前驱进来的值，没有这条入边时为空
+    std::optional<IROperand> incoming(const std::string &label) const {
+        for (size_t i = 0; i + 1 < args.size(); i += 2) {
+            if (args[i + 1].name == label) return args[i];
+        }
+        return std::nullopt;
+    }
 };
 
 // --- 基本块 ---
+struct LoopInfo;
+
 struct IRBasicBlock {
     std::string label;
     std::list<IRInstruction> insts;
@@ -189,7 +202,159 @@ struct IRBasicBlock {
     std::vector<IRBasicBlock *> dom_child;            // 本块在支配树中的孩子节点
     std::unordered_set<IRBasicBlock *> dom_frontiers; // 本块的支配边界
 
+    // 支配树上的 DFS 进入/离开序号（由 DominatorTreePass 计算），-1 表示未编号
+    int dom_in = -1;
+    int dom_out = -1;
+
+    // 后支配树（由 PostDominatorTreePass 计算），ipdom 为 nullptr 表示直接后支配者是虚拟出口
+    IRBasicBlock *ipdom = nullptr;
+    std::vector<IRBasicBlock *> pdom_child;
+    int pdom_in = -1;
+    int pdom_out = -1;
+
+    // 控制依赖（由 ControlDependencePass 计算）：本块依赖于哪些块末尾的分支，以及反向边
+    std::vector<IRBasicBlock *> control_deps;
+    std::vector<IRBasicBlock *> control_dependents;
+
+    // 包含本块的最内层循环（由 LoopAnalysisPass 计算），不在循环中为 nullptr
+    LoopInfo *loop = nullptr;
+
     IRBasicBlock(std::string l) : label(std::move(l)) {}
+
+    // 本块是否支配 b：b 位于本块的支配子树内时两者的 DFS 区间嵌套，O(1)。
+    // 支配树计算之后新建的块（例如 LICM 的预头块）没有编号，退回沿 idom 链查找
+    bool dominates(const IRBasicBlock *b) const {
+        if (this == b) return true;
+        if (dom_in >= 0 && b->dom_in >= 0) return dom_in <= b->dom_in && b->dom_out <= dom_out;
+        for (const IRBasicBlock *d = b->idom; d; d = d->idom) {
+            if (d == this) return true;
+        }
+        return false;
+    }
+
+    // 本块是否后支配 b（从 b 出发的每条到出口的路径都经过本块），O(1)
+    bool post_dominates(const IRBasicBlock *b) const {
+        if (this == b) return true;
+        if (pdom_in >= 0 && b->pdom_in >= 0) {
+            return pdom_in <= b->pdom_in && b->pdom_out <= pdom_out;
+        }
+        for (const IRBasicBlock *d = b->ipdom; d; d = d->ipdom) {
+            if (d == this) return true;
+        }
+        return false;
+    }
+
+    // 块末尾 test / 分支 / ret 的起始位置：要在块末尾执行的新指令插在它之前
+    std::list<IRInstruction>::iterator branch_begin() {
+        auto it = std::find_if(insts.begin(), insts.end(), [](const IRInstruction &inst) {
+            return inst.op == IROp::BR || inst.op == IROp::RET || inst.is_cond_b();
+        });
+        if (it != insts.begin() && std::prev(it)->op == IROp::TEST) --it;
+        return it;
+    }
+
+    // 原地把 PHI 折叠成 move 之后，把剩下的 PHI 挪回块首（标签之后），其余指令保持原顺序
+    // 用 splice 移动节点，指向指令的指针保持有效
+    void hoist_phis() {
+        auto pos = insts.begin();
+        if (pos != insts.end() && pos->op == IROp::LABEL) ++pos;
+        for (auto it = pos; it != insts.end();) {
+            auto next = std::next(it);
+            if (it->op == IROp::PHI) {
+                if (it == pos) {
+                    ++pos;
+                } else {
+                    insts.splice(pos, insts, it);
+                }
+            }
+            it = next;
+        }
+    }
+};
+
+// --- 自然循环（由 LoopAnalysisPass 计算）---
+// 同一个循环头的多条回边合并为一个循环；blocks 包含子循环的块
+struct LoopInfo {
+    IRBasicBlock *header;                       // 循环头
+    std::unordered_set<IRBasicBlock *> blocks;  // 循环体中的所有块
+    std::vector<IRBasicBlock *> latches;        // 回边的源块（按块布局顺序，下同）
+    std::vector<IRBasicBlock *> exiting_blocks; // 有后继在循环外的块
+    std::vector<IRBasicBlock *> exit_blocks;    // 循环外的后继（不重复）
+    IRBasicBlock *preheader = nullptr; // 预头块：循环外唯一前驱且只跳到循环头，没有时为 nullptr
+    LoopInfo *parent = nullptr;        // 父循环
+    std::vector<LoopInfo *> sub_loops; // 子循环
+    unsigned depth = 1;                // 嵌套深度，最外层为 1
+
+    // 常量迭代次数（由归纳变量和退出条件推出），未知为 -1。
+    // trip_count 是循环体执行的次数，backedge_taken_count 是回边被执行的次数：
+    // 在循环头判断退出（for/while）时两者相等，在回边块判断退出（do-while 形式）时前者多 1
+    long trip_count = -1;
+    long backedge_taken_count = -1;
+
+    LoopInfo(IRBasicBlock *h) : header(h) {}
+
+    bool contains(const IRBasicBlock *b) const {
+        return blocks.contains(const_cast<IRBasicBlock *>(b));
+    }
+
+    // 每个退出块的前驱都在循环内
+    bool has_dedicated_exits() const {
+        for (IRBasicBlock *exit : exit_blocks) {
+            for (IRBasicBlock *pred : exit->predecessors) {
+                if (!contains(pred)) return false;
+            }
+        }
+        return true;
+    }
+
+    IRBasicBlock *single_latch() const {
+        return latches.size() == 1 ? latches.front() : nullptr;
+    }
+};
+
+// --- 函数副作用摘要（由 CallGraphPass 自底向上计算，已包含所有被调函数的效果）---
+// 内存效果用 PointsToPass 的指向等价类表示，同时展开成按全局变量和参数下标的形式
+struct FunctionSummary {
+    std::set<std::string> reads_globals, writes_globals;
+    std::set<unsigned> reads_args, writes_args;         // 经由第 i 个指针参数读 / 写
+    std::set<int> read_classes, write_classes;          // 读 / 写的对象所在的指向等价类
+    bool reads_unknown = false, writes_unknown = false; // 经由没有指向信息的指针读 / 写
+    bool does_input = false, does_output = false;
+    bool always_returns = false;        // CFG 无环、不在递归环上，且被调函数都总会返回
+    std::optional<int> return_constant; // 每条 ret 都返回同一个常量
+
+    bool may_read() const {
+        return reads_unknown || !read_classes.empty();
+    }
+    bool may_write() const {
+        return writes_unknown || !write_classes.empty();
+    }
+    bool does_io() const {
+        return does_input || does_output;
+    }
+    // 不读写内存、没有 I/O 且总会返回：参数相同的两次调用结果相同，结果不用时可以删掉
+    bool is_pure() const {
+        return !may_read() && !may_write() && !does_io() && always_returns;
+    }
+};
+
+// --- 调用图（由 CallGraphPass 计算，模块中的函数共享同一份）---
+struct CallGraphNode {
+    std::vector<std::string> callees; // 不重复，按首次出现的顺序
+    std::vector<std::string> callers;
+    size_t scc = 0;         // 所在强连通分量在 CallGraph::sccs 中的下标
+    bool recursive = false; // 处在调用环上（包括直接调用自己）
+    FunctionSummary summary;
+};
+
+struct CallGraph {
+    std::unordered_map<std::string, CallGraphNode> nodes; // 函数名 -> 结点
+    std::vector<std::vector<std::string>> sccs; // 自底向上：被调函数所在的分量排在前面
+
+    const FunctionSummary *summary(const std::string &fn) const {
+        auto it = nodes.find(fn);
+        return it == nodes.end() ? nullptr : &it->second.summary;
+    }
 };
 
 // --- 函数定义 ---
@@ -206,9 +371,49 @@ struct IRFunction {
     std::unordered_map<IRInstruction *, std::vector<IRInstruction *>>
         def_use_chain; // 定义指令到使用指令列表的映射
 
+    // 循环嵌套森林（由 LoopAnalysisPass 计算）：loops 按先序排列，外层循环在前
+    std::vector<std::unique_ptr<LoopInfo>> loops;
+    std::vector<LoopInfo *> top_level_loops;
+
+    // 指针值所指对象的等价类（由 PointsToPass 在模块级计算）：寄存器 / 全局变量名 -> 类编号。
+    // 编号不同的两个指针不会指向同一对象；表中没有的名字（例如之后新建的寄存器）没有信息
+    std::unordered_map<std::string, int> points_to_class;
+
+    // 模块的调用图与副作用摘要（由 CallGraphPass 计算），没有计算时为空
+    std::shared_ptr<const CallGraph> call_graph;
+
+    // 复制循环之后函数最多占用的汇编标签数（由 LabelBudgetPass 在模块级分配），-1 表示不限
+    int label_budget = -1;
+
     int vreg_cnt = 0;
     IRFunction(std::string n, IRType *rt) : name(std::move(n)), ret_type(rt) {}
 
+    // 丢弃循环信息（删除基本块后其中的指针会悬空）
+    void clear_loops() {
+        loops.clear();
+        top_level_loops.clear();
+        for (auto &block : blocks) block->loop = nullptr;
+    }
+
+    // 丢弃支配树、后支配树、支配边界与控制依赖（删除基本块后其中的指针会悬空）
+    void clear_dominators() {
+        for (auto &block : blocks) {
+            block->idom = block->ipdom = nullptr;
+            block->dom_child.clear();
+            block->pdom_child.clear();
+            block->dom_frontiers.clear();
+            block->control_deps.clear();
+            block->control_dependents.clear();
+            block->dom_in = block->dom_out = block->pdom_in = block->pdom_out = -1;
+        }
+    }
+
+    // CALL 指令所调函数的摘要；没有调用图或被调函数不在模块中时为 nullptr
+    const FunctionSummary *callee_summary(const IRInstruction &call) const {
+        if (!call_graph || call.op != IROp::CALL) return nullptr;
+        return call_graph->summary(call.args[0].name);
+    }
+
     IROperand new_reg(IRType *type) {
         return IROperand::create_reg("%" + std::to_string(vreg_cnt++), type);
     }
@@ -285,6 +490,16 @@ struct IRFunction {
                 }
             }
             os << "\n";
+
+            const LoopInfo *loop = b.get()->loop;
+            if (loop && loop->header == b.get()) {
+                os << " ; Loop Header: depth " << loop->depth << ", latches:";
+                for (const IRBasicBlock *latch : loop->latches) os << " " << latch->label;
+                os << ", exits:";
+                for (const IRBasicBlock *exit : loop->exit_blocks) os << " " << exit->label;
+                if (loop->trip_count >= 0) os << ", trip count " << loop->trip_count;
+                os << "\n";
+            }
         }
         os << "}\n\n";
     }
@@ -303,6 +518,8 @@ struct IRGlobalVar {
                 s += "\\n";
             else if (c == '\t')
                 s += "\\t";
+            else if (c == '"' || c == '\\')
+                s += std::string("\\") + c;
             else
                 s += c;
         }
@@ -317,6 +534,21 @@ struct IRModule {
     std::unordered_map<std::string, IROperand> global_symbols;
 
     void dump(std::ostream &os) const {
+        auto structs = IRType::get_structs();
+        if (!structs.empty()) {
+            os << "; --- Struct Types ---\n";
+            for (auto *st : structs) {
+                os << st->to_string() << " = type {";
+                const auto &fields = st->get_fields();
+                for (size_t i = 0; i < fields.size(); ++i) {
+                    os << (i ? ", " : " ") << fields[i].type->to_string() << " "
+                       << fields[i].name;
+                }
+                os << " }\n";
+            }
+            os << "\n";
+        }
+
         os << "; --- Global Variables ---\n";
         for (const auto &g : globals) {
             os << g.name << " = global " << g.type->to_string();
@@ -643,7 +875,7 @@ class IRGenerator {
         }
     }
 
-    void visit(StructDefinitionNode *_) {}
+    void visit(StructDefinitionNode *) {}
 
     void visit(IfStatementNode *node) {
         std::string true_l = new_label("iftrue");
@@ -766,9 +998,9 @@ class IRGenerator {
         loop_stack.pop_back(); // 移除 'break' 目标
     }
 
-    void visit(CaseStatementNode *_) {}
+    void visit(CaseStatementNode *) {}
 
-    void visit(DefaultStatementNode *_) {}
+    void visit(DefaultStatementNode *) {}
 
     void visit(CaseBlockStatementNode *node) {
         for (auto &s : node->body->nodes) dispatch(s.get());
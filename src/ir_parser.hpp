@@ -0,0 +1,342 @@
+// ir_parser.hpp
+#pragma once
+
+#include "ir.hpp"
+#include "type.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 文本 IR 解析器：读回 IRModule::dump 的输出（格式见 docs/IR_format.md）。
+// 以 ';' 开头的行是注释（包括 dump 附带的 CFG / 支配树信息），解析时忽略，
+// CFG 等分析结果需要重新运行对应的 Pass 计算。
+class IRParser {
+  private:
+    IRModule module;
+    IRFunction *cur_func = nullptr;
+    IRBasicBlock *cur_block = nullptr;
+    int max_reg = -1; // 当前函数中出现过的最大 %N，用于恢复 vreg_cnt
+
+    // 当前行与游标
+    size_t line_no = 0;
+    std::string line;
+    size_t pos = 0;
+
+    [[noreturn]] void error(const std::string &msg) const {
+        throw std::runtime_error("IR parse error at line " + std::to_string(line_no) + ", column " +
+                                 std::to_string(pos + 1) + ": " + msg);
+    }
+
+    static bool is_ident_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '%' ||
+               c == '@' || c == '-';
+    }
+
+    void skip_space() {
+        while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) pos++;
+    }
+
+    bool at_end() {
+        skip_space();
+        return pos >= line.size();
+    }
+
+    bool consume(char c) {
+        skip_space();
+        if (pos < line.size() && line[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) error(std::string("expected '") + c + "'");
+    }
+
+    std::string peek_word() {
+        skip_space();
+        size_t end = pos;
+        while (end < line.size() && is_ident_char(line[end])) end++;
+        return line.substr(pos, end - pos);
+    }
+
+    std::string read_word() {
+        std::string word = peek_word();
+        if (word.empty()) error("expected an identifier");
+        pos += word.size();
+        return word;
+    }
+
+    void expect_word(const std::string &word) {
+        if (read_word() != word) error("expected '" + word + "'");
+    }
+
+    // type := ( i1 | i8 | i32 | void | struct NAME | '[' N x type ']' ) '*'*
+    IRType *parse_type() {
+        IRType *type = nullptr;
+        if (consume('[')) {
+            std::string n = read_word();
+            if (n.empty() || !std::all_of(n.begin(), n.end(), ::isdigit)) {
+                error("expected array size");
+            }
+            expect_word("x");
+            IRType *elem = parse_type();
+            expect(']');
+            type = IRType::get_array(elem, std::stoul(n));
+        } else {
+            std::string word = read_word();
+            if (word == "i32") {
+                type = IRType::get_i32();
+            } else if (word == "i8") {
+                type = IRType::get_i8();
+            } else if (word == "i1") {
+                type = IRType::get_i1();
+            } else if (word == "void") {
+                type = IRType::get_void();
+            } else if (word == "struct") {
+                std::string name = read_word();
+                try {
+                    type = IRType::get_struct(name);
+                } catch (const std::runtime_error &) {
+                    error("undefined struct '" + name + "'");
+                }
+            } else {
+                error("unknown type '" + word + "'");
+            }
+        }
+        while (consume('*')) type = IRType::get_pointer(type);
+        return type;
+    }
+
+    void note_reg(const std::string &name) {
+        if (name.size() < 2) return;
+        auto digits = name.substr(1);
+        if (!std::all_of(digits.begin(), digits.end(), ::isdigit)) return;
+        max_reg = std::max(max_reg, std::stoi(digits));
+    }
+
+    // 不带类型的值：%reg / @global / 整数 / 标签
+    IROperand parse_value(IRType *type) {
+        std::string word = read_word();
+        if (word[0] == '%') {
+            note_reg(word);
+            return IROperand::create_reg(word, type);
+        }
+        if (word[0] == '@') return IROperand::create_global(word, type);
+        if (std::isdigit(static_cast<unsigned char>(word[0])) || word[0] == '-') {
+            try {
+                return IROperand::create_imm(std::stoi(word), type);
+            } catch (const std::exception &) {
+                error("invalid integer '" + word + "'");
+            }
+        }
+        return IROperand::create_label(word);
+    }
+
+    // 指令操作数：值后面跟类型，例如 "%3 i32"、"@g i32*"、"L1 void"
+    IROperand parse_operand() {
+        size_t start = pos;
+        std::string word = peek_word();
+        pos += word.size();
+        IRType *type = parse_type();
+        size_t end = pos;
+        pos = start;
+        IROperand op = parse_value(type);
+        pos = end;
+        return op;
+    }
+
+    static IROp parse_op(const std::string &name, bool &ok) {
+        static const std::unordered_map<std::string, IROp> ops = [] {
+            std::unordered_map<std::string, IROp> m;
+            for (IROp op : { IROp::RET, IROp::BR, IROp::BRZ, IROp::BRLT, IROp::BRGT, IROp::TEST,
+                             IROp::ALLOCA, IROp::LOAD, IROp::STORE, IROp::GEP, IROp::ADD,
+                             IROp::SUB, IROp::MUL, IROp::DIV, IROp::CALL, IROp::INPUT_I32,
+                             IROp::INPUT_I8, IROp::OUTPUT_I32, IROp::OUTPUT_I8, IROp::OUTPUT_STR,
+                             IROp::PHI, IROp::MOVE }) {
+                m[op_to_string(op)] = op;
+            }
+            return m;
+        }();
+        auto it = ops.find(name);
+        ok = it != ops.end();
+        return ok ? it->second : IROp::LABEL;
+    }
+
+    // struct NAME = type { T field, ... }
+    void parse_struct() {
+        expect_word("struct");
+        std::string name = read_word();
+        expect('=');
+        expect_word("type");
+        expect('{');
+        std::vector<StructField> fields;
+        if (!consume('}')) {
+            do {
+                IRType *type = parse_type();
+                fields.push_back({ read_word(), type, 0 });
+            } while (consume(','));
+            expect('}');
+        }
+        IRType *st = IRType::register_struct(name, fields);
+        // 同名结构体已注册（例如同一进程内先编译过源文件）时，字段必须一致
+        const auto &existing = st->get_fields();
+        bool same = existing.size() == fields.size();
+        for (size_t i = 0; same && i < fields.size(); ++i) {
+            same = existing[i].name == fields[i].name && existing[i].type == fields[i].type;
+        }
+        if (!same) error("conflicting definition of struct '" + name + "'");
+    }
+
+    // @name = global TYPE ["string"]
+    void parse_global() {
+        std::string name = read_word();
+        expect('=');
+        expect_word("global");
+        IRGlobalVar g(name, parse_type());
+        skip_space();
+        if (pos < line.size() && line[pos] == '"') {
+            size_t close = line.rfind('"');
+            if (close == pos) error("unterminated string");
+            for (size_t i = pos + 1; i < close; ++i) {
+                char c = line[i];
+                if (c == '\\' && i + 1 < close) {
+                    char e = line[++i];
+                    c = e == 'n' ? '\n' : e == 't' ? '\t' : e;
+                }
+                g.init_str += c;
+            }
+            pos = close + 1;
+        }
+        if (!at_end()) error("unexpected trailing characters");
+        // 字符串常量的符号类型就是 i8*，普通全局变量的符号是指向它的指针
+        IRType *sym_type = g.init_str.empty() ? IRType::get_pointer(g.type) : g.type;
+        module.global_symbols[name.substr(1)] = IROperand::create_global(name, sym_type);
+        module.globals.push_back(std::move(g));
+    }
+
+    // define RET @name(T %a, T %b) {
+    void parse_define() {
+        expect_word("define");
+        IRType *ret = parse_type();
+        std::string name = read_word();
+        if (name[0] != '@') error("function name must start with '@'");
+        module.functions.emplace_back(name, ret);
+        cur_func = &module.functions.back();
+        cur_block = nullptr;
+        max_reg = -1;
+        module.global_symbols[name.substr(1)] = IROperand::create_global(name, ret);
+
+        expect('(');
+        if (!consume(')')) {
+            do {
+                IRType *type = parse_type();
+                std::string reg = read_word();
+                if (reg[0] != '%') error("parameter must be a register");
+                note_reg(reg);
+                cur_func->params.push_back(IROperand::create_reg(reg, type));
+            } while (consume(','));
+            expect(')');
+        }
+        expect('{');
+    }
+
+    void finish_function() {
+        if (cur_func->blocks.empty()) error("function " + cur_func->name + " has no blocks");
+        cur_func->vreg_cnt = max_reg + 1;
+        cur_func = nullptr;
+        cur_block = nullptr;
+    }
+
+    void parse_instruction() {
+        std::optional<IROperand> result;
+        skip_space();
+        if (line[pos] == '%') {
+            std::string reg = read_word();
+            note_reg(reg);
+            result = IROperand::create_reg(reg, parse_type());
+            expect('=');
+        }
+
+        bool ok = false;
+        std::string op_name = read_word();
+        IROp op = parse_op(op_name, ok);
+        if (!ok) error("unknown instruction '" + op_name + "'");
+        if (!cur_block) error("instruction outside of a basic block");
+
+        std::vector<IROperand> args;
+        if (op == IROp::PHI) {
+            // phi [ v, L ], [ v, L ]：入边值与结果同类型
+            if (!result) error("phi without a result");
+            do {
+                expect('[');
+                args.push_back(parse_value(result->type));
+                expect(',');
+                args.push_back(IROperand::create_label(read_word()));
+                expect(']');
+            } while (consume(','));
+        } else {
+            while (!at_end()) args.push_back(parse_operand());
+        }
+        cur_block->insts.emplace_back(op, std::move(args), std::move(result));
+    }
+
+    void parse_line() {
+        pos = 0;
+        if (at_end() || line[pos] == ';') return;
+
+        if (!cur_func) {
+            if (line[pos] == '@') {
+                parse_global();
+            } else if (peek_word() == "struct") {
+                parse_struct();
+            } else if (peek_word() == "define") {
+                parse_define();
+            } else {
+                error("expected a struct, global or function definition");
+            }
+            return;
+        }
+
+        if (line[pos] == '}') {
+            finish_function();
+            return;
+        }
+
+        // 基本块标签 "name:"
+        std::string word = peek_word();
+        size_t after = pos + word.size();
+        if (!word.empty() && word[0] != '%' && after < line.size() && line[after] == ':') {
+            cur_func->blocks.push_back(std::make_unique<IRBasicBlock>(word));
+            cur_block = cur_func->blocks.back().get();
+            cur_block->insts.emplace_back(IROp::LABEL,
+                                          std::vector{ IROperand::create_label(word) });
+            return;
+        }
+
+        parse_instruction();
+    }
+
+  public:
+    /**
+     * @brief 解析整个文本 IR 模块
+     * @throws std::runtime_error 带行号的语法错误
+     */
+    static IRModule parse(std::istream &in) {
+        IRParser parser;
+        while (std::getline(in, parser.line)) {
+            parser.line_no++;
+            parser.parse_line();
+        }
+        if (parser.cur_func) parser.error("missing '}' at end of function");
+        return std::move(parser.module);
+    }
+};
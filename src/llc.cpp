@@ -0,0 +1,67 @@
+// cyrilcc-llc: 读入文本 IR，消去 PHI 后生成汇编
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "asm_gen.hpp"
+#include "ir.hpp"
+#include "ir_parser.hpp"
+#include "pass.hpp"
+#include "pass_registry.hpp"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <input.ir> -o <output.s> [-j N]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *input_path = nullptr;
+    const char *asm_output_path = nullptr;
+    unsigned jobs = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            asm_output_path = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.starts_with("-j") && arg.size() > 2) {
+            jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else if (!arg.starts_with("-") && !input_path) {
+            input_path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!input_path || !asm_output_path) usage(argv[0]);
+
+    std::ifstream in(input_path);
+    if (!in.is_open()) {
+        fprintf(stderr, "Error: open file %s failed\n", input_path);
+        exit(1);
+    }
+
+    IRModule module;
+    try {
+        module = IRParser::parse(in);
+    } catch (const std::runtime_error &e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        exit(1);
+    }
+
+    // 空流水线只包含代码生成前必需的 Pass（dessa 及其依赖）
+    PassManager pm;
+    pm.addPipeline(PassRegistry::instance().parse(""));
+    pm.run(module, jobs);
+
+    std::ofstream asm_file_stream(asm_output_path);
+    if (!asm_file_stream.is_open()) {
+        fprintf(stderr, "Error: failed to open output file %s\n", asm_output_path);
+        exit(1);
+    }
+    AsmGenerator asm_gen{ module, asm_file_stream };
+    asm_gen.generate(jobs);
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 #include "asm_gen.hpp"
@@ -10,23 +11,95 @@
 #include "lexer.h"
 #include "parser.h"
 #include "pass.hpp"
-#include "pass/GVNPass.hpp"
-#include "pass/deSSA.hpp"
-#include "pass/dom_analysis.hpp"
-#include "pass/licm.hpp"
-#include "pass/mem2reg.hpp"
-#include "pass/sccp.hpp"
+#include "pass_registry.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s <input.m> -o <output.s> [-O0|-O1|-O2|-O3] [-j N]\n"
+            "  optimization options:\n"
+            "    -O<n>                   optimization level, default -O2\n"
+            "    --passes=<pipeline>     run a custom pipeline, e.g. \"mem2reg,sccp,(licm,sccp)*\"\n"
+            "    -print-passes           list registered passes and level pipelines\n"
+            "    -emit-ir                write the optimized IR to -o instead of assembly\n"
+            "  trace options (silent by default, written to stderr or -trace-file):\n"
+            "    -print-ast              print the AST\n"
+            "    -print-ir               print the final IR\n"
+            "    -trace-passes           log every pass execution\n"
+            "    -print-after=<p1,p2>    dump the function after the named passes\n"
+            "    -print-after-all        dump the function after every pass\n"
+            "    -print-changed          dump the function only when a pass changed it\n"
+            "    -print-func=<f1,f2>     restrict dumps to the named functions\n"
+            "    -print-liveness         annotate assembly labels with live-in count and pressure\n"
+            "    -trace-file=<path>      write trace output to <path>\n"
+            "  report options:\n"
+            "    -ftime-report           per-stage time / allocation / IR size table\n"
+            "    -stats                  pass-specific counters\n"
+            "    -report-json=<path>     per-stage, per-function report as JSON\n",
+            prog);
+    exit(1);
+}
 
 int main(int argc, char *argv[]) {
     const char *input_path = nullptr;
     const char *asm_output_path = nullptr;
-
-    // cyrilcc input.m -o output.s
-    if (argc == 4 && std::string(argv[2]) == "-o") {
-        input_path = argv[1];
-        asm_output_path = argv[3];
-    } else {
-        fprintf(stderr, "Usage: %s <input.m> -o <output.s>\n", argv[0]);
+    unsigned jobs = 1; // -j N: 并行优化/代码生成的线程数，0 表示全部核心
+    TraceOptions trace;
+    std::ofstream trace_file;
+    bool time_report = false;
+    bool print_stats = false;
+    std::string report_json_path;
+    std::string pipeline_text = PassRegistry::level_pipeline(2);
+    bool emit_ir = false; // -emit-ir: 输出文本 IR（可交给 cyrilcc-opt / cyrilcc-llc）
+
+    // cyrilcc input.m -o output.s [-j N]
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            asm_output_path = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.starts_with("-j") && arg.size() > 2) {
+            jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else if (arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' && arg[2] <= '3') {
+            pipeline_text = PassRegistry::level_pipeline(arg[2] - '0');
+        } else if (arg.starts_with("--passes=")) {
+            pipeline_text = arg.substr(std::string("--passes=").size());
+        } else if (arg == "-emit-ir") {
+            emit_ir = true;
+        } else if (arg == "-print-passes") {
+            PassRegistry::instance().print(std::cout);
+            return 0;
+        } else if (arg == "-ftime-report") {
+            time_report = true;
+        } else if (arg == "-stats") {
+            print_stats = true;
+        } else if (arg.starts_with("-report-json=")) {
+            report_json_path = arg.substr(std::string("-report-json=").size());
+        } else if (trace.parse_arg(arg)) {
+            continue;
+        } else if (arg.starts_with("-trace-file=")) {
+            trace_file.open(arg.substr(std::string("-trace-file=").size()));
+            if (!trace_file.is_open()) {
+                fprintf(stderr, "Error: failed to open trace file %s\n", arg.c_str());
+                exit(1);
+            }
+            trace.os = &trace_file;
+        } else if (!arg.starts_with("-") && !input_path) {
+            input_path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!input_path || !asm_output_path) usage(argv[0]);
+
+    // 先解析流水线，拼写错误在读取源文件之前报告
+    std::vector<PassPipelineEntry> pipeline;
+    try {
+        pipeline = PassRegistry::instance().parse(pipeline_text, !emit_ir);
+    } catch (const std::runtime_error &e) {
+        fprintf(stderr, "Error: %s\n", e.what());
         exit(1);
     }
 
@@ -35,45 +108,44 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
+    CompileReport report;
+    const bool want_report = time_report || print_stats || !report_json_path.empty();
+    StageMeter meter;
+
     // 调用解析器 生成AST到root
+    StageRecord parse_rec{ .stage = "parse" };
+    meter.start();
     yyparse();
+    meter.stop(parse_rec);
+    report.add(std::move(parse_rec));
 
     if (root) {
-        root->print(std::cout);
+        if (trace.print_ast) root->print(*trace.os);
 
+        StageRecord irgen_rec{ .stage = "irgen", .has_ir = true };
+        meter.start();
         IRGenerator ir{ root };
+        meter.stop(irgen_rec);
+        for (const auto &F : ir.module.functions) {
+            IRSize size = measure_ir(F);
+            irgen_rec.after.insts += size.insts;
+            irgen_rec.after.blocks += size.blocks;
+            irgen_rec.after.phis += size.phis;
+        }
+        report.add(std::move(irgen_rec));
 
         PassManager pm;
-        pm.addFunctionPass(new BuildCFGPass());
-        pm.addFunctionPass(new DeadBlockEliminationPass());
-        pm.addFunctionPass(new DominatorTreePass());
-        pm.addFunctionPass(new DominanceFrontierPass());
-        pm.addFunctionPass(new DataFlowAnalysisPass());
-
-        pm.addFunctionPass(new Mem2RegPhiInsertionPass());
-        pm.addFunctionPass(new DataFlowAnalysisPass());
-
-        pm.addFunctionPass(new SCCPPass());
-        // pm.addFunctionPass(new GVNPass());
-
-        pm.addFunctionPass(new LICMPass());
-        pm.addFunctionPass(new DataFlowAnalysisPass());
-        pm.addFunctionPass(new SCCPPass());
-        // pm.addFunctionPass(new GVNPass());
+        pm.setTraceOptions(trace);
+        if (want_report) pm.setReport(&report);
+        pm.addPipeline(std::move(pipeline));
+        // 指向分析、调用图和标签预算需要看到整个模块，在函数级流水线之前计算
+        pm.addModulePass(new PointsToPass());
+        pm.addModulePass(new CallGraphPass());
+        pm.addModulePass(new LabelBudgetPass());
 
-        pm.addFunctionPass(new LICMPass());
-        pm.addFunctionPass(new DataFlowAnalysisPass());
-        pm.addFunctionPass(new SCCPPass());
-        // pm.addFunctionPass(new GVNPass());
+        pm.run(ir.module, jobs);
 
-        pm.addFunctionPass(new LICMPass());
-        pm.addFunctionPass(new DataFlowAnalysisPass());
-
-        pm.addFunctionPass(new DeSSAPass());
-
-        pm.run(ir.module);
-
-        ir.module.dump(std::cout);
+        if (trace.print_ir) ir.module.dump(*trace.os);
 
         std::ofstream asm_file_stream(asm_output_path);
 
@@ -82,8 +154,25 @@ int main(int argc, char *argv[]) {
             exit(1);
         }
 
-        AsmGenerator asm_gen{ ir.module, asm_file_stream };
-        asm_gen.generate();
+        if (emit_ir) {
+            ir.module.dump(asm_file_stream);
+        } else {
+            AsmGenerator asm_gen{ ir.module, asm_file_stream };
+            if (want_report) asm_gen.set_report(&report);
+            asm_gen.set_trace_options(trace);
+            asm_gen.generate(jobs);
+        }
+    }
+
+    if (time_report) report.print_time_report(*trace.os);
+    if (print_stats) report.print_stats(*trace.os);
+    if (!report_json_path.empty()) {
+        std::ofstream json(report_json_path);
+        if (!json.is_open()) {
+            fprintf(stderr, "Error: failed to open report file %s\n", report_json_path.c_str());
+            exit(1);
+        }
+        report.print_json(json);
     }
 
     fclose(yyin);
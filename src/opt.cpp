@@ -0,0 +1,110 @@
+// cyrilcc-opt: 读入文本 IR，运行指定的 Pass 流水线，输出优化后的文本 IR
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "ir.hpp"
+#include "ir_parser.hpp"
+#include "pass.hpp"
+#include "pass_registry.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s <input.ir> [-o <output.ir>] [-O0|-O1|-O2|-O3 | --passes=<pipeline>] "
+            "[-j N]\n"
+            "  Runs the pipeline (empty by default) and prints the resulting IR to stdout or -o.\n"
+            "  -print-passes, the trace options and -ftime-report / -stats are the same as "
+            "cyrilcc.\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+    unsigned jobs = 1;
+    std::string pipeline_text;
+    TraceOptions trace;
+    bool time_report = false;
+    bool print_stats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.starts_with("-j") && arg.size() > 2) {
+            jobs = static_cast<unsigned>(std::stoul(arg.substr(2)));
+        } else if (arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' && arg[2] <= '3') {
+            pipeline_text = PassRegistry::level_pipeline(arg[2] - '0');
+        } else if (arg.starts_with("--passes=")) {
+            pipeline_text = arg.substr(std::string("--passes=").size());
+        } else if (arg == "-print-passes") {
+            PassRegistry::instance().print(std::cout);
+            return 0;
+        } else if (arg == "-ftime-report") {
+            time_report = true;
+        } else if (arg == "-stats") {
+            print_stats = true;
+        } else if (trace.parse_arg(arg)) {
+            continue;
+        } else if (!arg.starts_with("-") && !input_path) {
+            input_path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!input_path) usage(argv[0]);
+
+    std::ifstream in(input_path);
+    if (!in.is_open()) {
+        fprintf(stderr, "Error: open file %s failed\n", input_path);
+        exit(1);
+    }
+
+    CompileReport report;
+    IRModule module;
+    PassManager pm;
+    try {
+        StageRecord parse_rec{ .stage = "parse-ir" };
+        StageMeter meter;
+        meter.start();
+        module = IRParser::parse(in);
+        meter.stop(parse_rec);
+        report.add(std::move(parse_rec));
+
+        pm.addPipeline(PassRegistry::instance().parse(pipeline_text, false));
+    } catch (const std::runtime_error &e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        exit(1);
+    }
+
+    pm.setTraceOptions(trace);
+    // 指向分析、调用图和标签预算需要看到整个模块，在函数级流水线之前计算
+    pm.addModulePass(new PointsToPass());
+    pm.addModulePass(new CallGraphPass());
+    pm.addModulePass(new LabelBudgetPass());
+    if (time_report || print_stats) pm.setReport(&report);
+    pm.run(module, jobs);
+
+    if (output_path) {
+        std::ofstream out(output_path);
+        if (!out.is_open()) {
+            fprintf(stderr, "Error: failed to open output file %s\n", output_path);
+            exit(1);
+        }
+        module.dump(out);
+    } else {
+        module.dump(std::cout);
+    }
+
+    if (time_report) report.print_time_report(*trace.os);
+    if (print_stats) report.print_stats(*trace.os);
+    return 0;
+}
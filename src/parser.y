@@ -3,7 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define DBG 1
+#define DBG 0
 #define DBG_PRINT(...) do { if (DBG) fprintf(stderr, __VA_ARGS__); } while (0)
 
 extern FILE * yyin;
@@ -2,8 +2,16 @@
 #pragma once
 
 #include "ir.hpp" // Pass 需要操作 IR
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
 class FunctionPass {
@@ -16,6 +24,39 @@ class FunctionPass {
      * @return true 如果 Pass 修改了 IR，否则返回 false
      */
     virtual bool run(IRFunction &F) = 0;
+
+    /**
+     * @brief Pass 的短名字，用于 -print-after=<pass> 等跟踪选项
+     */
+    virtual const char *name() const = 0;
+
+    /**
+     * @brief Pass 自定义的统计计数器（例如提升的 alloca 数），由 PassManager 汇总进 -stats 报告
+     */
+    const std::map<std::string, long> &stats() const {
+        return counters;
+    }
+
+    /**
+     * @brief 设置 Pass 文本输出（print-* 分析的报告）的去向，由 PassManager 在运行前传入
+     */
+    void set_trace_stream(std::ostream &os) {
+        trace_os = &os;
+    }
+
+  protected:
+    void add_stat(const std::string &counter, long n = 1) {
+        if (n != 0) counters[counter] += n;
+    }
+
+    // 与 IR 转储共用同一个流：遵循 -trace-file，-j 下按函数缓冲
+    std::ostream &trace_out() {
+        return *trace_os;
+    }
+
+  private:
+    std::map<std::string, long> counters;
+    std::ostream *trace_os = &std::cerr;
 };
 
 class ModulePass {
@@ -30,32 +71,178 @@ class ModulePass {
     virtual bool run(IRModule &M) = 0;
 };
 
+// 统计函数的指令/基本块/PHI 数量（LABEL 伪指令不计）
+inline IRSize measure_ir(const IRFunction &F) {
+    IRSize size;
+    size.blocks = F.blocks.size();
+    for (const auto &block : F.blocks) {
+        for (const auto &inst : block->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            size.insts++;
+            if (inst.op == IROp::PHI) size.phis++;
+        }
+    }
+    return size;
+}
+
+// 每个线程都需要自己的 Pass 实例（Pass 内部带有分析状态），因此 PassManager 保存的是工厂
+using FunctionPassFactory = std::function<std::unique_ptr<FunctionPass>()>;
+
+// 流水线中的一项：要么是单个 Pass，要么是一组重复执行的子流水线
+struct PassPipelineEntry {
+    FunctionPassFactory factory{};          // 单个 Pass（group 为空时）
+    std::vector<PassPipelineEntry> group{}; // 子流水线
+    unsigned repeat = 1;                    // 子流水线的执行次数，0 表示迭代到不再变化
+};
+
 class PassManager {
   private:
-    std::vector<std::unique_ptr<FunctionPass>> function_passes;
+    // "(...)*" 迭代到不动点时的最大轮数，防止两个 Pass 互相撤销导致死循环
+    static constexpr unsigned MAX_FIXPOINT_ITERATIONS = 10;
+
+    std::vector<PassPipelineEntry> function_passes;
     std::vector<std::unique_ptr<ModulePass>> module_passes;
+    TraceOptions trace;
+    CompileReport *report = nullptr;
+
+    /**
+     * @brief 运行单个 Pass，并负责 trace 输出与统计记录
+     * @return true 如果 Pass 修改了 IR
+     */
+    bool run_pass(const FunctionPassFactory &factory, IRFunction &F, std::ostream &out,
+                  std::vector<StageRecord> &recs) {
+        const bool func_traced = trace.matches_func(F.name);
+        auto pass = factory();
+        pass->set_trace_stream(out);
+        const std::string pass_name = pass->name();
+        const bool dump_after = func_traced && trace.wants_ir_after(pass_name);
+
+        if (trace.trace_passes && func_traced) {
+            out << "; Running " << pass_name << " on " << F.name << "\n";
+        }
+
+        // -print-changed 需要 Pass 前的文本用于比较，只有此时才格式化
+        std::string before;
+        if (dump_after && trace.print_changed) before = to_text(F);
+
+        StageRecord rec;
+        StageMeter meter;
+        if (report) {
+            rec.stage = pass_name;
+            rec.func = F.name;
+            rec.has_ir = true;
+            rec.before = measure_ir(F);
+            meter.start();
+        }
+
+        bool changed = pass->run(F);
+
+        if (report) {
+            meter.stop(rec);
+            rec.after = measure_ir(F);
+            rec.counters = pass->stats();
+            recs.push_back(std::move(rec));
+        }
+
+        if (dump_after) {
+            std::string after = to_text(F);
+            bool requested = trace.print_after_all || trace.print_after.contains(pass_name);
+            if (requested || after != before) {
+                out << "; *** IR Dump After " << pass_name << " on " << F.name << " ***\n"
+                    << after;
+            }
+        }
+        return changed;
+    }
+
+    /**
+     * @brief 按顺序在单个函数上跑一条（子）流水线
+     * @param out 该函数的 trace 输出（按函数缓冲，避免并行时交错）
+     * @param recs 该函数的统计记录（同样按函数缓冲，最终按函数顺序汇总）
+     * @return true 如果流水线中任一 Pass 修改了 IR
+     */
+    bool run_pipeline(const std::vector<PassPipelineEntry> &pipeline, IRFunction &F,
+                      std::ostream &out, std::vector<StageRecord> &recs) {
+        bool changed = false;
+        for (const auto &entry : pipeline) {
+            if (entry.group.empty()) {
+                changed |= run_pass(entry.factory, F, out, recs);
+                continue;
+            }
+            unsigned rounds = entry.repeat == 0 ? MAX_FIXPOINT_ITERATIONS : entry.repeat;
+            for (unsigned i = 0; i < rounds; ++i) {
+                bool round_changed = run_pipeline(entry.group, F, out, recs);
+                changed |= round_changed;
+                if (entry.repeat == 0 && !round_changed) break;
+            }
+        }
+        return changed;
+    }
+
+    static std::string to_text(const IRFunction &F) {
+        std::ostringstream ss;
+        F.dump(ss);
+        return ss.str();
+    }
 
   public:
-    void addFunctionPass(FunctionPass *pass) {
-        function_passes.emplace_back(pass);
+    void addFunctionPass(FunctionPassFactory factory) {
+        function_passes.push_back(PassPipelineEntry{ .factory = std::move(factory) });
+    }
+
+    template <typename T, typename... Args> void addFunctionPass(Args... args) {
+        addFunctionPass([=]() { return std::make_unique<T>(args...); });
+    }
+
+    // 追加一条由 pass_registry.hpp 解析出来的流水线
+    void addPipeline(std::vector<PassPipelineEntry> pipeline) {
+        for (auto &entry : pipeline) function_passes.push_back(std::move(entry));
     }
 
     void addModulePass(ModulePass *pass) {
         module_passes.emplace_back(pass);
     }
 
-    void run(IRModule &M) {
+    void setTraceOptions(TraceOptions options) {
+        trace = std::move(options);
+    }
+
+    // 设置后，每个 Pass 在每个函数上的时间/分配/IR 规模/计数器都会记录到 report
+    void setReport(CompileReport *r) {
+        report = r;
+    }
+
+    /**
+     * @brief 运行所有 Pass
+     * @param jobs 并行线程数；1 表示串行，0 表示使用全部核心
+     */
+    void run(IRModule &M, unsigned jobs = 1) {
         // 运行所有 Module Pass
         for (auto &pass : module_passes) {
             pass->run(M);
         }
 
-        // 在每个 Function 上运行所有 Function Pass
-        for (IRFunction &F : M.functions) {
-            for (auto &pass : function_passes) {
-                pass->run(F);
-                M.dump(std::cout);
+        std::vector<std::vector<StageRecord>> recs(M.functions.size());
+        ThreadPool pool(jobs);
+        if (pool.size() == 1) {
+            // 在每个 Function 上运行所有 Function Pass
+            for (size_t i = 0; i < M.functions.size(); ++i) {
+                run_pipeline(function_passes, M.functions[i], *trace.os, recs[i]);
             }
+        } else {
+            // 函数之间互不依赖，每个函数独立跑流水线；trace 先写入各自缓冲区，再按函数顺序输出
+            std::vector<std::ostringstream> logs(M.functions.size());
+            pool.parallel_for(M.functions.size(), [&](size_t i) {
+                run_pipeline(function_passes, M.functions[i], logs[i], recs[i]);
+            });
+            for (const auto &log : logs) {
+                *trace.os << log.str();
+            }
+        }
+
+        if (!report) return;
+        for (auto &func_recs : recs) {
+            for (auto &rec : func_recs) report->add(std::move(rec));
         }
     }
 };
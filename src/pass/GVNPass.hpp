@@ -2,38 +2,52 @@
 
 #include "ir.hpp"
 #include "pass.hpp"
+#include "pass/alias_analysis.hpp"
+#include "pass/bitvector_dataflow.hpp"
+#include "pass/memory_ssa.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 // ========================================================
 // --- GVN (Global Value Numbering) Pass ---
+// 按支配树前序遍历给每个值编号，被支配的重复计算改用支配它的规范操作数。
+// LOAD 按 (地址的值编号, 内存状态) 编号，内存状态取 MemorySSA 走查得到的 clobber：
+// 同一地址、同一 clobber 的两次读结果相同；clobber 是写同一地址的 store 时直接用存进去的值。
+// 读的内存状态是本块的 MemoryPhi 时，把地址翻译到每个前驱，各前驱都有可用的值就换成新的 PHI。
+// 同一块里各入边值编号都相同的 PHI 是重复的。
 // ========================================================
 
 class GVNPass : public FunctionPass {
-  private:
+  public:
     /**
      * @brief GVN 的核心 "值" 的唯一键。
-     * 用于 valueTable 的 Key。
+     * 用于 valueTable 的 Key；LCM 也用它给表达式分类。
      */
     struct ValueKey {
         IROp op;
         std::vector<size_t> operand_vns; // 操作数的值编号
 
-        // 用于常量或全局地址
+        // 用于常量或全局地址；LOAD 的 imm 是内存状态（clobber 的 MemoryAccess 编号）
         int imm = 0;
         std::string name;
+        IRType *type = nullptr; // 结果类型
 
         // 构造函数 (常量)
         ValueKey(int i) : op(IROp::MOVE), imm(i) {} // 使用 MOVE 作为常量的代理 Op
         // 构造函数 (全局地址)
         ValueKey(std::string n) : op(IROp::GEP), name(std::move(n)) {} // 使用 GEP 作为地址的代理 Op
         // 构造函数 (计算)
-        ValueKey(IROp o, std::vector<size_t> vns) : op(o), operand_vns(std::move(vns)) {
+        ValueKey(IROp o, std::vector<size_t> vns, IRType *t, int state = 0)
+            : op(o), operand_vns(std::move(vns)), imm(state), type(t) {
             // 对可交换操作进行规范化 (ADD, MUL)
             if (op == IROp::ADD || op == IROp::MUL) {
                 if (operand_vns.size() == 2 && operand_vns[0] > operand_vns[1]) {
@@ -44,7 +58,7 @@ class GVNPass : public FunctionPass {
 
         bool operator==(const ValueKey &other) const {
             return op == other.op && imm == other.imm && name == other.name &&
-                   operand_vns == other.operand_vns;
+                   type == other.type && operand_vns == other.operand_vns;
         }
     };
 
@@ -56,6 +70,7 @@ class GVNPass : public FunctionPass {
             size_t hash = std::hash<int>()(static_cast<int>(k.op));
             hash ^= std::hash<int>()(k.imm) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
             hash ^= std::hash<std::string>()(k.name) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            hash ^= std::hash<const void *>()(k.type) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
             for (size_t vn : k.operand_vns) {
                 hash ^= std::hash<size_t>()(vn) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
             }
@@ -63,20 +78,39 @@ class GVNPass : public FunctionPass {
         }
     };
 
+  private:
+    // 一个访存值在哪个块里可用（store 的值或 load 的结果）
+    struct Available {
+        IRBasicBlock *block;
+        IROperand value;
+    };
+
     // --- GVN 核心数据结构 ---
 
-    // 1. 值 -> 编号
+    // 1. 值 -> 编号（随支配树作用域撤销）
     // (e.g., (ADD, VN_5, VN_6) -> VN_7)
     std::unordered_map<ValueKey, size_t, ValueKeyHash> valueTable;
 
-    // 2. 虚拟寄存器 -> 编号
+    // 2. 虚拟寄存器 -> 编号（SSA 中每个寄存器的编号是固定的，不撤销）
     // (e.g., "%1" -> VN_7)
     std::unordered_map<std::string, size_t> regToVN;
 
-    // 3. 编号 -> 规范操作数 (第一个计算出该值的操作数)
+    // 3. 编号 -> 规范操作数 (第一个计算出该值的操作数，随作用域撤销)
     // (e.g., VN_7 -> IROperand("%1"))
     std::unordered_map<size_t, IROperand> vnToReg;
 
+    // 4. 访存键 -> 所有可用的值（不撤销），PHI 翻译时查找支配前驱的那一个
+    std::unordered_map<ValueKey, std::vector<Available>, ValueKeyHash> memoryValues;
+
+    // 被消除的指令与替换它结果的规范操作数
+    std::unordered_set<IRInstruction *> instsToDelete;
+    std::unordered_map<std::string, IROperand> replacements;
+
+    IRFunction *func = nullptr;
+    std::unique_ptr<AliasAnalysis> aa;
+    std::unique_ptr<MemorySSA> mssa;
+    std::unique_ptr<BlockNumbering> rpo;
+
     // 计数器
     size_t nextVN = 1;
     bool ir_changed = false;
@@ -120,6 +154,153 @@ class GVNPass : public FunctionPass {
         }
     }
 
+    /**
+     * @brief 消除 inst：它的结果以后都用 canonical 代替
+     */
+    void replaceWith(IRInstruction &inst, size_t vn, const char *stat) {
+        IROperand canonical = vnToReg.at(vn);
+        // 常量的编号不区分宽度，换成结果自己的类型
+        if (canonical.op_type == IROperandType::IMM) {
+            canonical = IROperand::create_imm(canonical.imm_value, inst.result->type);
+        }
+        regToVN[inst.result->name] = vn;
+        replacements.insert_or_assign(inst.result->name, canonical);
+        instsToDelete.insert(&inst);
+        ir_changed = true;
+        add_stat(stat);
+    }
+
+    // 新值：分配编号，inst 的结果成为它的规范操作数
+    size_t defineNew(const IRInstruction &inst, std::vector<std::string> &regsDefinedInBlock) {
+        size_t newVN = nextVN++;
+        std::string regName = inst.result->name;
+        regToVN[regName] = newVN;
+        vnToReg[newVN] = *inst.result;
+        regsDefinedInBlock.push_back(regName);
+        return newVN;
+    }
+
+    /**
+     * @brief PHI 的编号：同一块里各入边值编号都相同的 PHI 是同一个值
+     */
+    void numberPhi(IRBasicBlock *block, IRInstruction &inst,
+                   std::vector<std::string> &regsDefinedInBlock,
+                   std::vector<ValueKey> &valuesDefinedInBlock) {
+        std::vector<std::pair<std::string, size_t>> incoming;
+        for (size_t i = 0; i + 1 < inst.args.size(); i += 2) {
+            const IROperand &arg = inst.args[i];
+            // 回边上的值还没有编号，这样的 PHI 不与别的 PHI 合并
+            if (arg.op_type == IROperandType::REG && !regToVN.count(arg.name)) {
+                defineNew(inst, regsDefinedInBlock);
+                return;
+            }
+            incoming.emplace_back(inst.args[i + 1].name, getVN(arg));
+        }
+        std::sort(incoming.begin(), incoming.end());
+
+        std::vector<size_t> vns;
+        std::string preds = block->label;
+        for (const auto &[label, vn] : incoming) {
+            preds += "," + label;
+            vns.push_back(vn);
+        }
+        ValueKey key(IROp::PHI, vns, inst.result->type);
+        key.name = preds;
+        if (valueTable.count(key)) {
+            replaceWith(inst, valueTable.at(key), "redundant phis eliminated");
+            return;
+        }
+        valueTable[key] = defineNew(inst, regsDefinedInBlock);
+        valuesDefinedInBlock.push_back(key);
+    }
+
+    // 支配 pred（因此在 pred 末尾可用）的访存值
+    const IROperand *availableIn(const ValueKey &key, const IRBasicBlock *pred) const {
+        auto it = memoryValues.find(key);
+        if (it == memoryValues.end()) return nullptr;
+        for (const Available &a : it->second) {
+            if (a.block->dominates(pred)) return &a.value;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 读的内存状态是本块的 MemoryPhi：在每个前驱末尾查同一地址上可用的值，
+     *        都找到时在块首插入合并它们的 PHI
+     * @return 新 PHI 的结果；有前驱找不到时返回 nullopt
+     */
+    std::optional<IROperand> translateLoad(IRBasicBlock *block, const IRInstruction &load,
+                                           MemoryAccess *clobber, size_t addrVN) {
+        if (clobber->kind != MemoryAccessKind::Phi || clobber->block != block) return std::nullopt;
+        MemoryLocation loc = aa->location(load);
+        std::vector<IROperand> args;
+        for (auto [state, pred] : clobber->incoming) {
+            if (!pred) return std::nullopt;
+            MemoryAccess *c = mssa->get_clobbering_access(state, loc);
+            ValueKey key(IROp::LOAD, { addrVN }, load.result->type, static_cast<int>(c->id));
+            const IROperand *value = availableIn(key, pred);
+            if (!value) return std::nullopt;
+            args.push_back(*value);
+            args.push_back(IROperand::create_label(pred->label));
+        }
+
+        IROperand result = func->new_reg(load.result->type);
+        auto pos = block->insts.begin();
+        while (pos != block->insts.end() && (pos->op == IROp::LABEL || pos->op == IROp::PHI)) {
+            ++pos;
+        }
+        block->insts.insert(pos, IRInstruction(IROp::PHI, args, result));
+        return result;
+    }
+
+    void numberLoad(IRBasicBlock *block, IRInstruction &inst,
+                    std::vector<std::string> &regsDefinedInBlock,
+                    std::vector<ValueKey> &valuesDefinedInBlock) {
+        MemoryAccess *access = mssa->get_memory_access(&inst);
+        if (!access) {
+            defineNew(inst, regsDefinedInBlock);
+            return;
+        }
+        MemoryAccess *clobber = mssa->get_clobbering_access(access);
+        size_t addrVN = getVN(inst.args[0]);
+        ValueKey key(IROp::LOAD, { addrVN }, inst.result->type, static_cast<int>(clobber->id));
+
+        if (valueTable.count(key)) {
+            bool forwarded = clobber->kind == MemoryAccessKind::Def &&
+                             clobber->inst->op == IROp::STORE &&
+                             getVN(clobber->inst->args[1]) == addrVN;
+            replaceWith(inst, valueTable.at(key),
+                        forwarded ? "stores forwarded to loads" : "redundant loads eliminated");
+        } else if (auto phi = translateLoad(block, inst, clobber, addrVN)) {
+            size_t vn = nextVN++;
+            regToVN[phi->name] = vn;
+            vnToReg[vn] = *phi;
+            regsDefinedInBlock.push_back(phi->name);
+            valueTable[key] = vn;
+            valuesDefinedInBlock.push_back(key);
+            memoryValues[key].push_back({ block, *phi });
+            replaceWith(inst, vn, "loads translated through phis");
+        } else {
+            valueTable[key] = defineNew(inst, regsDefinedInBlock);
+            valuesDefinedInBlock.push_back(key);
+            memoryValues[key].push_back({ block, *inst.result });
+        }
+    }
+
+    // store 之后从同一地址读到的就是存进去的值
+    void recordStore(IRBasicBlock *block, const IRInstruction &inst,
+                     std::vector<ValueKey> &valuesDefinedInBlock) {
+        MemoryAccess *access = mssa->get_memory_access(&inst);
+        if (!access) return;
+        const IROperand &value = inst.args[0];
+        if (value.op_type == IROperandType::REG && !regToVN.count(value.name)) return;
+        IRType *type = inst.args[1].type->get_pointee_type();
+        ValueKey key(IROp::LOAD, { getVN(inst.args[1]) }, type, static_cast<int>(access->id));
+        valueTable[key] = getVN(value);
+        valuesDefinedInBlock.push_back(key);
+        memoryValues[key].push_back({ block, value });
+    }
+
     /**
      * @brief 递归处理基本块 (按支配树前序遍历)
      */
@@ -141,6 +322,19 @@ class GVNPass : public FunctionPass {
                 continue; // 处理下一条指令
             }
 
+            if (inst.op == IROp::PHI) {
+                numberPhi(block, inst, regsDefinedInBlock, valuesDefinedInBlock);
+                continue;
+            }
+            if (inst.op == IROp::LOAD) {
+                numberLoad(block, inst, regsDefinedInBlock, valuesDefinedInBlock);
+                continue;
+            }
+            if (inst.op == IROp::STORE) {
+                recordStore(block, inst, valuesDefinedInBlock);
+                continue;
+            }
+
             // GVN 冗余计算消除
             // 检查是否是可 GVN 的计算 (ADD, SUB, MUL, DIV, GEP)
             if (inst.is_calc() || inst.op == IROp::GEP) {
@@ -150,58 +344,33 @@ class GVNPass : public FunctionPass {
                     vns.push_back(getVN(arg));
                 }
                 // 构建 ValueKey
-                ValueKey key(inst.op, vns);
+                ValueKey key(inst.op, vns, inst.result->type);
 
                 // 查找
                 if (valueTable.count(key)) {
-                    size_t existingVN = valueTable.at(key);
-                    IROperand canonicalReg = vnToReg.at(existingVN); // 规范操作数
-                    std::string oldRegName = inst.result->name;
-
-                    std::cout << "GVN: Replacing " << oldRegName
-                              << " (Op: " << op_to_string(inst.op) << ") with "
-                              << canonicalReg.to_string() << std::endl;
-
-                    // 替换：将 `inst` 转换为 `move`
-                    inst.op = IROp::MOVE;
-                    inst.args = { canonicalReg };
-
-                    // 更新映射
-                    regToVN[oldRegName] = existingVN;
-                    regsDefinedInBlock.push_back(oldRegName);
-                    ir_changed = true;
+                    replaceWith(inst, valueTable.at(key), "redundant computations eliminated");
                 } else {
-                    // 这是一个新值
-                    size_t newVN = nextVN++;
-                    std::string regName = inst.result->name;
-
-                    // 添加到所有映射
-                    valueTable[key] = newVN;
-                    regToVN[regName] = newVN;
-                    vnToReg[newVN] = *inst.result; // 这是此 VN 的规范操作数
-
-                    // 记录以便撤销
-                    regsDefinedInBlock.push_back(regName);
+                    // 这是一个新值，记录以便撤销
+                    valueTable[key] = defineNew(inst, regsDefinedInBlock);
                     valuesDefinedInBlock.push_back(key);
                 }
             } else if (inst.result.has_value() && inst.result->op_type == IROperandType::REG) {
-                size_t newVN = nextVN++;
-                std::string regName = inst.result->name;
-                regToVN[regName] = newVN;
-                vnToReg[newVN] = *inst.result;
-                regsDefinedInBlock.push_back(regName);
+                defineNew(inst, regsDefinedInBlock);
             }
         } // 遍历块中的指令结束
 
         // --- 4. 递归支配树 ---
-        // 访问所有此块“直接支配”的子块
-        for (IRBasicBlock *child : block->dom_child) {
+        // 访问所有此块“直接支配”的子块；按逆后序，汇合块的前驱先于它处理，PHI 翻译才查得到值
+        std::vector<IRBasicBlock *> children = block->dom_child;
+        std::sort(children.begin(), children.end(),
+                  [&](IRBasicBlock *a, IRBasicBlock *b) { return (*rpo)[a] < (*rpo)[b]; });
+        for (IRBasicBlock *child : children) {
             processBlock(child);
         }
 
         // --- 5. 撤销 (Pop Scope) ---
         // 当我们从此块返回时 (已处理完所有子树)，
-        // 撤销此块中添加的定义，以便访问兄弟块。
+        // 撤销此块中添加的值，以便访问兄弟块。
         for (const auto &key : valuesDefinedInBlock) {
             valueTable.erase(key);
         }
@@ -211,14 +380,30 @@ class GVNPass : public FunctionPass {
             if (vnToReg.count(vn) && vnToReg[vn].name == regName) {
                 vnToReg.erase(vn);
             }
-            regToVN.erase(regName);
+        }
+    }
+
+    // 删除被消除的指令，它们结果的所有使用改为规范操作数
+    void applyReplacements(IRFunction &F) {
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                for (auto &arg : inst.args) {
+                    if (arg.op_type != IROperandType::REG) continue;
+                    auto it = replacements.find(arg.name);
+                    if (it != replacements.end()) arg = it->second;
+                }
+            }
+            block->insts.remove_if(
+                [&](IRInstruction &inst) { return instsToDelete.contains(&inst); });
         }
     }
 
   public:
-    bool run(IRFunction &F) override {
-        std::cout << "Running GVNPass on function: " << F.name << std::endl;
+    const char *name() const override {
+        return "gvn";
+    }
 
+    bool run(IRFunction &F) override {
         // 确保CFG和支配树已构建
         if (F.blocks.empty() || F.blocks[0]->idom != nullptr) {
             if (F.blocks.empty()) return false;
@@ -231,8 +416,15 @@ class GVNPass : public FunctionPass {
         valueTable.clear();
         regToVN.clear();
         vnToReg.clear();
+        memoryValues.clear();
+        instsToDelete.clear();
+        replacements.clear();
         nextVN = 1;
         ir_changed = false;
+        func = &F;
+        aa = std::make_unique<AliasAnalysis>(F);
+        mssa = std::make_unique<MemorySSA>(F, *aa);
+        rpo = std::make_unique<BlockNumbering>(F);
 
         // 2. 为函数参数预先分配 VN
         for (const auto &param : F.params) {
@@ -242,10 +434,12 @@ class GVNPass : public FunctionPass {
         }
 
         // 3. 从入口块开始递归
-        if (!F.blocks.empty()) {
-            processBlock(F.blocks[0].get());
-        }
+        processBlock(F.blocks[0].get());
 
+        applyReplacements(F);
+        rpo.reset();
+        mssa.reset();
+        aa.reset();
         return ir_changed;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/scalar_evolution.hpp"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 激进死代码删除（ADCE） ---
+// 先假设所有指令都是死的，从有副作用的根（STORE、有副作用的 CALL、I/O、RET）出发标记活指令：
+// 活指令的操作数的定义是活的；活指令所在块控制依赖的分支是活的；活的 PHI 使其各入边前驱末尾的
+// 分支是活的；活的条件跳转使它前面的 TEST 是活的。
+// 没有标记的指令（包括互相引用的死 PHI 环）全部删除；整块的条件跳转都是死的时，
+// 改为直接跳到该块的直接后支配者，中间变得不可达的块随后删除。
+// 回边次数算不出来的循环可能不终止，它的退出分支和回边分支视为根，保证不会把死循环删掉。
+// ========================================================
+
+class ADCEPass : public FunctionPass {
+  private:
+    std::unordered_set<const IRInstruction *> live;
+    std::unordered_set<const IRBasicBlock *> live_blocks;
+    std::vector<const IRInstruction *> worklist;
+
+    std::unordered_map<std::string, std::vector<const IRInstruction *>> defs;
+    std::unordered_map<const IRInstruction *, IRBasicBlock *> block_of;
+    std::unordered_map<std::string, IRBasicBlock *> label_map;
+
+    bool is_root(const IRFunction &F, const IRInstruction &inst) const {
+        switch (inst.op) {
+            case IROp::STORE:
+            case IROp::RET:
+            case IROp::INPUT_I32:
+            case IROp::INPUT_I8:
+            case IROp::OUTPUT_I32:
+            case IROp::OUTPUT_I8:
+            case IROp::OUTPUT_STR: return true;
+            case IROp::CALL: {
+                // 纯函数（没有副作用且总会返回）的调用只在结果被用到时才活
+                const FunctionSummary *s = F.callee_summary(inst);
+                return !(s && s->is_pure());
+            }
+            default: return false;
+        }
+    }
+
+    void mark(const IRInstruction *inst) {
+        if (live.insert(inst).second) worklist.push_back(inst);
+    }
+
+    // 块里的条件跳转（以及它们用到的 TEST）作为一个整体
+    void mark_branches(const IRBasicBlock *block) {
+        for (const auto &inst : block->insts) {
+            if (inst.is_cond_b()) mark(&inst);
+        }
+    }
+
+    void mark_block(const IRBasicBlock *block) {
+        if (!live_blocks.insert(block).second) return;
+        for (const IRBasicBlock *dep : block->control_deps) mark_branches(dep);
+    }
+
+    void propagate(const IRInstruction *inst) {
+        IRBasicBlock *block = block_of.at(inst);
+        mark_block(block);
+
+        if (inst->op == IROp::PHI) {
+            for (size_t i = 1; i < inst->args.size(); i += 2) {
+                auto pred = label_map.find(inst->args[i].name);
+                if (pred == label_map.end()) continue;
+                mark_block(pred->second);
+                mark_branches(pred->second);
+            }
+        }
+        if (inst->is_cond_b()) {
+            // 条件跳转读的是它前面最近一条 TEST 设置的标志
+            const IRInstruction *test = nullptr;
+            for (const auto &i : block->insts) {
+                if (&i == inst) break;
+                if (i.op == IROp::TEST) test = &i;
+            }
+            if (test) mark(test);
+        }
+
+        for (size_t i = 0; i < inst->args.size(); ++i) {
+            if (inst->op == IROp::PHI && i % 2 == 1) continue;
+            const IROperand &arg = inst->args[i];
+            if (arg.op_type != IROperandType::REG) continue;
+            auto it = defs.find(arg.name);
+            if (it == defs.end()) continue;
+            for (const IRInstruction *def : it->second) mark(def);
+        }
+    }
+
+    // 可能不终止的循环：保留它的退出分支和回边分支
+    void mark_infinite_loops(IRFunction &F) {
+        if (F.loops.empty()) return;
+        ScalarEvolution se(F);
+        for (auto &loop : F.loops) {
+            if (!se.backedge_taken_count(loop.get())->could_not_compute()) continue;
+            for (IRBasicBlock *block : loop->exiting_blocks) mark_branches(block);
+            for (IRBasicBlock *block : loop->latches) mark_branches(block);
+        }
+    }
+
+    void init(IRFunction &F) {
+        live.clear();
+        live_blocks.clear();
+        worklist.clear();
+        defs.clear();
+        block_of.clear();
+        label_map.clear();
+        for (auto &block : F.blocks) {
+            label_map[block->label] = block.get();
+            for (auto &inst : block->insts) {
+                block_of[&inst] = block.get();
+                if (inst.result) defs[inst.result->name].push_back(&inst);
+            }
+        }
+    }
+
+  public:
+    const char *name() const override {
+        return "adce";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.blocks.empty()) return false;
+        init(F);
+
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                if (is_root(F, inst)) mark(&inst);
+            }
+            // 直接后支配者是虚拟出口（例如一边是死循环）时没有可以改跳的目标
+            if (!block->ipdom) mark_branches(block.get());
+        }
+        mark_infinite_loops(F);
+        while (!worklist.empty()) {
+            const IRInstruction *inst = worklist.back();
+            worklist.pop_back();
+            propagate(inst);
+        }
+
+        bool changed = false;
+        for (auto &block : F.blocks) {
+            bool dead_branch = std::any_of(
+                block->insts.begin(), block->insts.end(),
+                [&](const IRInstruction &i) { return i.is_cond_b() && !live.contains(&i); });
+            for (auto it = block->insts.begin(); it != block->insts.end();) {
+                IRInstruction &inst = *it;
+                bool keep = live.contains(&inst) || inst.op == IROp::LABEL;
+                if (inst.op == IROp::BR) {
+                    keep = true;
+                    if (dead_branch) {
+                        // 整块的条件跳转都是死的：直接去后支配者
+                        inst.args = { IROperand::create_label(block->ipdom->label) };
+                        add_stat("branches removed");
+                    }
+                }
+                if (keep) {
+                    ++it;
+                    continue;
+                }
+                if (inst.op == IROp::PHI) add_stat("phis removed");
+                it = block->insts.erase(it);
+                add_stat("instructions removed");
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            // 改跳之后，原来夹在分支和后支配者之间的块变得不可达
+            BuildCFGPass{}.run(F);
+            DeadBlockEliminationPass{}.run(F);
+        }
+        return changed;
+    }
+};
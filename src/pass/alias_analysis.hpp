@@ -0,0 +1,537 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ========================================================
+// --- 别名分析 ---
+// PointsToPass：模块级的 Steensgaard 式指向分析，主要为指针参数和从内存读出的指针提供信息。
+// AliasAnalysis：函数内沿 GEP 链把每个指针拆成"基对象 + 字节偏移"，基对象是分配点
+// （alloca / 全局变量）时按字段和常量下标区分，其余情况再借助逃逸信息和指向分析的等价类。
+// ========================================================
+
+// Steensgaard 指向分析：每个值对应一个"可能指向的对象集合"节点，集合之间只合并不拆分，
+// 近线性时间。每个节点还有一个 pointee 节点，表示这些对象中存放的指针可能指向哪里。
+// 结果写入各函数的 IRFunction::points_to_class
+class PointsToPass : public ModulePass {
+  private:
+    std::vector<int> parent, pointee;
+    std::vector<char> has_object;
+    std::unordered_map<std::string, int> nodes; // "@f|%3"、"@f|ret" 或全局变量名 -> 节点
+
+    int make() {
+        parent.push_back(static_cast<int>(parent.size()));
+        pointee.push_back(-1);
+        has_object.push_back(0);
+        return parent.back();
+    }
+
+    int find(int n) {
+        while (parent[n] != n) {
+            parent[n] = parent[parent[n]];
+            n = parent[n];
+        }
+        return n;
+    }
+
+    int node(const std::string &key) {
+        auto it = nodes.find(key);
+        if (it != nodes.end()) return it->second;
+        int n = make();
+        nodes.emplace(key, n);
+        return n;
+    }
+
+    // 函数 F 中操作数的值节点；立即数和标签没有节点，返回 -1
+    int value(const IRFunction &F, const IROperand &op) {
+        if (op.op_type == IROperandType::GLOBAL) {
+            int n = node(op.name);
+            has_object[find(n)] = 1; // 全局变量的地址指向它自己
+            return n;
+        }
+        if (op.op_type == IROperandType::REG) return node(F.name + "|" + op.name);
+        return -1;
+    }
+
+    // n 所指对象中存放的指针指向的节点
+    int deref(int n) {
+        if (n < 0) return -1;
+        n = find(n);
+        if (pointee[n] < 0) {
+            int p = make();
+            pointee[n] = p;
+        }
+        return find(pointee[n]);
+    }
+
+    void join(int a, int b) {
+        if (a < 0 || b < 0) return;
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        parent[b] = a;
+        has_object[a] |= has_object[b];
+        int pa = pointee[a], pb = pointee[b];
+        if (pa < 0) {
+            pointee[a] = pb;
+        } else if (pb >= 0) {
+            join(pa, pb);
+        }
+    }
+
+    void visit(const IRFunction &F, const IRInstruction &inst,
+               const std::unordered_map<std::string, const IRFunction *> &funcs) {
+        int result = inst.result ? value(F, *inst.result) : -1;
+        switch (inst.op) {
+            case IROp::ALLOCA: has_object[find(result)] = 1; break;
+            case IROp::LOAD: join(result, deref(value(F, inst.args[0]))); break;
+            case IROp::STORE: join(deref(value(F, inst.args[1])), value(F, inst.args[0])); break;
+            case IROp::CALL: {
+                auto it = funcs.find(inst.args[0].name);
+                if (it == funcs.end()) break;
+                const IRFunction &callee = *it->second;
+                for (size_t i = 1; i < inst.args.size() && i - 1 < callee.params.size(); ++i) {
+                    join(value(callee, callee.params[i - 1]), value(F, inst.args[i]));
+                }
+                join(result, node(callee.name + "|ret"));
+                break;
+            }
+            case IROp::GEP: join(result, value(F, inst.args[0])); break; // 下标不是指针
+            case IROp::RET:
+                if (!inst.args.empty()) join(node(F.name + "|ret"), value(F, inst.args[0]));
+                break;
+            default:
+                // MOVE、PHI 和算术：结果与操作数指向同样的对象（指针也可能经由整数运算传递）
+                if (result < 0) break;
+                for (const auto &arg : inst.args) join(result, value(F, arg));
+                break;
+        }
+    }
+
+  public:
+    bool run(IRModule &M) override {
+        parent.clear();
+        pointee.clear();
+        has_object.clear();
+        nodes.clear();
+
+        std::unordered_map<std::string, IRFunction *> funcs;
+        std::unordered_map<std::string, const IRFunction *> callees;
+        for (auto &F : M.functions) {
+            funcs[F.name] = &F;
+            callees[F.name] = &F;
+        }
+        for (const auto &F : M.functions) {
+            for (const auto &param : F.params) value(F, param);
+            for (const auto &block : F.blocks) {
+                for (const auto &inst : block->insts) visit(F, inst, callees);
+            }
+        }
+
+        // 只记录确实指向某个对象的值；全局变量的类编号每个函数都需要
+        for (auto &F : M.functions) F.points_to_class.clear();
+        for (const auto &[key, n] : nodes) {
+            int cls = find(n);
+            if (!has_object[cls]) continue;
+            size_t bar = key.find('|');
+            if (bar == std::string::npos) {
+                for (auto &F : M.functions) F.points_to_class[key] = cls;
+                continue;
+            }
+            auto it = funcs.find(key.substr(0, bar));
+            if (it != funcs.end()) it->second->points_to_class[key.substr(bar + 1)] = cls;
+        }
+        return false;
+    }
+};
+
+enum class AliasResult { NoAlias, MayAlias, PartialAlias, MustAlias };
+
+// 位掩码：Ref 表示可能读，Mod 表示可能写
+enum class ModRefInfo { NoModRef = 0, Ref = 1, Mod = 2, ModRef = 3 };
+
+inline const char *alias_result_name(AliasResult r) {
+    switch (r) {
+        case AliasResult::NoAlias: return "NoAlias";
+        case AliasResult::MayAlias: return "MayAlias";
+        case AliasResult::PartialAlias: return "PartialAlias";
+        case AliasResult::MustAlias: return "MustAlias";
+    }
+    return "?";
+}
+
+// 一次访存涉及的内存区域：基对象 + 字节偏移 + 访问字节数。
+// 偏移 = offset + Σ(寄存器 × 系数)；在下标不越界的前提下还落在 [min_offset, max_offset] 内
+struct MemoryLocation {
+    enum class BaseKind { Alloca, Global, Argument, Unknown };
+    static constexpr long UNKNOWN_SIZE = -1;
+
+    BaseKind kind = BaseKind::Unknown;
+    std::string base; // alloca 的结果 / 全局变量 / 参数 / 无法继续追踪的指针寄存器
+    long offset = 0;
+    std::vector<std::pair<std::string, long>> terms; // 按寄存器名排序，系数非 0
+    long min_offset = 0, max_offset = 0;
+    bool bounded = true;      // [min_offset, max_offset] 是否可信
+    long size = UNKNOWN_SIZE; // 访问的字节数，未知表示从偏移处一直到对象末尾
+
+    // 分配点：不同分配点的对象互不重叠
+    bool is_identified() const {
+        return kind == BaseKind::Alloca || kind == BaseKind::Global;
+    }
+};
+
+class AliasAnalysis {
+  private:
+    IRFunction &F;
+    std::unordered_map<std::string, const IRInstruction *> defs; // 只被定义一次的寄存器
+    std::unordered_set<std::string> params;
+    std::unordered_set<std::string> captured; // 地址逃逸的 alloca
+    std::unordered_map<std::string, MemoryLocation> cache; // 指针寄存器 -> 位置（不含 size）
+
+    bool is_ssa_value(const std::string &reg) const {
+        return defs.contains(reg) || params.contains(reg);
+    }
+
+    // 把下标拆成"寄存器 + 常量"，沿 add/sub 立即数向上追；返回的寄存器为空表示常量下标
+    std::pair<std::string, long> split_index(const IROperand &idx) const {
+        if (idx.op_type == IROperandType::IMM) return { "", idx.imm_value };
+        std::string reg = idx.name;
+        long c = 0;
+        for (int depth = 0; depth < 8; ++depth) {
+            auto it = defs.find(reg);
+            if (it == defs.end()) break;
+            const IRInstruction &inst = *it->second;
+            const auto &args = inst.args;
+            if (inst.op == IROp::ADD && args[1].op_type == IROperandType::IMM &&
+                args[0].op_type == IROperandType::REG) {
+                c += args[1].imm_value;
+                reg = args[0].name;
+            } else if (inst.op == IROp::ADD && args[0].op_type == IROperandType::IMM &&
+                       args[1].op_type == IROperandType::REG) {
+                c += args[0].imm_value;
+                reg = args[1].name;
+            } else if (inst.op == IROp::SUB && args[1].op_type == IROperandType::IMM &&
+                       args[0].op_type == IROperandType::REG) {
+                c -= args[1].imm_value;
+                reg = args[0].name;
+            } else {
+                break;
+            }
+        }
+        return { reg, c };
+    }
+
+    static void add_term(MemoryLocation &loc, const std::string &reg, long scale) {
+        auto it = std::lower_bound(loc.terms.begin(), loc.terms.end(), reg,
+                                   [](const auto &t, const std::string &r) { return t.first < r; });
+        if (it != loc.terms.end() && it->first == reg) {
+            it->second += scale;
+            if (it->second == 0) loc.terms.erase(it);
+        } else if (scale != 0) {
+            loc.terms.insert(it, { reg, scale });
+        }
+    }
+
+    // root 是最初查询的指针：被多次定义的寄存器（dessa 之后）在不同位置取值不同，
+    // 只能以 root 自身为基对象，避免两个不同的指针被误认为偏移可比
+    MemoryLocation compute(const IROperand &ptr, const std::string &root) const {
+        MemoryLocation loc;
+        loc.base = ptr.to_string();
+        if (ptr.op_type == IROperandType::GLOBAL) {
+            loc.kind = MemoryLocation::BaseKind::Global;
+            return loc;
+        }
+        if (ptr.op_type != IROperandType::REG) return loc;
+
+        auto it = defs.find(ptr.name);
+        if (it == defs.end()) {
+            if (params.contains(ptr.name)) {
+                loc.kind = MemoryLocation::BaseKind::Argument;
+            } else {
+                loc.base = "?" + root;
+            }
+            return loc;
+        }
+        const IRInstruction &inst = *it->second;
+        if (inst.op == IROp::ALLOCA) {
+            loc.kind = MemoryLocation::BaseKind::Alloca;
+            return loc;
+        }
+        if (inst.op == IROp::MOVE) return compute(inst.args[0], root);
+        if (inst.op != IROp::GEP || !inst.args[0].type->is_pointer()) return loc;
+
+        // GEP base, idx1, idx2, ...：第一个下标按整个所指类型计，之后逐层进入数组元素或结构体字段
+        MemoryLocation base = compute(inst.args[0], root);
+        IRType *type = inst.args[0].type->get_pointee_type();
+        for (size_t i = 1; i < inst.args.size(); ++i) {
+            const IROperand &idx = inst.args[i];
+            if (i > 1 && type->is_struct()) {
+                if (idx.op_type != IROperandType::IMM) return loc;
+                long field = type->get_field_offset(idx.imm_value);
+                base.offset += field;
+                base.min_offset += field;
+                base.max_offset += field;
+                type = type->get_field_type_by_index(idx.imm_value);
+                continue;
+            }
+            long count = -1; // 数组长度，用于界定变量下标的范围
+            long scale;
+            if (i == 1) {
+                scale = type->size();
+            } else if (type->is_array()) {
+                count = type->get_array_size();
+                type = type->get_array_element_type();
+                scale = type->size();
+            } else {
+                return loc;
+            }
+
+            auto [reg, c] = split_index(idx);
+            base.offset += c * scale;
+            if (reg.empty()) {
+                base.min_offset += c * scale;
+                base.max_offset += c * scale;
+                continue;
+            }
+            add_term(base, is_ssa_value(reg) ? reg : "?" + root, scale);
+            if (count > 0) {
+                base.max_offset += (count - 1) * scale;
+            } else {
+                base.bounded = false;
+            }
+        }
+        return base;
+    }
+
+    // 从 alloca 出发沿 GEP 追踪派生的指针，除了作为 load/store 的地址以外的任何使用都算逃逸
+    void compute_captured() {
+        std::unordered_map<std::string, std::vector<std::pair<const IRInstruction *, size_t>>>
+            uses;
+        std::vector<std::string> allocas;
+        for (const auto &block : F.blocks) {
+            for (const auto &inst : block->insts) {
+                if (inst.op == IROp::ALLOCA && inst.result) allocas.push_back(inst.result->name);
+                for (size_t i = 0; i < inst.args.size(); ++i) {
+                    if (inst.args[i].op_type == IROperandType::REG) {
+                        uses[inst.args[i].name].push_back({ &inst, i });
+                    }
+                }
+            }
+        }
+
+        for (const auto &alloca : allocas) {
+            std::vector<std::string> worklist{ alloca };
+            std::unordered_set<std::string> visited{ alloca };
+            bool escapes = false;
+            while (!worklist.empty() && !escapes) {
+                std::string reg = worklist.back();
+                worklist.pop_back();
+                for (auto [user, index] : uses[reg]) {
+                    if ((user->op == IROp::LOAD && index == 0) ||
+                        (user->op == IROp::STORE && index == 1)) {
+                        continue;
+                    }
+                    if (user->op == IROp::GEP && index == 0 && user->result) {
+                        if (visited.insert(user->result->name).second) {
+                            worklist.push_back(user->result->name);
+                        }
+                        continue;
+                    }
+                    escapes = true;
+                    break;
+                }
+            }
+            if (escapes) captured.insert(alloca);
+        }
+    }
+
+    int class_of(const std::string &name) const {
+        auto it = F.points_to_class.find(name);
+        return it == F.points_to_class.end() ? -1 : it->second;
+    }
+
+    // [lo1, hi1) 与 [lo2, hi2) 不相交；size 未知时区间延伸到无穷
+    static bool disjoint(long lo1, long size1, long lo2, long size2) {
+        long hi1 = size1 == MemoryLocation::UNKNOWN_SIZE ? LONG_MAX : lo1 + size1;
+        long hi2 = size2 == MemoryLocation::UNKNOWN_SIZE ? LONG_MAX : lo2 + size2;
+        return hi1 <= lo2 || hi2 <= lo1;
+    }
+
+    static long access_size(IRType *ptr_type) {
+        IRType *t = ptr_type->is_pointer() ? ptr_type->get_pointee_type() : nullptr;
+        if (t && (t->is_int() || t->is_char() || t->is_pointer())) return t->size();
+        return MemoryLocation::UNKNOWN_SIZE;
+    }
+
+  public:
+    explicit AliasAnalysis(IRFunction &F) : F(F) {
+        std::unordered_map<std::string, int> def_count;
+        for (const auto &block : F.blocks) {
+            for (const auto &inst : block->insts) {
+                if (!inst.result) continue;
+                defs[inst.result->name] = &inst;
+                def_count[inst.result->name]++;
+            }
+        }
+        for (const auto &[reg, n] : def_count) {
+            if (n > 1) defs.erase(reg);
+        }
+        for (const auto &param : F.params) {
+            if (!def_count.contains(param.name)) params.insert(param.name);
+        }
+        compute_captured();
+    }
+
+    // 通过 ptr 访问 size 个字节的内存区域
+    MemoryLocation location(const IROperand &ptr, long size) {
+        MemoryLocation loc;
+        if (ptr.op_type == IROperandType::REG) {
+            auto it = cache.find(ptr.name);
+            if (it == cache.end()) it = cache.emplace(ptr.name, compute(ptr, ptr.name)).first;
+            loc = it->second;
+        } else {
+            loc = compute(ptr, ptr.to_string());
+        }
+        loc.size = size;
+        return loc;
+    }
+
+    // load / store / output_str 访问的内存区域
+    MemoryLocation location(const IRInstruction &inst) {
+        switch (inst.op) {
+            case IROp::LOAD: return location(inst.args[0], access_size(inst.args[0].type));
+            case IROp::STORE: return location(inst.args[1], access_size(inst.args[1].type));
+            case IROp::OUTPUT_STR: return location(inst.args[0], MemoryLocation::UNKNOWN_SIZE);
+            default: throw std::runtime_error("instruction does not access memory directly");
+        }
+    }
+
+    // alloca 的地址是否逃逸（传给函数、存入内存、参与运算或进入 PHI）
+    bool is_captured(const std::string &alloca) const {
+        return captured.contains(alloca);
+    }
+
+    AliasResult alias(const MemoryLocation &a, const MemoryLocation &b) const {
+        if (a.kind != b.kind || a.base != b.base) {
+            if (a.is_identified() && b.is_identified()) return AliasResult::NoAlias;
+            // 地址没有逃逸的 alloca 只能经由从它派生的指针访问
+            if (a.kind == MemoryLocation::BaseKind::Alloca && !captured.contains(a.base)) {
+                return AliasResult::NoAlias;
+            }
+            if (b.kind == MemoryLocation::BaseKind::Alloca && !captured.contains(b.base)) {
+                return AliasResult::NoAlias;
+            }
+            int ca = class_of(a.base), cb = class_of(b.base);
+            if (ca >= 0 && cb >= 0 && ca != cb) return AliasResult::NoAlias;
+            return AliasResult::MayAlias;
+        }
+
+        // 同一基对象：变量部分相同时只差常量偏移，否则退回比较下标范围
+        if (a.terms == b.terms) {
+            if (disjoint(a.offset, a.size, b.offset, b.size)) return AliasResult::NoAlias;
+            if (a.offset == b.offset && a.size == b.size) return AliasResult::MustAlias;
+            return AliasResult::PartialAlias;
+        }
+        if (a.bounded && b.bounded) {
+            long size_a = a.size == MemoryLocation::UNKNOWN_SIZE
+                              ? a.size
+                              : a.max_offset - a.min_offset + a.size;
+            long size_b = b.size == MemoryLocation::UNKNOWN_SIZE
+                              ? b.size
+                              : b.max_offset - b.min_offset + b.size;
+            if (disjoint(a.min_offset, size_a, b.min_offset, size_b)) return AliasResult::NoAlias;
+        }
+        return AliasResult::MayAlias;
+    }
+
+    bool may_alias(const MemoryLocation &a, const MemoryLocation &b) const {
+        return alias(a, b) != AliasResult::NoAlias;
+    }
+
+    bool may_alias(const IRInstruction &a, const IRInstruction &b) {
+        return may_alias(location(a), location(b));
+    }
+
+    // 指令 inst 对内存区域 loc 的影响
+    ModRefInfo get_mod_ref(const IRInstruction &inst, const MemoryLocation &loc) {
+        switch (inst.op) {
+            case IROp::LOAD:
+            case IROp::OUTPUT_STR:
+                return may_alias(location(inst), loc) ? ModRefInfo::Ref : ModRefInfo::NoModRef;
+            case IROp::STORE:
+                return may_alias(location(inst), loc) ? ModRefInfo::Mod : ModRefInfo::NoModRef;
+            case IROp::CALL: {
+                // 被调函数只能经由参数、全局变量或从它们读出的指针访问内存
+                if (loc.kind == MemoryLocation::BaseKind::Alloca && !captured.contains(loc.base)) {
+                    return ModRefInfo::NoModRef;
+                }
+                // 有副作用摘要时，只有 loc 所在的指向等价类被读 / 写才算
+                const FunctionSummary *s = F.callee_summary(inst);
+                if (!s) return ModRefInfo::ModRef;
+                int c = class_of(loc.base);
+                bool ref = s->may_read() &&
+                           (c < 0 || s->reads_unknown || s->read_classes.contains(c));
+                bool mod = s->may_write() &&
+                           (c < 0 || s->writes_unknown || s->write_classes.contains(c));
+                return static_cast<ModRefInfo>((ref ? 1 : 0) | (mod ? 2 : 0));
+            }
+            default: return ModRefInfo::NoModRef;
+        }
+    }
+
+    // 指令 inst 对指令 mem（load / store / output_str）所访问内存的影响
+    ModRefInfo get_mod_ref(const IRInstruction &inst, const IRInstruction &mem) {
+        return get_mod_ref(inst, location(mem));
+    }
+};
+
+// 两两打印函数中 load / store 所用地址的别名关系（到标准错误），不修改 IR
+class PrintAliasPass : public FunctionPass {
+  public:
+    const char *name() const override {
+        return "print-alias";
+    }
+
+    bool run(IRFunction &F) override {
+        AliasAnalysis aa(F);
+        std::vector<MemoryLocation> locs;
+        std::vector<std::string> names;
+        std::unordered_set<std::string> seen;
+        for (const auto &block : F.blocks) {
+            for (const auto &inst : block->insts) {
+                if (inst.op != IROp::LOAD && inst.op != IROp::STORE) continue;
+                const IROperand &ptr = inst.op == IROp::LOAD ? inst.args[0] : inst.args[1];
+                if (!seen.insert(ptr.to_string()).second) continue;
+                locs.push_back(aa.location(inst));
+                names.push_back(ptr.to_string());
+            }
+        }
+
+        std::ostringstream os;
+        os << "Alias results for " << F.name << ":\n";
+        for (size_t i = 0; i < locs.size(); ++i) {
+            for (size_t j = i + 1; j < locs.size(); ++j) {
+                AliasResult r = aa.alias(locs[i], locs[j]);
+                os << "  " << alias_result_name(r) << ": " << names[i] << ", " << names[j]
+                   << "\n";
+                switch (r) {
+                    case AliasResult::NoAlias: add_stat("no-alias pairs"); break;
+                    case AliasResult::MayAlias: add_stat("may-alias pairs"); break;
+                    case AliasResult::PartialAlias: add_stat("partial-alias pairs"); break;
+                    case AliasResult::MustAlias: add_stat("must-alias pairs"); break;
+                }
+            }
+        }
+        trace_out() << os.str();
+        return false;
+    }
+};
@@ -0,0 +1,370 @@
+#pragma once
+
+#include "ir.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ========================================================
+// --- 位向量数据流框架 ---
+// 基本块按逆后序稠密编号，集合用按字打包的位向量表示，
+// gen/kill 形式的前向/后向问题用逆后序工作表求解到不动点。
+// ========================================================
+
+// 稠密位向量：按 64 位字存储，并/交/差都是逐字操作
+class BitVector {
+  private:
+    std::vector<uint64_t> words;
+    size_t nbits = 0;
+
+    static constexpr size_t WORD_BITS = 64;
+
+    void clear_tail() {
+        if (nbits % WORD_BITS) words.back() &= (uint64_t(1) << (nbits % WORD_BITS)) - 1;
+    }
+
+  public:
+    BitVector() = default;
+    explicit BitVector(size_t n, bool value = false)
+        : words((n + WORD_BITS - 1) / WORD_BITS, value ? ~uint64_t(0) : 0), nbits(n) {
+        clear_tail();
+    }
+
+    size_t size() const {
+        return nbits;
+    }
+
+    void set(size_t i) {
+        words[i / WORD_BITS] |= uint64_t(1) << (i % WORD_BITS);
+    }
+    void reset(size_t i) {
+        words[i / WORD_BITS] &= ~(uint64_t(1) << (i % WORD_BITS));
+    }
+    bool test(size_t i) const {
+        return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    // 以下集合运算返回 true 表示本集合发生了变化
+    bool union_with(const BitVector &o) {
+        uint64_t changed = 0;
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t v = words[w] | o.words[w];
+            changed |= v ^ words[w];
+            words[w] = v;
+        }
+        return changed != 0;
+    }
+    bool intersect_with(const BitVector &o) {
+        uint64_t changed = 0;
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t v = words[w] & o.words[w];
+            changed |= v ^ words[w];
+            words[w] = v;
+        }
+        return changed != 0;
+    }
+    bool subtract(const BitVector &o) {
+        uint64_t changed = 0;
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t v = words[w] & ~o.words[w];
+            changed |= v ^ words[w];
+            words[w] = v;
+        }
+        return changed != 0;
+    }
+
+    // *this = gen | (in & ~kill)，即 gen/kill 问题的传递函数
+    void assign_transfer(const BitVector &gen, const BitVector &in, const BitVector &kill) {
+        for (size_t w = 0; w < words.size(); ++w) {
+            words[w] = gen.words[w] | (in.words[w] & ~kill.words[w]);
+        }
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t w : words) n += std::popcount(w);
+        return n;
+    }
+    bool any() const {
+        return std::any_of(words.begin(), words.end(), [](uint64_t w) { return w != 0; });
+    }
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+                fn(w * WORD_BITS + std::countr_zero(bits));
+            }
+        }
+    }
+
+    bool operator==(const BitVector &o) const = default;
+};
+
+// 稀疏位向量：只按序保存非零字 (字下标, 字)。
+// 全集很大而每个集合只有少量元素时（例如大函数的活跃寄存器）比稠密表示省内存，
+// 接口与 BitVector 相同，可以直接作为求解器的集合类型
+class SparseBitVector {
+  private:
+    std::vector<std::pair<uint32_t, uint64_t>> elems;
+    size_t nbits = 0;
+
+    static constexpr size_t WORD_BITS = 64;
+
+    std::vector<std::pair<uint32_t, uint64_t>>::iterator find_word(uint32_t w) {
+        return std::lower_bound(elems.begin(), elems.end(), w,
+                                [](const auto &e, uint32_t key) { return e.first < key; });
+    }
+    std::vector<std::pair<uint32_t, uint64_t>>::const_iterator find_word(uint32_t w) const {
+        return std::lower_bound(elems.begin(), elems.end(), w,
+                                [](const auto &e, uint32_t key) { return e.first < key; });
+    }
+
+    // 两个有序字序列的归并，op(a, b) 给出结果字，空字丢弃
+    template <typename Op>
+    bool merge(const std::vector<std::pair<uint32_t, uint64_t>> &other, Op op) {
+        std::vector<std::pair<uint32_t, uint64_t>> out;
+        out.reserve(elems.size() + other.size());
+        size_t i = 0, j = 0;
+        while (i < elems.size() || j < other.size()) {
+            uint32_t w;
+            uint64_t a = 0, b = 0;
+            if (j == other.size() || (i < elems.size() && elems[i].first < other[j].first)) {
+                w = elems[i].first;
+                a = elems[i++].second;
+            } else if (i == elems.size() || other[j].first < elems[i].first) {
+                w = other[j].first;
+                b = other[j++].second;
+            } else {
+                w = elems[i].first;
+                a = elems[i++].second;
+                b = other[j++].second;
+            }
+            if (uint64_t v = op(a, b)) out.push_back({ w, v });
+        }
+        bool changed = out != elems;
+        elems = std::move(out);
+        return changed;
+    }
+
+  public:
+    SparseBitVector() = default;
+    explicit SparseBitVector(size_t n, bool value = false) : nbits(n) {
+        if (!value) return;
+        for (size_t w = 0; w * WORD_BITS < n; ++w) {
+            size_t rest = n - w * WORD_BITS;
+            uint64_t bits = rest >= WORD_BITS ? ~uint64_t(0) : (uint64_t(1) << rest) - 1;
+            elems.push_back({ static_cast<uint32_t>(w), bits });
+        }
+    }
+
+    size_t size() const {
+        return nbits;
+    }
+
+    void set(size_t i) {
+        auto w = static_cast<uint32_t>(i / WORD_BITS);
+        auto it = find_word(w);
+        if (it == elems.end() || it->first != w) it = elems.insert(it, { w, 0 });
+        it->second |= uint64_t(1) << (i % WORD_BITS);
+    }
+    void reset(size_t i) {
+        auto w = static_cast<uint32_t>(i / WORD_BITS);
+        auto it = find_word(w);
+        if (it == elems.end() || it->first != w) return;
+        it->second &= ~(uint64_t(1) << (i % WORD_BITS));
+        if (!it->second) elems.erase(it);
+    }
+    bool test(size_t i) const {
+        auto w = static_cast<uint32_t>(i / WORD_BITS);
+        auto it = find_word(w);
+        return it != elems.end() && it->first == w && ((it->second >> (i % WORD_BITS)) & 1);
+    }
+
+    bool union_with(const SparseBitVector &o) {
+        return merge(o.elems, [](uint64_t a, uint64_t b) { return a | b; });
+    }
+    bool intersect_with(const SparseBitVector &o) {
+        return merge(o.elems, [](uint64_t a, uint64_t b) { return a & b; });
+    }
+    bool subtract(const SparseBitVector &o) {
+        return merge(o.elems, [](uint64_t a, uint64_t b) { return a & ~b; });
+    }
+
+    void assign_transfer(const SparseBitVector &gen, const SparseBitVector &in,
+                         const SparseBitVector &kill) {
+        *this = in;
+        subtract(kill);
+        union_with(gen);
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (const auto &e : elems) n += std::popcount(e.second);
+        return n;
+    }
+    bool any() const {
+        return !elems.empty();
+    }
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (const auto &[w, word] : elems) {
+            for (uint64_t bits = word; bits; bits &= bits - 1) {
+                fn(size_t(w) * WORD_BITS + std::countr_zero(bits));
+            }
+        }
+    }
+
+    bool operator==(const SparseBitVector &o) const = default;
+};
+
+// 基本块的稠密编号：按逆后序排列，入口为 0，不可达块排在最后
+class BlockNumbering {
+  private:
+    std::vector<IRBasicBlock *> order;
+    std::unordered_map<const IRBasicBlock *, int> index;
+    size_t reachable = 0;
+
+  public:
+    explicit BlockNumbering(const IRFunction &F) {
+        if (F.blocks.empty()) return;
+        index.reserve(F.blocks.size());
+
+        // 迭代 DFS 求后序
+        std::vector<IRBasicBlock *> postorder;
+        std::unordered_map<const IRBasicBlock *, bool> visited;
+        visited.reserve(F.blocks.size());
+        std::vector<std::pair<IRBasicBlock *, size_t>> work{ { F.blocks.front().get(), 0 } };
+        visited[F.blocks.front().get()] = true;
+        while (!work.empty()) {
+            auto &[block, next] = work.back();
+            if (next == block->successors.size()) {
+                postorder.push_back(block);
+                work.pop_back();
+                continue;
+            }
+            IRBasicBlock *succ = block->successors[next++];
+            if (visited[succ]) continue;
+            visited[succ] = true;
+            work.push_back({ succ, 0 });
+        }
+
+        order.assign(postorder.rbegin(), postorder.rend());
+        reachable = order.size();
+        for (const auto &block : F.blocks) {
+            if (!visited[block.get()]) order.push_back(block.get());
+        }
+        for (size_t i = 0; i < order.size(); ++i) index[order[i]] = static_cast<int>(i);
+    }
+
+    size_t size() const {
+        return order.size();
+    }
+    size_t reachable_size() const {
+        return reachable;
+    }
+    int operator[](const IRBasicBlock *block) const {
+        return index.at(block);
+    }
+    IRBasicBlock *block(size_t i) const {
+        return order[i];
+    }
+    const std::vector<IRBasicBlock *> &blocks() const {
+        return order;
+    }
+};
+
+enum class DataflowDirection { Forward, Backward };
+enum class DataflowMeet { Union, Intersect };
+
+// gen/kill 形式的数据流问题，gen/kill 按块编号索引
+template <typename Set = BitVector> struct GenKillProblem {
+    DataflowDirection direction = DataflowDirection::Forward;
+    DataflowMeet meet = DataflowMeet::Union;
+    size_t universe = 0;
+    std::vector<Set> gen, kill;
+    Set boundary; // 入口块的 in（前向）或无后继块的 out（后向），默认空集
+};
+
+template <typename Set = BitVector> struct DataflowResult {
+    std::vector<Set> in, out; // 按块编号索引，in/out 总是指程序执行顺序上的块入口/出口
+    size_t visits = 0;        // 传递函数的求值次数
+};
+
+/**
+ * @brief 用逆后序工作表求解 gen/kill 问题
+ * 前向问题按逆后序、后向问题按后序扫描，只重新计算输入发生变化的块；
+ * 并集问题初始为空集，交集问题初始为全集（边界除外）
+ */
+template <typename Set>
+DataflowResult<Set> solve_dataflow(const BlockNumbering &numbering,
+                                   const GenKillProblem<Set> &problem) {
+    const size_t n = numbering.size();
+    const bool forward = problem.direction == DataflowDirection::Forward;
+    const bool meet_union = problem.meet == DataflowMeet::Union;
+
+    DataflowResult<Set> result;
+    result.in.assign(n, Set(problem.universe, !meet_union));
+    result.out.assign(n, Set(problem.universe, !meet_union));
+    if (n == 0) return result;
+
+    // 统一成“沿 flow 边传播”：前向的 flow 前驱是 CFG 前驱，后向的是 CFG 后继
+    auto &before = forward ? result.in : result.out; // 传递函数的输入
+    auto &after = forward ? result.out : result.in;  // 传递函数的输出
+    auto flow_preds = [&](IRBasicBlock *b) -> const std::vector<IRBasicBlock *> & {
+        return forward ? b->predecessors : b->successors;
+    };
+    auto flow_succs = [&](IRBasicBlock *b) -> const std::vector<IRBasicBlock *> & {
+        return forward ? b->successors : b->predecessors;
+    };
+
+    // 扫描顺序：前向为逆后序，后向为后序；pos(b) 是块 b 在一轮扫描中的位置
+    auto pos = [&](int b) { return forward ? b : static_cast<int>(n) - 1 - b; };
+
+    const Set boundary =
+        problem.boundary.size() == problem.universe ? problem.boundary : Set(problem.universe);
+    std::vector<char> dirty(n, 1);
+    bool again = true;
+    Set next(problem.universe);
+    while (again) {
+        again = false;
+        for (size_t k = 0; k < n; ++k) {
+            int b = static_cast<int>(forward ? k : n - 1 - k);
+            if (!dirty[b]) continue;
+            dirty[b] = 0;
+            IRBasicBlock *block = numbering.block(b);
+            const auto &preds = flow_preds(block);
+
+            // meet
+            if (forward ? b == 0 : preds.empty()) {
+                before[b] = boundary;
+            } else if (!preds.empty()) {
+                before[b] = after[numbering[preds.front()]];
+                for (size_t p = 1; p < preds.size(); ++p) {
+                    if (meet_union) {
+                        before[b].union_with(after[numbering[preds[p]]]);
+                    } else {
+                        before[b].intersect_with(after[numbering[preds[p]]]);
+                    }
+                }
+            }
+
+            // transfer
+            next.assign_transfer(problem.gen[b], before[b], problem.kill[b]);
+            result.visits++;
+            if (next == after[b]) continue;
+            std::swap(after[b], next);
+
+            for (IRBasicBlock *s : flow_succs(block)) {
+                int si = numbering[s];
+                dirty[si] = 1;
+                // 本轮还没扫到的块会在本轮处理，已经扫过的（回边）要再来一轮
+                if (pos(si) <= pos(b)) again = true;
+            }
+        }
+    }
+    return result;
+}
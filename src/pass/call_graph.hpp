@@ -0,0 +1,288 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/alias_analysis.hpp"
+#include "pass/dom_analysis.hpp"
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 调用图与过程间副作用摘要 ---
+// 在整个模块上建立调用图，用 Tarjan 算法求强连通分量（得到的顺序恰好是自底向上的），
+// 再按分量从被调函数到调用者合并每个函数的摘要：读写了哪些全局变量 / 指针参数所指的内存、
+// 是否做 I/O、是否总会返回。内存效果借助 PointsToPass 的等价类，因此要在它之后运行。
+// ========================================================
+
+class CallGraphPass : public ModulePass {
+  private:
+    std::shared_ptr<CallGraph> graph;
+    std::unordered_map<std::string, IRFunction *> funcs;
+    std::unordered_set<std::string> calls_external; // 调用了模块外（未知）函数的函数
+    std::unordered_set<std::string> acyclic;        // CFG 无环的函数
+
+    // Tarjan 的状态
+    std::unordered_map<std::string, int> index, lowlink;
+    std::vector<std::string> stack;
+    std::unordered_set<std::string> on_stack;
+    int next_index = 0;
+
+    void strongconnect(const std::string &fn) {
+        index[fn] = lowlink[fn] = next_index++;
+        stack.push_back(fn);
+        on_stack.insert(fn);
+        for (const auto &callee : graph->nodes[fn].callees) {
+            if (!index.contains(callee)) {
+                strongconnect(callee);
+                lowlink[fn] = std::min(lowlink[fn], lowlink[callee]);
+            } else if (on_stack.contains(callee)) {
+                lowlink[fn] = std::min(lowlink[fn], index[callee]);
+            }
+        }
+        if (lowlink[fn] != index[fn]) return;
+
+        std::vector<std::string> scc;
+        std::string member;
+        do {
+            member = stack.back();
+            stack.pop_back();
+            on_stack.erase(member);
+            graph->nodes[member].scc = graph->sccs.size();
+            scc.push_back(member);
+        } while (member != fn);
+        graph->sccs.push_back(std::move(scc));
+    }
+
+    // 沿后继做 DFS，遇到仍在栈上的块即有回边
+    static bool has_cycle(IRFunction &F) {
+        if (F.blocks.empty()) return false;
+        enum : char { WHITE, GREY, BLACK };
+        std::unordered_map<IRBasicBlock *, char> color;
+        std::vector<std::pair<IRBasicBlock *, size_t>> dfs{ { F.blocks.front().get(), 0 } };
+        color[F.blocks.front().get()] = GREY;
+        while (!dfs.empty()) {
+            auto &[block, next] = dfs.back();
+            if (next == block->successors.size()) {
+                color[block] = BLACK;
+                dfs.pop_back();
+                continue;
+            }
+            IRBasicBlock *succ = block->successors[next++];
+            if (color[succ] == GREY) return true;
+            if (color[succ] == WHITE) {
+                color[succ] = GREY;
+                dfs.push_back({ succ, 0 });
+            }
+        }
+        return false;
+    }
+
+    // 函数自身（不含被调函数）的效果；只在本函数内可见的局部变量不算
+    FunctionSummary local_summary(IRFunction &F) {
+        FunctionSummary s;
+        AliasAnalysis aa(F);
+        auto record = [&](const MemoryLocation &loc, bool write) {
+            if (loc.kind == MemoryLocation::BaseKind::Alloca && !aa.is_captured(loc.base)) return;
+            auto it = F.points_to_class.find(loc.base);
+            if (it == F.points_to_class.end()) {
+                (write ? s.writes_unknown : s.reads_unknown) = true;
+                return;
+            }
+            (write ? s.write_classes : s.read_classes).insert(it->second);
+        };
+
+        bool returns_seen = false, same_constant = true;
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                switch (inst.op) {
+                    case IROp::LOAD:
+                    case IROp::OUTPUT_STR: record(aa.location(inst), false); break;
+                    case IROp::STORE: record(aa.location(inst), true); break;
+                    case IROp::INPUT_I32:
+                    case IROp::INPUT_I8: s.does_input = true; break;
+                    default: break;
+                }
+                if (inst.op == IROp::OUTPUT_I32 || inst.op == IROp::OUTPUT_I8 ||
+                    inst.op == IROp::OUTPUT_STR) {
+                    s.does_output = true;
+                }
+                if (inst.op != IROp::RET || inst.args.empty()) continue;
+                const IROperand &value = inst.args[0];
+                if (value.op_type != IROperandType::IMM ||
+                    (returns_seen && s.return_constant != value.imm_value)) {
+                    same_constant = false;
+                }
+                if (!returns_seen) s.return_constant = value.imm_value;
+                returns_seen = true;
+            }
+        }
+        if (!returns_seen || !same_constant) s.return_constant.reset();
+        return s;
+    }
+
+    // 把被调函数的效果并入 into，返回 into 是否变化
+    static bool merge(FunctionSummary &into, const FunctionSummary &from) {
+        size_t before = into.read_classes.size() + into.write_classes.size();
+        bool flags = into.reads_unknown || into.writes_unknown || into.does_input ||
+                     into.does_output;
+        into.read_classes.insert(from.read_classes.begin(), from.read_classes.end());
+        into.write_classes.insert(from.write_classes.begin(), from.write_classes.end());
+        into.reads_unknown |= from.reads_unknown;
+        into.writes_unknown |= from.writes_unknown;
+        into.does_input |= from.does_input;
+        into.does_output |= from.does_output;
+        bool flags_after = into.reads_unknown || into.writes_unknown || into.does_input ||
+                           into.does_output;
+        return into.read_classes.size() + into.write_classes.size() != before ||
+               flags != flags_after;
+    }
+
+    // 调用模块外的函数：什么都可能发生
+    static void make_opaque(FunctionSummary &s) {
+        s.reads_unknown = s.writes_unknown = true;
+        s.does_input = s.does_output = true;
+        s.always_returns = false;
+    }
+
+    // 把等价类形式的效果展开成全局变量名和参数下标
+    static void expand(FunctionSummary &s, const IRFunction &F, const IRModule &M) {
+        auto covers = [&](const std::set<int> &classes, bool unknown, const std::string &name) {
+            auto it = F.points_to_class.find(name);
+            return unknown || (it != F.points_to_class.end() && classes.contains(it->second));
+        };
+        for (const auto &g : M.globals) {
+            if (covers(s.read_classes, s.reads_unknown, g.name)) s.reads_globals.insert(g.name);
+            if (covers(s.write_classes, s.writes_unknown, g.name)) s.writes_globals.insert(g.name);
+        }
+        for (unsigned i = 0; i < F.params.size(); ++i) {
+            if (!F.params[i].type->is_pointer()) continue;
+            const std::string &p = F.params[i].name;
+            if (covers(s.read_classes, s.reads_unknown, p)) s.reads_args.insert(i);
+            if (covers(s.write_classes, s.writes_unknown, p)) s.writes_args.insert(i);
+        }
+    }
+
+  public:
+    bool run(IRModule &M) override {
+        graph = std::make_shared<CallGraph>();
+        funcs.clear();
+        calls_external.clear();
+        acyclic.clear();
+        index.clear();
+        lowlink.clear();
+        stack.clear();
+        on_stack.clear();
+        next_index = 0;
+
+        for (auto &F : M.functions) {
+            funcs[F.name] = &F;
+            graph->nodes[F.name];
+        }
+        for (auto &F : M.functions) {
+            BuildCFGPass{}.run(F);
+            if (!has_cycle(F)) acyclic.insert(F.name);
+            auto &node = graph->nodes[F.name];
+            node.summary = local_summary(F);
+            for (auto &block : F.blocks) {
+                for (auto &inst : block->insts) {
+                    if (inst.op != IROp::CALL) continue;
+                    const std::string &callee = inst.args[0].name;
+                    if (!funcs.contains(callee)) {
+                        calls_external.insert(F.name);
+                        continue;
+                    }
+                    if (callee == F.name) node.recursive = true;
+                    if (std::find(node.callees.begin(), node.callees.end(), callee) ==
+                        node.callees.end()) {
+                        node.callees.push_back(callee);
+                        graph->nodes[callee].callers.push_back(F.name);
+                    }
+                }
+            }
+        }
+
+        for (auto &F : M.functions) {
+            if (!index.contains(F.name)) strongconnect(F.name);
+        }
+
+        // 自底向上：分量内部有环时迭代到不动点
+        for (const auto &scc : graph->sccs) {
+            for (const auto &fn : scc) {
+                auto &node = graph->nodes[fn];
+                if (scc.size() > 1) node.recursive = true;
+                if (calls_external.contains(fn)) make_opaque(node.summary);
+            }
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (const auto &fn : scc) {
+                    auto &node = graph->nodes[fn];
+                    for (const auto &callee : node.callees) {
+                        changed |= merge(node.summary, graph->nodes[callee].summary);
+                    }
+                }
+            }
+            for (const auto &fn : scc) {
+                auto &node = graph->nodes[fn];
+                bool returns = !node.recursive && acyclic.contains(fn) &&
+                               !calls_external.contains(fn);
+                for (const auto &callee : node.callees) {
+                    returns = returns && graph->nodes[callee].summary.always_returns;
+                }
+                node.summary.always_returns = returns;
+            }
+        }
+
+        for (auto &F : M.functions) {
+            expand(graph->nodes[F.name].summary, F, M);
+            F.call_graph = graph;
+        }
+        return false;
+    }
+};
+
+// 打印函数在调用图中的位置和副作用摘要（到标准错误），不修改 IR
+class PrintCallGraphPass : public FunctionPass {
+  public:
+    const char *name() const override {
+        return "print-callgraph";
+    }
+
+    bool run(IRFunction &F) override {
+        if (!F.call_graph) return false;
+        const CallGraphNode &node = F.call_graph->nodes.at(F.name);
+        const FunctionSummary &s = node.summary;
+        auto list = [](auto begin, auto end, auto &&fn) {
+            std::string out;
+            for (auto it = begin; it != end; ++it) out += (out.empty() ? "" : " ") + fn(*it);
+            return out.empty() ? std::string("-") : out;
+        };
+        auto name = [](const std::string &n) { return n; };
+        auto arg = [](unsigned i) { return "arg" + std::to_string(i); };
+
+        std::ostringstream os;
+        os << "Call graph node " << F.name << " (scc " << node.scc
+           << (node.recursive ? ", recursive" : "") << "):\n";
+        os << "  calls: " << list(node.callees.begin(), node.callees.end(), name) << "\n";
+        os << "  called by: " << list(node.callers.begin(), node.callers.end(), name) << "\n";
+        os << "  reads: " << list(s.reads_globals.begin(), s.reads_globals.end(), name) << " "
+           << list(s.reads_args.begin(), s.reads_args.end(), arg)
+           << (s.reads_unknown ? " unknown" : "") << "\n";
+        os << "  writes: " << list(s.writes_globals.begin(), s.writes_globals.end(), name) << " "
+           << list(s.writes_args.begin(), s.writes_args.end(), arg)
+           << (s.writes_unknown ? " unknown" : "") << "\n";
+        os << "  io:" << (s.does_input ? " input" : "") << (s.does_output ? " output" : "")
+           << (s.does_io() ? "" : " none") << ", always returns: "
+           << (s.always_returns ? "yes" : "no");
+        if (s.return_constant) os << ", returns " << *s.return_constant;
+        os << (s.is_pure() ? ", pure" : "") << "\n";
+        trace_out() << os.str();
+        if (s.is_pure()) add_stat("pure functions");
+        return false;
+    }
+};
@@ -0,0 +1,429 @@
+#pragma once
+
+#include "bitvector_dataflow.hpp"
+#include "ir.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ========================================================
+// --- 基于位向量框架的经典数据流分析 ---
+// 活跃变量（含指令级的最后使用与寄存器压力）、到达定值、可用表达式。
+// 模板参数 Set 可以是 BitVector（默认）
+// 或 SparseBitVector（稀疏模式）。分析结果只在 IR 不变时有效。
+// ========================================================
+
+// 把名字（寄存器名、表达式键）稠密编号
+class DenseNameMap {
+  private:
+    std::unordered_map<std::string, int> index;
+    std::vector<std::string> names;
+
+  public:
+    int get_or_add(const std::string &name) {
+        auto [it, inserted] = index.try_emplace(name, static_cast<int>(names.size()));
+        if (inserted) names.push_back(name);
+        return it->second;
+    }
+    int find(const std::string &name) const {
+        auto it = index.find(name);
+        return it == index.end() ? -1 : it->second;
+    }
+    const std::string &name(size_t i) const {
+        return names[i];
+    }
+    size_t size() const {
+        return names.size();
+    }
+};
+
+/**
+ * @brief 虚拟寄存器的活跃变量分析（后向、并集）
+ * PHI 的入边值视为在对应前驱块末尾使用，PHI 的结果视为在块入口定义，
+ * 因此 live_in 不含本块 PHI 的操作数，live_out 含后继 PHI 从本块取的值
+ */
+template <typename Set = BitVector> class LivenessAnalysis {
+  private:
+    BlockNumbering numbering;
+    DenseNameMap regs;
+    DataflowResult<Set> result;
+
+  public:
+    explicit LivenessAnalysis(const IRFunction &F) : numbering(F) {
+        const size_t n = numbering.size();
+        for (const auto &param : F.params) regs.get_or_add(param.name);
+        for (IRBasicBlock *block : numbering.blocks()) {
+            for (const auto &inst : block->insts) {
+                if (inst.result) regs.get_or_add(inst.result->name);
+                for (const auto &arg : inst.args) {
+                    if (arg.op_type == IROperandType::REG) regs.get_or_add(arg.name);
+                }
+            }
+        }
+
+        // 后继 PHI 在本块末尾的使用
+        std::vector<Set> phi_uses(n, Set(regs.size()));
+        for (IRBasicBlock *block : numbering.blocks()) {
+            for (const auto &inst : block->insts) {
+                if (inst.op == IROp::LABEL) continue;
+                if (inst.op != IROp::PHI) break;
+                for (size_t i = 0; i + 1 < inst.args.size(); i += 2) {
+                    if (inst.args[i].op_type != IROperandType::REG) continue;
+                    for (IRBasicBlock *pred : block->predecessors) {
+                        if (pred->label == inst.args[i + 1].name) {
+                            phi_uses[numbering[pred]].set(regs.find(inst.args[i].name));
+                        }
+                    }
+                }
+            }
+        }
+
+        GenKillProblem<Set> problem;
+        problem.direction = DataflowDirection::Backward;
+        problem.meet = DataflowMeet::Union;
+        problem.universe = regs.size();
+        problem.gen.assign(n, Set(regs.size()));
+        problem.kill.assign(n, Set(regs.size()));
+        for (size_t b = 0; b < n; ++b) {
+            // 从块尾向前扫描：gen 是向上暴露的使用
+            Set &gen = problem.gen[b];
+            Set &kill = problem.kill[b];
+            gen = phi_uses[b];
+            const auto &insts = numbering.block(b)->insts;
+            for (auto it = insts.rbegin(); it != insts.rend(); ++it) {
+                if (it->result) {
+                    int r = regs.find(it->result->name);
+                    gen.reset(r);
+                    kill.set(r);
+                }
+                if (it->op == IROp::PHI) continue;
+                for (const auto &arg : it->args) {
+                    if (arg.op_type == IROperandType::REG) gen.set(regs.find(arg.name));
+                }
+            }
+        }
+
+        result = solve_dataflow(numbering, problem);
+        for (size_t b = 0; b < n; ++b) result.out[b].union_with(phi_uses[b]);
+    }
+
+    const BlockNumbering &blocks() const {
+        return numbering;
+    }
+    size_t num_regs() const {
+        return regs.size();
+    }
+    // 寄存器在位向量中的下标，不存在时为 -1
+    int reg_index(const std::string &name) const {
+        return regs.find(name);
+    }
+    const std::string &reg_name(size_t i) const {
+        return regs.name(i);
+    }
+
+    const Set &live_in(const IRBasicBlock *block) const {
+        return result.in[numbering[block]];
+    }
+    const Set &live_out(const IRBasicBlock *block) const {
+        return result.out[numbering[block]];
+    }
+    bool is_live_in(const std::string &reg, const IRBasicBlock *block) const {
+        int r = regs.find(reg);
+        return r >= 0 && live_in(block).test(r);
+    }
+    bool is_live_out(const std::string &reg, const IRBasicBlock *block) const {
+        int r = regs.find(reg);
+        return r >= 0 && live_out(block).test(r);
+    }
+    size_t visits() const {
+        return result.visits;
+    }
+};
+
+/**
+ * @brief 指令级活跃信息，供 dessa 之后的代码生成使用
+ * 在块级活跃变量的基础上从块尾向前扫描：记录哪些操作数在该指令处是最后一次使用、
+ * 哪些结果之后再也不会被读，以及每个块的最大寄存器压力（同一程序点上活跃的虚拟寄存器数）。
+ * 每条指令之后的活跃集合只按块现算（live_after），不为整个函数保存
+ */
+template <typename Set = BitVector> class InstructionLiveness {
+  private:
+    LivenessAnalysis<Set> liveness;
+    std::unordered_map<const IRInstruction *, std::vector<bool>> last_uses;
+    std::unordered_map<const IRInstruction *, bool> dead_results;
+    std::unordered_map<const IRBasicBlock *, size_t> pressure;
+
+    // 从块尾向前扫描，fn(inst, live) 收到的是 inst 之后的活跃集合和其中的元素个数
+    template <typename Fn> void scan(const IRBasicBlock *block, Fn &&fn) const {
+        Set live = liveness.live_out(block);
+        size_t n = live.count();
+        for (auto it = block->insts.rbegin(); it != block->insts.rend(); ++it) {
+            fn(*it, live, n);
+            if (it->result) {
+                int r = liveness.reg_index(it->result->name);
+                if (live.test(r)) {
+                    live.reset(r);
+                    n--;
+                }
+            }
+            if (it->op == IROp::PHI) continue;
+            for (const auto &arg : it->args) {
+                if (arg.op_type != IROperandType::REG) continue;
+                int r = liveness.reg_index(arg.name);
+                if (!live.test(r)) {
+                    live.set(r);
+                    n++;
+                }
+            }
+        }
+    }
+
+  public:
+    explicit InstructionLiveness(const IRFunction &F) : liveness(F) {
+        for (IRBasicBlock *block : liveness.blocks().blocks()) {
+            size_t max_live = liveness.live_in(block).count();
+            scan(block, [&](const IRInstruction &inst, const Set &live, size_t n) {
+                max_live = std::max(max_live, n);
+                if (inst.result) {
+                    dead_results[&inst] = !live.test(liveness.reg_index(inst.result->name));
+                }
+                std::vector<bool> last(inst.args.size(), false);
+                bool any = false;
+                for (size_t i = 0; i < inst.args.size(); ++i) {
+                    if (inst.args[i].op_type != IROperandType::REG) continue;
+                    last[i] = !live.test(liveness.reg_index(inst.args[i].name));
+                    any = any || last[i];
+                }
+                if (any) last_uses[&inst] = std::move(last);
+            });
+            pressure[block] = max_live;
+        }
+    }
+
+    const LivenessAnalysis<Set> &blocks() const {
+        return liveness;
+    }
+
+    // 第 i 个操作数（寄存器）在 inst 之后不再活跃
+    bool is_last_use(const IRInstruction &inst, size_t i) const {
+        auto it = last_uses.find(&inst);
+        return it != last_uses.end() && it->second[i];
+    }
+
+    // inst 的结果之后不会被读
+    bool is_dead_result(const IRInstruction &inst) const {
+        auto it = dead_results.find(&inst);
+        return it != dead_results.end() && it->second;
+    }
+
+    size_t max_pressure(const IRBasicBlock *block) const {
+        auto it = pressure.find(block);
+        return it == pressure.end() ? 0 : it->second;
+    }
+
+    // 块内每条指令之后的活跃集合，按指令顺序排列
+    std::vector<Set> live_after(const IRBasicBlock *block) const {
+        std::vector<Set> out;
+        out.reserve(block->insts.size());
+        scan(block, [&](const IRInstruction &, const Set &live, size_t) { out.push_back(live); });
+        std::reverse(out.begin(), out.end());
+        return out;
+    }
+};
+
+/**
+ * @brief 到达定值分析（前向、并集）
+ * 定值点是所有带结果的指令（dessa 之后的 MOVE 会重复定义同一寄存器）以及 STORE；
+ * STORE 以指针操作数为“变量”，只杀死对同一指针名的 STORE，不考虑别名
+ */
+template <typename Set = BitVector> class ReachingDefinitions {
+  private:
+    BlockNumbering numbering;
+    std::vector<const IRInstruction *> defs;   // 定值编号 -> 指令
+    DenseNameMap vars;                         // 被定值的寄存器 / STORE 指针
+    std::vector<Set> defs_of_var;              // 变量 -> 它的全部定值
+    DataflowResult<Set> result;
+
+    static const std::string &defined_name(const IRInstruction &inst) {
+        return inst.op == IROp::STORE ? inst.args[1].name : inst.result->name;
+    }
+    static bool is_def(const IRInstruction &inst) {
+        return inst.result || inst.op == IROp::STORE;
+    }
+
+  public:
+    explicit ReachingDefinitions(const IRFunction &F) : numbering(F) {
+        const size_t n = numbering.size();
+        std::vector<int> def_var;
+        for (IRBasicBlock *block : numbering.blocks()) {
+            for (const auto &inst : block->insts) {
+                if (!is_def(inst)) continue;
+                defs.push_back(&inst);
+                def_var.push_back(vars.get_or_add(defined_name(inst)));
+            }
+        }
+        defs_of_var.assign(vars.size(), Set(defs.size()));
+        for (size_t d = 0; d < defs.size(); ++d) defs_of_var[def_var[d]].set(d);
+
+        GenKillProblem<Set> problem;
+        problem.direction = DataflowDirection::Forward;
+        problem.meet = DataflowMeet::Union;
+        problem.universe = defs.size();
+        problem.gen.assign(n, Set(defs.size()));
+        problem.kill.assign(n, Set(defs.size()));
+        size_t d = 0;
+        for (size_t b = 0; b < n; ++b) {
+            for (const auto &inst : numbering.block(b)->insts) {
+                if (!is_def(inst)) continue;
+                const Set &same_var = defs_of_var[def_var[d]];
+                problem.gen[b].subtract(same_var);
+                problem.kill[b].union_with(same_var);
+                problem.gen[b].set(d);
+                d++;
+            }
+            // 块内自己的定值不算被杀死
+            problem.kill[b].subtract(problem.gen[b]);
+        }
+
+        result = solve_dataflow(numbering, problem);
+    }
+
+    const BlockNumbering &blocks() const {
+        return numbering;
+    }
+    size_t num_defs() const {
+        return defs.size();
+    }
+    const IRInstruction *def(size_t i) const {
+        return defs[i];
+    }
+    // 某个寄存器或 STORE 指针的全部定值；未被定值时返回空集
+    Set defs_of(const std::string &var) const {
+        int v = vars.find(var);
+        return v >= 0 ? defs_of_var[v] : Set(defs.size());
+    }
+
+    const Set &reach_in(const IRBasicBlock *block) const {
+        return result.in[numbering[block]];
+    }
+    const Set &reach_out(const IRBasicBlock *block) const {
+        return result.out[numbering[block]];
+    }
+    size_t visits() const {
+        return result.visits;
+    }
+};
+
+/**
+ * @brief 可用表达式分析（前向、交集）
+ * 表达式是 ADD/SUB/MUL/DIV（按操作码和操作数文本区分）与 LOAD（按指针区分）；
+ * 重新定义操作数寄存器会杀死表达式，STORE 和可能写内存的 CALL 保守地杀死所有 LOAD
+ */
+template <typename Set = BitVector> class AvailableExpressions {
+  private:
+    BlockNumbering numbering;
+    DenseNameMap exprs;
+    DataflowResult<Set> result;
+
+  public:
+    static bool is_expression(const IRInstruction &inst) {
+        switch (inst.op) {
+            case IROp::ADD:
+            case IROp::SUB:
+            case IROp::MUL:
+            case IROp::DIV:
+            case IROp::LOAD: return inst.result.has_value();
+            default: return false;
+        }
+    }
+
+    // 表达式的文本键，例如 "add %1 2"
+    static std::string expression_key(const IRInstruction &inst) {
+        std::string key = op_to_string(inst.op);
+        for (const auto &arg : inst.args) {
+            key += ' ';
+            key += arg.op_type == IROperandType::IMM ? std::to_string(arg.imm_value) : arg.name;
+        }
+        return key;
+    }
+
+    explicit AvailableExpressions(const IRFunction &F) : numbering(F) {
+        const size_t n = numbering.size();
+        std::vector<std::vector<int>> users; // 寄存器 -> 以它为操作数的表达式
+        DenseNameMap operand_regs;
+        for (IRBasicBlock *block : numbering.blocks()) {
+            for (const auto &inst : block->insts) {
+                if (!is_expression(inst)) continue;
+                int e = exprs.find(expression_key(inst));
+                if (e >= 0) continue;
+                e = exprs.get_or_add(expression_key(inst));
+                for (const auto &arg : inst.args) {
+                    if (arg.op_type != IROperandType::REG) continue;
+                    size_t r = operand_regs.get_or_add(arg.name);
+                    if (r == users.size()) users.emplace_back();
+                    users[r].push_back(e);
+                }
+            }
+        }
+        Set loads(exprs.size());
+        for (size_t e = 0; e < exprs.size(); ++e) {
+            if (exprs.name(e).starts_with("load ")) loads.set(e);
+        }
+
+        GenKillProblem<Set> problem;
+        problem.direction = DataflowDirection::Forward;
+        problem.meet = DataflowMeet::Intersect;
+        problem.universe = exprs.size();
+        problem.gen.assign(n, Set(exprs.size()));
+        problem.kill.assign(n, Set(exprs.size()));
+        for (size_t b = 0; b < n; ++b) {
+            Set &gen = problem.gen[b];
+            Set &kill = problem.kill[b];
+            for (const auto &inst : numbering.block(b)->insts) {
+                if (is_expression(inst)) gen.set(exprs.find(expression_key(inst)));
+                const FunctionSummary *callee = F.callee_summary(inst);
+                if (inst.op == IROp::STORE ||
+                    (inst.op == IROp::CALL && (!callee || callee->may_write()))) {
+                    gen.subtract(loads);
+                    kill.union_with(loads);
+                }
+                if (inst.result) {
+                    int r = operand_regs.find(inst.result->name);
+                    if (r < 0) continue;
+                    for (int e : users[r]) {
+                        gen.reset(e);
+                        kill.set(e);
+                    }
+                }
+            }
+        }
+
+        result = solve_dataflow(numbering, problem);
+    }
+
+    const BlockNumbering &blocks() const {
+        return numbering;
+    }
+    size_t num_expressions() const {
+        return exprs.size();
+    }
+    const std::string &expression(size_t i) const {
+        return exprs.name(i);
+    }
+    bool is_available_in(const IRInstruction &inst, const IRBasicBlock *block) const {
+        int e = exprs.find(expression_key(inst));
+        return e >= 0 && avail_in(block).test(e);
+    }
+
+    const Set &avail_in(const IRBasicBlock *block) const {
+        return result.in[numbering[block]];
+    }
+    const Set &avail_out(const IRBasicBlock *block) const {
+        return result.out[numbering[block]];
+    }
+    size_t visits() const {
+        return result.visits;
+    }
+};
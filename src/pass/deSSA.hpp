@@ -2,10 +2,14 @@
 
 #include "ir.hpp"
 #include "pass.hpp"
+#include "pass/dataflow_analyses.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/loop_clone.hpp"
 #include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -13,18 +17,128 @@
 #include <vector>
 
 class DeSSAPass : public FunctionPass {
+  private:
+    /**
+     * @brief 拆开会丢失复制的关键边
+     * 复制插在前驱末尾，会在前驱的每条出边上执行。若某个 PHI 结果在前驱另一个后继的入口
+     * 仍然活跃（如旋转后的循环 latch 同时是出口块，出口读取 header PHI 的旧值），
+     * 就把这条边拆出新块，复制只在进入 PHI 所在块时执行
+     */
+    void split_lost_copy_edges(IRFunction &F) {
+        std::unique_ptr<LivenessAnalysis<>> live;
+        std::vector<std::pair<IRBasicBlock *, IRBasicBlock *>> edges; // (前驱, PHI 所在块)
+        for (auto &block : F.blocks) {
+            std::vector<std::string> dests;
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::LABEL) continue;
+                if (inst.op != IROp::PHI) break;
+                dests.push_back(inst.result->name);
+            }
+            if (dests.empty()) continue;
+            if (!live) live = std::make_unique<LivenessAnalysis<>>(F);
+
+            for (IRBasicBlock *pred : block->predecessors) {
+                bool lost = std::any_of(
+                    pred->successors.begin(), pred->successors.end(), [&](IRBasicBlock *succ) {
+                        return succ != block.get() &&
+                               std::any_of(dests.begin(), dests.end(), [&](const std::string &d) {
+                                   return live->is_live_in(d, succ);
+                               });
+                    });
+                std::pair edge{ pred, block.get() };
+                if (lost && std::find(edges.begin(), edges.end(), edge) == edges.end()) {
+                    edges.push_back(edge);
+                }
+            }
+        }
+
+        for (auto [pred, target] : edges) {
+            split_edges(F, target, { pred }, "split" + target->label);
+        }
+        if (!edges.empty()) add_stat("critical edges split", static_cast<long>(edges.size()));
+    }
+
+    /**
+     * @brief 拆开回边块通往带 PHI 的出口的边
+     * 回边块的两个后继都有 PHI 时（旋转后的循环 latch 也是出口块），两组复制都插在块末尾，
+     * 出口那组每次迭代都白白执行一遍。把出口边拆出新块，这组复制只在离开循环时执行一次。
+     * 回边按块布局判断：后继排在前驱之前（或就是前驱本身）。每拆一条边多一个汇编标签，
+     * 因此只在函数的标签预算之内拆
+     */
+    void split_exit_copy_edges(IRFunction &F) {
+        std::unordered_map<const IRBasicBlock *, size_t> index;
+        for (size_t i = 0; i < F.blocks.size(); i++) index[F.blocks[i].get()] = i;
+        auto phis = [](IRBasicBlock *block) {
+            std::vector<IRInstruction *> out;
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::LABEL) continue;
+                if (inst.op != IROp::PHI) break;
+                out.push_back(&inst);
+            }
+            return out;
+        };
+        auto has_phi = [&](IRBasicBlock *block) { return !phis(block).empty(); };
+        // 拆开后出口的复制排在回边块的复制之后：出口 PHI 若读取别的后继的 PHI 结果，
+        // 读到的就成了新值，这样的边不能拆
+        auto reads_other_phi = [&](IRBasicBlock *pred, IRBasicBlock *exit) {
+            std::unordered_set<std::string> dests;
+            for (IRBasicBlock *succ : pred->successors) {
+                if (succ == exit) continue;
+                for (IRInstruction *phi : phis(succ)) dests.insert(phi->result->name);
+            }
+            for (IRInstruction *phi : phis(exit)) {
+                auto value = phi->incoming(pred->label);
+                if (value && value->op_type == IROperandType::REG && dests.contains(value->name)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        std::vector<std::pair<IRBasicBlock *, IRBasicBlock *>> edges; // (回边块, 出口)
+        for (auto &block : F.blocks) {
+            IRBasicBlock *pred = block.get();
+            auto &succs = pred->successors;
+            bool latch = std::any_of(succs.begin(), succs.end(), [&](IRBasicBlock *succ) {
+                return index.at(succ) <= index.at(pred) && has_phi(succ);
+            });
+            if (!latch) continue;
+            for (IRBasicBlock *succ : succs) {
+                std::pair edge{ pred, succ };
+                if (index.at(succ) <= index.at(pred) || !has_phi(succ)) continue;
+                if (reads_other_phi(pred, succ)) continue;
+                if (std::find(edges.begin(), edges.end(), edge) == edges.end()) {
+                    edges.push_back(edge);
+                }
+            }
+        }
+
+        long split = 0;
+        for (auto [pred, exit] : edges) {
+            if (F.label_budget >= 0 && asm_labels(F) >= F.label_budget) break;
+            split_edges(F, exit, { pred }, "split" + exit->label);
+            split++;
+        }
+        add_stat("exit edges split", split);
+    }
+
   public:
+    const char *name() const override {
+        return "dessa";
+    }
+
     bool run(IRFunction &F) override {
-        std::cout << "Running DeSSAPass on function: " << F.name << std::endl;
         bool ir_changed = false;
+        split_lost_copy_edges(F);
+        split_exit_copy_edges(F);
 
-        std::unordered_map<std::string, IRBasicBlock *> label_map;
-        for (auto &block : F.blocks) {
-            label_map[block->label] = block.get();
+        // 按块在函数中的位置收集复制，保证插入顺序和新寄存器编号是确定的
+        std::unordered_map<std::string, size_t> block_index;
+        for (size_t i = 0; i < F.blocks.size(); i++) {
+            block_index[F.blocks[i]->label] = i;
         }
 
-        std::unordered_map<IRBasicBlock *, std::vector<std::pair<IROperand, IROperand>>>
-            pending_copies;
+        std::vector<std::vector<std::pair<IROperand, IROperand>>> pending_copies(F.blocks.size());
 
         std::unordered_set<IRInstruction *> phis_to_delete;
 
@@ -43,10 +157,9 @@ class DeSSAPass : public FunctionPass {
                 for (size_t i = 0; i < inst.args.size(); i += 2) {
                     IROperand src = inst.args[i];
                     std::string label_name = inst.args[i + 1].name;
-                    IRBasicBlock *pred_block = label_map.at(label_name);
 
                     // 收集 (dest, src) 对
-                    pending_copies[pred_block].push_back({ dest, src });
+                    pending_copies[block_index.at(label_name)].push_back({ dest, src });
                 }
 
                 phis_to_delete.insert(&inst);
@@ -55,12 +168,26 @@ class DeSSAPass : public FunctionPass {
 
         if (!ir_changed) return false;
 
-        for (auto &[pred_block, copies] : pending_copies) {
+        for (size_t i = 0; i < F.blocks.size(); i++) {
+            const auto &copies = pending_copies[i];
+            if (copies.empty()) continue;
+            IRBasicBlock *pred_block = F.blocks[i].get();
 
-            std::vector<IRInstruction> stage1_moves; // src -> temp
+            add_stat("phi copies inserted", static_cast<long>(copies.size()));
+            std::vector<IRInstruction> stage1_moves; // src -> temp，或直接 src -> dest
             std::vector<IRInstruction> stage2_moves; // temp -> dest
 
+            // 只有目标会被同组其他复制读取时才需要经过临时寄存器；
+            // 其余复制的目标不是任何复制的源，在阶段 1 直接写入也不会影响别的读
+            std::unordered_set<std::string> sources;
             for (const auto &[dest, src] : copies) {
+                if (src.op_type == IROperandType::REG) sources.insert(src.name);
+            }
+            for (const auto &[dest, src] : copies) {
+                if (!sources.contains(dest.name)) {
+                    stage1_moves.emplace_back(IROp::MOVE, std::vector{ src }, dest);
+                    continue;
+                }
                 IROperand temp = F.new_reg(src.type);
                 stage1_moves.emplace_back(IROp::MOVE, std::vector{ src }, temp);
                 stage2_moves.emplace_back(IROp::MOVE, std::vector{ temp }, dest);
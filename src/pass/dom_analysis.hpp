@@ -15,9 +15,11 @@
 
 class DataFlowAnalysisPass : public FunctionPass {
   public:
-    bool run(IRFunction &F) override {
-        std::cout << "Running DataFlowAnalysisPass on function: " << F.name << std::endl;
+    const char *name() const override {
+        return "dataflow";
+    }
 
+    bool run(IRFunction &F) override {
         F.label_to_block_map.clear();
         F.inst_to_block_map.clear();
         F.var_def_inst_map.clear();
@@ -56,8 +58,11 @@ class DataFlowAnalysisPass : public FunctionPass {
 // --- CFG 构建 Pass ---
 class BuildCFGPass : public FunctionPass {
   public:
+    const char *name() const override {
+        return "build-cfg";
+    }
+
     bool run(IRFunction &F) override {
-        std::cout << "Running BuildCFGPass on function: " << F.name << std::endl;
         std::unordered_map<std::string, IRBasicBlock *> label_map;
         for (auto &block : F.blocks) {
             label_map[block->label] = block.get();
@@ -124,25 +129,34 @@ class BuildCFGPass : public FunctionPass {
 
 class DeadBlockEliminationPass : public FunctionPass {
   public:
+    const char *name() const override {
+        return "dead-block-elim";
+    }
+
     bool run(IRFunction &F) override {
-        std::cout << "Running DeadBlockEliminationPass on function: " << F.name << std::endl;
         bool ir_changed = false;
         if (F.blocks.empty()) return false;
 
-        while (true) {
-            std::unordered_set<IRBasicBlock *> dead_blocks;
-
-            for (auto it = F.blocks.begin() + 1; it != F.blocks.end(); ++it) {
-                if (it->get()->predecessors.empty()) {
-                    dead_blocks.insert(it->get());
-                }
-            }
-
-            if (dead_blocks.empty()) {
-                break; // 没有找到死块，退出循环
+        // 从入口块沿后继不可达的块都是死块（包括只有自身或彼此作前驱的不可达环）
+        std::unordered_set<IRBasicBlock *> reachable{ F.blocks.front().get() };
+        std::vector<IRBasicBlock *> work{ F.blocks.front().get() };
+        while (!work.empty()) {
+            IRBasicBlock *block = work.back();
+            work.pop_back();
+            for (IRBasicBlock *succ : block->successors) {
+                if (reachable.insert(succ).second) work.push_back(succ);
             }
+        }
+        std::unordered_set<IRBasicBlock *> dead_blocks;
+        for (auto &block : F.blocks) {
+            if (!reachable.contains(block.get())) dead_blocks.insert(block.get());
+        }
 
+        if (!dead_blocks.empty()) {
             ir_changed = true;
+            add_stat("blocks removed", static_cast<long>(dead_blocks.size()));
+            F.clear_loops();
+            F.clear_dominators();
 
             for (auto &block : F.blocks) {
                 block->predecessors.erase(
@@ -158,101 +172,310 @@ class DeadBlockEliminationPass : public FunctionPass {
                            F.blocks.end());
         }
 
+        // PHI 只保留来自真实前驱的入边（死块被删除、或 SCCP 折叠了分支之后）
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::LABEL) continue;
+                if (inst.op != IROp::PHI) break;
+                for (size_t i = 0; i < inst.args.size();) {
+                    bool is_pred = std::any_of(
+                        block->predecessors.begin(), block->predecessors.end(),
+                        [&](IRBasicBlock *pred) { return pred->label == inst.args[i + 1].name; });
+                    if (is_pred) {
+                        i += 2;
+                        continue;
+                    }
+                    inst.args.erase(inst.args.begin() + i, inst.args.begin() + i + 2);
+                    ir_changed = true;
+                    add_stat("phi entries pruned");
+                }
+            }
+        }
+
         return ir_changed;
     }
 };
 
+// --- Semi-NCA 支配树构建 ---
+// Georgiadis 的 SNCA 算法（与 LLVM 的 SemiNCA 相同），支配树与后支配树共用：
+// 1. 调用者从根做 DFS，给出先序编号和 DFS 树上的父节点；
+// 2. 按先序逆序求半支配点，eval 使用路径压缩；
+// 3. 按先序顺序沿已求出的 idom 链上移，直到不超过半支配点，得到 idom。
+// 全部使用迭代实现，十万级基本块也不会爆栈。
+class SemiNCA {
+  private:
+    std::vector<int> semi, label, ancestor, stack;
+
+    // 返回 v 到其所在（已处理部分）森林根路径上半支配点最小的节点，沿途做路径压缩
+    int eval(int v, int last_linked) {
+        if (ancestor[v] < last_linked) return label[v];
+
+        stack.clear();
+        int x = v;
+        do {
+            stack.push_back(x);
+            x = ancestor[x];
+        } while (ancestor[x] >= last_linked);
+
+        int p = x;
+        int p_label = label[p];
+        while (!stack.empty()) {
+            x = stack.back();
+            stack.pop_back();
+            ancestor[x] = ancestor[p];
+            if (semi[p_label] < semi[label[x]]) {
+                label[x] = p_label;
+            } else {
+                p_label = label[x];
+            }
+            p = x;
+        }
+        return label[v];
+    }
+
+  public:
+    std::vector<int> idom; // 按先序编号索引，idom[0] = 0（根）
+
+    /**
+     * @param parent DFS 树上的父节点（先序编号），parent[0] = 0
+     * @param for_each_pred for_each_pred(i, visit)：对节点 i 的每个可达前驱的先序编号调用 visit
+     */
+    template <typename PredFn> void run(const std::vector<int> &parent, PredFn &&for_each_pred) {
+        const int n = static_cast<int>(parent.size());
+        semi.resize(n);
+        label.resize(n);
+        idom = parent;
+        ancestor = parent;
+        for (int i = 0; i < n; ++i) semi[i] = label[i] = i;
+
+        // 半支配点：编号 >= i + 1 的节点已经“链接”进森林
+        for (int i = n - 1; i >= 1; --i) {
+            semi[i] = parent[i];
+            for_each_pred(i, [&](int v) { semi[i] = std::min(semi[i], semi[eval(v, i + 1)]); });
+        }
+
+        // idom：从 DFS 父节点出发沿 idom 链上移到不超过半支配点
+        for (int i = 1; i < n; ++i) {
+            int d = idom[i];
+            while (d > semi[i]) d = idom[d];
+            idom[i] = d;
+        }
+    }
+};
+
+// 迭代 DFS 给一棵树编进入/离开序号，children(node) 返回子节点列表
+template <typename ChildFn>
+inline void number_tree(IRBasicBlock *root, int &clock, ChildFn &&children,
+                        int IRBasicBlock::*in, int IRBasicBlock::*out) {
+    std::vector<std::pair<IRBasicBlock *, size_t>> work{ { root, 0 } };
+    root->*in = clock++;
+    while (!work.empty()) {
+        auto &[block, next] = work.back();
+        const auto &kids = children(block);
+        if (next == kids.size()) {
+            block->*out = clock++;
+            work.pop_back();
+            continue;
+        }
+        IRBasicBlock *child = kids[next++];
+        child->*in = clock++;
+        work.push_back({ child, 0 });
+    }
+}
+
 // --- 支配树分析 Pass ---
+// 在 CFG 上运行 Semi-NCA，最后对支配树做 DFS 编号，使 dominates(a, b) 成为 O(1) 的区间判断。
+// DFS 先序编号暂存在块的 dom_in 中（避免哈希表），最后被支配树编号覆盖。
 class DominatorTreePass : public FunctionPass {
+  private:
+    std::vector<IRBasicBlock *> vertex; // 先序编号 -> 块
+    std::vector<int> parent;
+    SemiNCA snca;
+
+    void number_blocks(IRBasicBlock *entry) {
+        // 迭代 DFS，(块, 下一个要访问的后继下标)
+        std::vector<std::pair<IRBasicBlock *, size_t>> work;
+        entry->dom_in = 0;
+        vertex.push_back(entry);
+        parent.push_back(0);
+        work.push_back({ entry, 0 });
+        while (!work.empty()) {
+            auto &[block, next] = work.back();
+            if (next == block->successors.size()) {
+                work.pop_back();
+                continue;
+            }
+            IRBasicBlock *succ = block->successors[next++];
+            if (succ->dom_in >= 0) continue;
+            succ->dom_in = static_cast<int>(vertex.size());
+            vertex.push_back(succ);
+            parent.push_back(block->dom_in);
+            work.push_back({ succ, 0 });
+        }
+    }
+
   public:
+    const char *name() const override {
+        return "domtree";
+    }
+
     bool run(IRFunction &F) override {
-        std::cout << "Running DominatorTreePass on function: " << F.name << std::endl;
         auto &blocks = F.blocks;
         if (blocks.empty()) return false;
 
-        auto entry = blocks.data()->get();
-        const auto num_blocks = blocks.size();
+        // 重新计算前清空旧的支配树
+        for (auto &block : blocks) {
+            block->idom = nullptr;
+            block->dom_child.clear();
+            block->dom_in = block->dom_out = -1;
+        }
+
+        vertex.clear();
+        parent.clear();
+        number_blocks(blocks.front().get());
+
+        snca.run(parent, [&](int i, auto &&visit) {
+            for (IRBasicBlock *pred : vertex[i]->predecessors) {
+                if (pred->dom_in >= 0) visit(pred->dom_in); // 跳过不可达的前驱
+            }
+        });
+
+        for (size_t i = 1; i < vertex.size(); ++i) {
+            IRBasicBlock *d = vertex[snca.idom[i]];
+            vertex[i]->idom = d;
+            d->dom_child.push_back(vertex[i]);
+        }
+
+        int clock = 0;
+        number_tree(
+            vertex[0], clock, [](IRBasicBlock *b) -> auto & { return b->dom_child; },
+            &IRBasicBlock::dom_in, &IRBasicBlock::dom_out);
+        return false;
+    }
+};
+
+// --- 后支配树分析 Pass ---
+// 在反向 CFG 上运行 Semi-NCA。多个 ret 块（以及所有没有后继的块）都连到一个虚拟出口，
+// 虚拟出口是后支配树的根；ipdom 为 nullptr 表示直接后支配者就是虚拟出口。
+// 无法到达出口的块（死循环）按布局逆序挑一个未访问的块连到虚拟出口，保证每个块都有后支配者。
+class PostDominatorTreePass : public FunctionPass {
+  private:
+    std::vector<IRBasicBlock *> vertex; // 先序编号 -> 块，vertex[0] 为虚拟出口（nullptr）
+    std::vector<int> parent;
+    std::unordered_map<IRBasicBlock *, int> number;
+    std::unordered_set<IRBasicBlock *> exit_roots; // 在反向图中与虚拟出口直接相连的块
+
+    void dfs_from(IRBasicBlock *root) {
+        std::vector<std::pair<IRBasicBlock *, size_t>> work;
+        number[root] = static_cast<int>(vertex.size());
+        vertex.push_back(root);
+        parent.push_back(0);
+        work.push_back({ root, 0 });
+        while (!work.empty()) {
+            auto &[block, next] = work.back();
+            if (next == block->predecessors.size()) {
+                work.pop_back();
+                continue;
+            }
+            IRBasicBlock *pred = block->predecessors[next++];
+            if (number.contains(pred)) continue;
+            number[pred] = static_cast<int>(vertex.size());
+            vertex.push_back(pred);
+            parent.push_back(number.at(block));
+            work.push_back({ pred, 0 });
+        }
+    }
+
+  public:
+    const char *name() const override {
+        return "postdomtree";
+    }
+
+    bool run(IRFunction &F) override {
+        auto &blocks = F.blocks;
+        if (blocks.empty()) return false;
 
-        std::unordered_map<IRBasicBlock *, std::unordered_set<IRBasicBlock *>>
-            dom_calc; // <d,{n}> d -> n
-        std::unordered_set<IRBasicBlock *> all_nodes;
+        for (auto &block : blocks) {
+            block->ipdom = nullptr;
+            block->pdom_child.clear();
+            block->pdom_in = block->pdom_out = -1;
+        }
 
+        vertex.assign(1, nullptr);
+        parent.assign(1, 0);
+        number.clear();
+        exit_roots.clear();
         for (auto &block : blocks) {
-            all_nodes.insert(block.get());
+            if (!block->successors.empty()) continue;
+            exit_roots.insert(block.get());
+            dfs_from(block.get());
         }
-        dom_calc.insert({ entry, { entry } });
-        auto it = blocks.begin();
-        std::advance(it, 1);
-        for (; it != blocks.end(); ++it) {
-            dom_calc.insert({ it->get(), all_nodes });
+        for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+            if (number.contains(it->get())) continue;
+            exit_roots.insert(it->get());
+            dfs_from(it->get());
         }
 
-        bool changed = true;
-        while (changed) {
-            changed = false;
-            // 跳过entry
-            for (size_t i = 1; i < num_blocks; ++i) {
-                auto &block = blocks[i];
-                std::cout << "now calc block: " << block->label << std::endl;
-                // {d} = dom N = intersection of dom P for all P in predecessors(N) + N
-                std::unordered_set<IRBasicBlock *> new_dom;
-                for (auto pred : block->predecessors) {
-                    // if (not dom_calc.contains(pred)) continue;
-                    if (new_dom.empty()) {
-                        new_dom = dom_calc[pred];
-                        std::cout << "now is empty, so add in set: ";
-                        for (auto b : new_dom) {
-                            std::cout << b->label << " ";
-                        }
-                        std::cout << std::endl;
-                        continue;
-                    }
-                    std::unordered_set<IRBasicBlock *> temp;
-                    for (auto b : new_dom) {
-                        std::cout << "check block " << b->label << " in pred " << pred->label
-                                  << std::endl;
-                        if (dom_calc[pred].contains(b)) {
-                            std::cout << "keep block " << b->label << std::endl;
-                            temp.insert(b);
-                        } else {
-                            std::cout << "erase block " << b->label << std::endl;
-                        }
-                    }
-                    new_dom = std::move(temp);
-                }
-                new_dom.insert(block.get());
-                if (dom_calc.at(block.get()) != new_dom) {
-                    dom_calc[block.get()] = std::move(new_dom);
-                    changed = true;
-                }
+        SemiNCA snca;
+        snca.run(parent, [&](int i, auto &&visit) {
+            IRBasicBlock *block = vertex[i];
+            if (exit_roots.contains(block)) visit(0);
+            for (IRBasicBlock *succ : block->successors) visit(number.at(succ));
+        });
+
+        // 虚拟出口的孩子就是各个后支配子树的根
+        std::vector<IRBasicBlock *> roots;
+        for (size_t i = 1; i < vertex.size(); ++i) {
+            int d = snca.idom[i];
+            if (d == 0) {
+                roots.push_back(vertex[i]);
+                continue;
             }
+            vertex[i]->ipdom = vertex[d];
+            vertex[d]->pdom_child.push_back(vertex[i]);
         }
 
-        // 计算 idom 和 dom_child
-        for (size_t i = 1; i < num_blocks; ++i) {
-            auto &block_n = blocks[i];
-            // sdom(N) = dom(N) - {N}
-            // 检查 d 是否是 N 的 "直接" 支配者
-            // d 的所有支配者 m (sdom(d))，是否也在 N 的支配者 (sdom(N)) 中
-            for (auto dom_d : dom_calc[block_n.get()]) {
-                if (dom_d == block_n.get()) continue;
-                bool is_idom = true;
-                // 遍历 N 的其他支配节点 m (不包括 N 和 d)
-                for (auto dom_m : dom_calc[block_n.get()]) {
-                    if (dom_m == block_n.get() || dom_m == dom_d) continue;
-                    if (dom_calc[dom_d].find(dom_m) == dom_calc[dom_d].end()) {
-                        is_idom = false;
-                        break;
+        int clock = 0;
+        for (IRBasicBlock *root : roots) {
+            number_tree(
+                root, clock, [](IRBasicBlock *b) -> auto & { return b->pdom_child; },
+                &IRBasicBlock::pdom_in, &IRBasicBlock::pdom_out);
+        }
+        return false;
+    }
+};
+
+// --- 控制依赖分析 Pass ---
+// Ferrante 等人的构造：对每条边 A->B，若 B 不后支配 A，则从 B 沿后支配树上移到 ipdom(A) 为止，
+// 途经的块都控制依赖于 A（A 末尾的分支决定它们是否执行）。
+// control_deps 记录本块依赖的分支块，control_dependents 是反向边。
+class ControlDependencePass : public FunctionPass {
+  public:
+    const char *name() const override {
+        return "controldeps";
+    }
+
+    bool run(IRFunction &F) override {
+        for (auto &block : F.blocks) {
+            block->control_deps.clear();
+            block->control_dependents.clear();
+        }
+
+        for (auto &block : F.blocks) {
+            IRBasicBlock *a = block.get();
+            if (a->successors.size() < 2) continue; // 只有条件分支才会产生控制依赖
+            for (IRBasicBlock *b : a->successors) {
+                for (IRBasicBlock *runner = b; runner && runner != a->ipdom;
+                     runner = runner->ipdom) {
+                    if (std::find(runner->control_deps.begin(), runner->control_deps.end(), a) !=
+                        runner->control_deps.end()) {
+                        continue;
                     }
-                }
-                if (is_idom) {
-                    block_n.get()->idom = dom_d;
-                    dom_d->dom_child.push_back(block_n.get());
-                    break;
+                    runner->control_deps.push_back(a);
+                    a->control_dependents.push_back(runner);
                 }
             }
         }
-
         return false;
     }
 };
@@ -260,50 +483,31 @@ class DominatorTreePass : public FunctionPass {
 // --- 支配边界分析 Pass ---
 class DominanceFrontierPass : public FunctionPass {
   public:
+    const char *name() const override {
+        return "domfrontier";
+    }
+
     bool run(IRFunction &F) override {
-        std::cout << "Running DominanceFrontierPass on function: " << F.name << std::endl;
         auto &blocks = F.blocks;
         if (blocks.empty()) return false;
 
-        // 辅助函数：检查 n 是否严格支配 w (n->w)
-        auto strictly_dominates = [](IRBasicBlock *n, IRBasicBlock *w) {
-            if (!w || !n) return false;
-            IRBasicBlock *temp = w->idom;
-            while (temp) {
-                if (temp == n) {
-                    return true;
-                }
-                if (temp == temp->idom) break;
-                temp = temp->idom;
-            }
-            return false;
-        };
+        for (auto &block : blocks) {
+            block->dom_frontiers.clear();
+        }
 
-        // 递归 lambda，用于自底向上遍历支配树
-        std::function<void(IRBasicBlock *)> compute_df_recursive;
-        compute_df_recursive = [&](IRBasicBlock *n) {
-            // DF_local(n) = { s | s in succ(n) and idom(s) != n }
-            // 计算由节点n的直接后继贡献的支配边界节点
-            for (IRBasicBlock *s : n->successors) {
-                if (s->idom != n) {
-                    n->dom_frontiers.insert(s);
-                }
-            }
-            // DF_up(n) = Union { w | w in DF(c) and n 不严格支配 w }
-            //            for c in dom_children(n)
-            // 从后继支配边界继承符合定义的支配边界
-            for (IRBasicBlock *c : n->dom_child) {
-                compute_df_recursive(c);
-                for (IRBasicBlock *w : c->dom_frontiers) {
-                    if (!strictly_dominates(n, w)) {
-                        n->dom_frontiers.insert(w);
-                    }
+        // Cooper-Harvey-Kennedy：对每条边 p->b，从 p 沿 idom 链上移到 idom(b) 为止，
+        // 途经的块都不严格支配 b 却支配 b 的一个前驱，所以 b 属于它们的支配边界
+        for (auto &block : blocks) {
+            IRBasicBlock *b = block.get();
+            if (b->dom_in < 0) continue; // 不可达
+            for (IRBasicBlock *pred : b->predecessors) {
+                if (pred->dom_in < 0) continue;
+                for (IRBasicBlock *runner = pred; runner && runner != b->idom;
+                     runner = runner->idom) {
+                    runner->dom_frontiers.insert(b);
                 }
             }
-        };
-
-        // 从入口块开始递归
-        compute_df_recursive(blocks[0].get());
+        }
 
         return false; // 分析 Pass 不修改 IR
     }
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/GVNPass.hpp"
+#include "pass/bitvector_dataflow.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/mem2reg.hpp"
+#include "type.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ========================================================
+// --- 惰性代码移动（Lazy Code Motion）部分冗余消除 ---
+// 表达式按 GVNPass::ValueKey 分类，操作数是 SSA 值，直接按寄存器名 / 常量编号。
+// 定义了某个操作数（包括 PHI）的块对用到它的表达式不透明。对每个表达式求：
+//   可预期 ANT（后向、交）与可用 AV（前向、交），得到每条边上最早的插入位置 EARLIEST；
+//   再沿可预期的路径把插入推迟到最晚 LATER，在 INSERT 边上插入，删除 DELETE 块里的原计算。
+// 插入只发生在每条路径上原本就要求值的地方，所以任何路径上的计算都不会变多。
+// 边上的插入放在目标块开头（目标只有这一个前驱）或源块末尾（源只有这一个后继），否则拆开关键边。
+// 插入和保留的计算把结果存进临时 alloca，被删除的计算改为读它，再交给 mem2reg 重建 SSA；
+// deSSA 把 PHI 拷贝放在前驱末尾，因此新 PHI 所在块的关键入边也要拆开。
+// ========================================================
+
+class LazyCodeMotionPass : public FunctionPass {
+  private:
+    using ValueKey = GVNPass::ValueKey;
+    using ValueKeyHash = GVNPass::ValueKeyHash;
+
+    // 每个表达式的一个代表计算（操作码、操作数与结果类型）
+    std::vector<IRInstruction> exprs;
+    std::unordered_map<ValueKey, size_t, ValueKeyHash> expr_index;
+    // 操作数（寄存器名或常量）的编号，作为 ValueKey 的操作数值编号
+    std::unordered_map<ValueKey, size_t, ValueKeyHash> leaf_ids;
+    // 寄存器 -> 用到它的表达式
+    std::unordered_map<std::string, std::vector<size_t>> users;
+
+    // 局部性质，按块编号索引
+    std::vector<BitVector> comp, kill, antloc;
+
+    static bool is_candidate(const IRInstruction &inst) {
+        switch (inst.op) {
+            case IROp::ADD:
+            case IROp::SUB:
+            case IROp::MUL: break;
+            case IROp::DIV:
+                // 可预期分析不管不终止的路径，只有除数是非零常量时提前求值才不会陷入
+                if (inst.args.size() != 2 || inst.args[1].op_type != IROperandType::IMM ||
+                    inst.args[1].imm_value == 0) {
+                    return false;
+                }
+                break;
+            default: return false;
+        }
+        if (!inst.result || inst.args.size() != 2) return false;
+        return std::all_of(inst.args.begin(), inst.args.end(), [](const IROperand &arg) {
+            return arg.op_type == IROperandType::REG || arg.op_type == IROperandType::IMM;
+        });
+    }
+
+    size_t leaf_id(const IROperand &op) {
+        ValueKey key =
+            op.op_type == IROperandType::IMM ? ValueKey(op.imm_value) : ValueKey(op.name);
+        return leaf_ids.try_emplace(key, leaf_ids.size()).first->second;
+    }
+
+    // 指令计算的表达式编号；不是候选时返回 -1
+    int expr_of(const IRInstruction &inst) {
+        if (!is_candidate(inst)) return -1;
+        ValueKey key(inst.op, { leaf_id(inst.args[0]), leaf_id(inst.args[1]) },
+                     inst.result->type);
+        auto [it, inserted] = expr_index.try_emplace(key, exprs.size());
+        if (inserted) {
+            exprs.push_back(inst);
+            for (const auto &arg : inst.args) {
+                if (arg.op_type == IROperandType::REG) users[arg.name].push_back(it->second);
+            }
+        }
+        return static_cast<int>(it->second);
+    }
+
+    void compute_local(const BlockNumbering &numbering) {
+        const size_t n = numbering.size();
+        std::vector<std::vector<size_t>> occurs(n);
+        for (size_t b = 0; b < n; ++b) {
+            for (const auto &inst : numbering.block(b)->insts) {
+                int e = expr_of(inst);
+                if (e >= 0) occurs[b].push_back(e);
+            }
+        }
+        comp.assign(n, BitVector(exprs.size()));
+        kill.assign(n, BitVector(exprs.size()));
+        for (size_t b = 0; b < n; ++b) {
+            for (size_t e : occurs[b]) comp[b].set(e);
+            for (const auto &inst : numbering.block(b)->insts) {
+                if (!inst.result) continue;
+                auto it = users.find(inst.result->name);
+                if (it == users.end()) continue;
+                for (size_t e : it->second) kill[b].set(e);
+            }
+        }
+        // SSA 中操作数的定义总在使用之前，块内有计算且透明就是局部可预期
+        antloc = comp;
+        for (size_t b = 0; b < n; ++b) antloc[b].subtract(kill[b]);
+    }
+
+    // 边上插入的计算放在返回位置之前
+    static std::list<IRInstruction>::iterator block_top(IRBasicBlock *block) {
+        auto it = block->insts.begin();
+        while (it != block->insts.end() && (it->op == IROp::LABEL || it->op == IROp::PHI)) ++it;
+        return it;
+    }
+
+    // 边 pred -> succ 上插入的位置：所在块与插在它之前的指令
+    std::pair<IRBasicBlock *, std::list<IRInstruction>::iterator>
+    edge_position(IRFunction &F, IRBasicBlock *pred, IRBasicBlock *succ) {
+        if (succ->predecessors.size() == 1) return { succ, block_top(succ) };
+        if (pred->successors.size() == 1) return { pred, pred->branch_begin() };
+        IRBasicBlock *mid = split_edges(F, succ, { pred }, "lcm" + succ->label);
+        add_stat("edges split");
+        return { mid, std::prev(mid->insts.end()) };
+    }
+
+    // 新 PHI 所在块的关键入边拆开，deSSA 的拷贝才不会落到另一条出边上
+    void split_phi_edges(IRFunction &F, const std::unordered_set<std::string> &old_phis) {
+        for (size_t i = 0; i < F.blocks.size(); ++i) {
+            IRBasicBlock *block = F.blocks[i].get();
+            bool new_phi = std::any_of(block->insts.begin(), block->insts.end(), [&](auto &inst) {
+                return inst.op == IROp::PHI && !old_phis.contains(inst.result->name);
+            });
+            if (!new_phi) continue;
+            for (IRBasicBlock *pred : std::vector(block->predecessors)) {
+                if (pred->successors.size() < 2) continue;
+                split_edges(F, block, { pred }, "lcm" + block->label);
+                add_stat("edges split");
+            }
+        }
+    }
+
+  public:
+    const char *name() const override {
+        return "lcm";
+    }
+
+    bool run(IRFunction &F) override {
+        // 入口块有前驱时，入口边上的插入会落进循环
+        if (F.blocks.empty() || !F.blocks.front()->predecessors.empty()) return false;
+        exprs.clear();
+        expr_index.clear();
+        leaf_ids.clear();
+        users.clear();
+
+        BlockNumbering numbering(F);
+        compute_local(numbering);
+        const size_t n = numbering.reachable_size();
+        const size_t m = exprs.size();
+        if (m == 0) return false;
+
+        GenKillProblem<BitVector> ant;
+        ant.direction = DataflowDirection::Backward;
+        ant.meet = DataflowMeet::Intersect;
+        ant.universe = m;
+        ant.gen = antloc;
+        ant.kill = kill;
+        DataflowResult<BitVector> ANT = solve_dataflow(numbering, ant);
+
+        GenKillProblem<BitVector> av;
+        av.direction = DataflowDirection::Forward;
+        av.meet = DataflowMeet::Intersect;
+        av.universe = m;
+        av.gen = comp;
+        av.kill = kill;
+        DataflowResult<BitVector> AV = solve_dataflow(numbering, av);
+
+        // EARLIEST(p, s) = ANTIN(s) - AVOUT(p) - (ANTOUT(p) - KILL(p))
+        auto earliest = [&](int p, int s) {
+            BitVector e = ANT.in[s];
+            e.subtract(AV.out[p]);
+            BitVector passes = ANT.out[p];
+            passes.subtract(kill[p]);
+            e.subtract(passes);
+            return e;
+        };
+        // LATER(p, s) = EARLIEST(p, s) | (LATERIN(p) - ANTLOC(p))
+        std::vector<BitVector> laterin(n, BitVector(m, true));
+        laterin[0] = ANT.in[0]; // 虚拟入口边上 EARLIEST = ANTIN(entry)
+        auto later = [&](int p, int s) {
+            BitVector l = laterin[p];
+            l.subtract(antloc[p]);
+            l.union_with(earliest(p, s));
+            return l;
+        };
+        bool again = true;
+        while (again) {
+            again = false;
+            for (size_t b = 1; b < n; ++b) {
+                BitVector in(m, true);
+                for (IRBasicBlock *pred : numbering.block(b)->predecessors) {
+                    int p = numbering[pred];
+                    if (static_cast<size_t>(p) < n) in.intersect_with(later(p, b));
+                }
+                if (in == laterin[b]) continue;
+                laterin[b] = in;
+                again = true;
+            }
+        }
+
+        // DELETE(b) = ANTLOC(b) - LATERIN(b)；只处理确实删掉了计算的表达式
+        std::vector<BitVector> deleted(n);
+        BitVector moved(m);
+        for (size_t b = 0; b < n; ++b) {
+            deleted[b] = antloc[b];
+            deleted[b].subtract(laterin[b]);
+            moved.union_with(deleted[b]);
+        }
+        if (!moved.any()) return false;
+
+        // INSERT(p, s) = LATER(p, s) - LATERIN(s)，先全部算完再改 CFG
+        struct Insertion {
+            IRBasicBlock *pred, *succ;
+            BitVector which;
+        };
+        std::vector<Insertion> insertions;
+        for (size_t s = 1; s < n; ++s) {
+            for (IRBasicBlock *pred : numbering.block(s)->predecessors) {
+                int p = numbering[pred];
+                if (static_cast<size_t>(p) >= n) continue;
+                BitVector ins = later(p, s);
+                ins.subtract(laterin[s]);
+                ins.intersect_with(moved);
+                if (ins.any()) insertions.push_back({ pred, numbering.block(s), ins });
+            }
+        }
+
+        // 每个表达式一个临时变量
+        IRBasicBlock *entry = F.blocks.front().get();
+        std::vector<IROperand> temps(m);
+        moved.for_each([&](size_t e) {
+            temps[e] = F.new_reg(IRType::get_pointer(exprs[e].result->type));
+            entry->insts.insert(std::next(entry->insts.begin()),
+                                IRInstruction(IROp::ALLOCA, {}, temps[e]));
+        });
+
+        for (size_t b = 0; b < n; ++b) {
+            IRBasicBlock *block = numbering.block(b);
+            BitVector seen(m);
+            for (auto it = block->insts.begin(); it != block->insts.end(); ++it) {
+                int e = expr_of(*it);
+                if (e < 0 || !moved.test(e)) continue;
+                if (seen.test(e) || deleted[b].test(e)) {
+                    *it = IRInstruction(IROp::LOAD, { temps[e] }, it->result);
+                    add_stat("redundant expressions deleted");
+                    continue;
+                }
+                seen.set(e);
+                block->insts.insert(std::next(it),
+                                    IRInstruction(IROp::STORE, { *it->result, temps[e] }));
+            }
+        }
+
+        for (auto &[pred, succ, ins] : insertions) {
+            auto [host, pos] = edge_position(F, pred, succ);
+            ins.for_each([&](size_t e) {
+                IROperand value = F.new_reg(exprs[e].result->type);
+                host->insts.insert(pos, IRInstruction(exprs[e].op, exprs[e].args, value));
+                host->insts.insert(pos, IRInstruction(IROp::STORE, { value, temps[e] }));
+                add_stat("expressions inserted");
+            });
+        }
+
+        // 临时变量提升回寄存器，插入的 PHI 只在迭代支配边界上
+        std::unordered_set<std::string> old_phis;
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::PHI) old_phis.insert(inst.result->name);
+            }
+        }
+        BuildCFGPass{}.run(F);
+        DominatorTreePass{}.run(F);
+        DominanceFrontierPass{}.run(F);
+        Mem2RegPhiInsertionPass{}.run(F);
+        split_phi_edges(F, old_phis);
+        F.clear_loops();
+        return true;
+    }
+};
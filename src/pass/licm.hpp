@@ -2,184 +2,46 @@
 
 #include "ir.hpp"
 #include "pass.hpp"
+#include "pass/alias_analysis.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/mem2reg.hpp"
 #include <algorithm>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
-// 循环信息结构
-struct LoopInfo {
-    IRBasicBlock *header;                           // 循环头
-    std::unordered_set<IRBasicBlock *> blocks;      // 循环体中的所有块
-    std::unordered_set<IRBasicBlock *> exit_blocks; // 循环的退出块
-    IRBasicBlock *preheader = nullptr;              // 预头块(用于放置外提的指令)
-    LoopInfo *parent = nullptr;                     // 父循环
-    std::vector<LoopInfo *> sub_loops;              // 子循环
-
-    LoopInfo(IRBasicBlock *h) : header(h) {}
-};
-
-// 循环不变式外提 Pass
+// 循环不变式外提 Pass。
+// 外提之后，循环里只经由同一个不变地址读写、且循环中别的访存都碰不到的内存位置提升到寄存器：
+// 预头块读一次，循环里改为读写临时 alloca，每个退出块写回一次，最后由 mem2reg 构造 SSA。
 class LICMPass : public FunctionPass {
   private:
     IRFunction *current_function = nullptr;
-    std::vector<std::unique_ptr<LoopInfo>> all_loops;
-    std::unordered_map<IRBasicBlock *, LoopInfo *> block_to_loop;
-
-    // 检测自然循环
-    void detect_loops(IRFunction &F) {
-        all_loops.clear();
-        block_to_loop.clear();
-
-        // 找到所有回边 (back edge): n -> d，其中 d 支配 n
-        std::vector<std::pair<IRBasicBlock *, IRBasicBlock *>> back_edges;
-        for (auto &block : F.blocks) {
-            for (auto succ : block->successors) {
-                if (dominates(succ, block.get())) {
-                    back_edges.push_back({ block.get(), succ });
-                }
-            }
-        }
-
-        // 为每条回边构建自然循环
-        for (auto [tail, head] : back_edges) {
-            auto loop = std::make_unique<LoopInfo>(head);
-            loop->blocks.insert(head);
-
-            // 从尾节点回溯到头节点，收集所有循环体块
-            std::vector<IRBasicBlock *> worklist = { tail };
-            std::unordered_set<IRBasicBlock *> visited = { head };
-
-            while (!worklist.empty()) {
-                IRBasicBlock *current = worklist.back();
-                worklist.pop_back();
-
-                if (visited.count(current)) continue;
-                visited.insert(current);
-                loop->blocks.insert(current);
-
-                for (auto pred : current->predecessors) {
-                    if (!visited.count(pred)) {
-                        worklist.push_back(pred);
-                    }
-                }
-            }
-
-            // 记录块到循环的映射
-            for (auto block : loop->blocks) {
-                block_to_loop[block] = loop.get();
-            }
-
-            all_loops.push_back(std::move(loop));
-        }
-
-        // 找出循环的退出块
-        for (auto &loop : all_loops) {
-            for (auto block : loop->blocks) {
-                for (auto succ : block->successors) {
-                    if (!loop->blocks.count(succ)) {
-                        loop->exit_blocks.insert(succ);
-                    }
-                }
-            }
-        }
-    }
 
     // 检查块 a 是否支配块 b
     bool dominates(IRBasicBlock *a, IRBasicBlock *b) {
-        if (a == b) return true;
-        IRBasicBlock *idom = b->idom;
-        while (idom) {
-            if (idom == a) return true;
-            if (idom == idom->idom) break; // 防止循环
-            idom = idom->idom;
-        }
-        return false;
-    }
-
-    // 为循环创建预头块
-    void create_preheader(IRFunction &F, LoopInfo *loop) {
-        IRBasicBlock *header = loop->header;
-
-        // 检查是否已经有预头块
-        if (header->predecessors.size() == 1) {
-            IRBasicBlock *pred = header->predecessors[0];
-            if (!loop->blocks.count(pred) && pred->successors.size() == 1) {
-                loop->preheader = pred;
-                return;
-            }
-        }
-
-        // 创建新的预头块
-        auto preheader_ptr = std::make_unique<IRBasicBlock>("preheader" + header->label);
-        IRBasicBlock *preheader = preheader_ptr.get();
-        loop->preheader = preheader;
-
-        // 添加 LABEL 指令
-        preheader->insts.emplace_back(IROp::LABEL, std::vector<IROperand>{
-                                                       IROperand::create_label(preheader->label) });
-
-        // 添加跳转到循环头的指令
-        preheader->insts.emplace_back(IROp::BR, std::vector<IROperand>{
-                                                    IROperand::create_label(header->label) });
-
-        // 更新 CFG：将所有从循环外进入循环头的边重定向到预头块
-        std::vector<IRBasicBlock *> external_preds;
-        for (auto pred : header->predecessors) {
-            if (!loop->blocks.count(pred)) {
-                external_preds.push_back(pred);
-            }
-        }
-
-        // 更新前驱的后继
-        for (auto pred : external_preds) {
-            // 替换后继中的 header 为 preheader
-            for (size_t i = 0; i < pred->successors.size(); ++i) {
-                if (pred->successors[i] == header) {
-                    pred->successors[i] = preheader;
-                }
-            }
-
-            // 更新跳转指令中的标签
-            for (auto &inst : pred->insts) {
-                if (inst.op == IROp::BR || inst.op == IROp::BRZ || inst.op == IROp::BRLT ||
-                    inst.op == IROp::BRGT) {
-                    for (auto &arg : inst.args) {
-                        if (arg.op_type == IROperandType::LABEL && arg.name == header->label) {
-                            arg.name = preheader->label;
-                        }
-                    }
-                }
-            }
-
-            preheader->predecessors.push_back(pred);
-        }
-
-        // 更新循环头的前驱
-        for (auto pred : external_preds) {
-            header->predecessors.erase(std::remove(header->predecessors.begin(),
-                                                   header->predecessors.end(), pred),
-                                       header->predecessors.end());
-        }
-        header->predecessors.push_back(preheader);
-        preheader->successors.push_back(header);
-
-        // 将预头块插入到函数中（在循环头之前）
-        auto it = std::find_if(F.blocks.begin(), F.blocks.end(), [header](const auto &b) {
-            return b.get() == header;
-        });
-        F.blocks.insert(it, std::move(preheader_ptr));
+        return a->dominates(b);
     }
 
     // 检查指令是否是循环不变式
     bool is_loop_invariant(IRInstruction *inst, LoopInfo *loop,
                            std::unordered_set<IRInstruction *> &invariants) {
+        // 纯函数（见调用图的摘要）的调用与算术指令一样，只取决于参数
+        if (inst->op == IROp::CALL) {
+            const FunctionSummary *callee = current_function->callee_summary(*inst);
+            if (!callee || !callee->is_pure() || !inst->result) return false;
+        }
+
         // 不能外提的指令类型（有副作用或特殊用途的指令）
-        if (inst->op == IROp::LOAD || inst->op == IROp::STORE || inst->op == IROp::CALL ||
+        if (inst->op == IROp::LOAD || inst->op == IROp::STORE ||
             inst->op == IROp::ALLOCA || inst->op == IROp::PHI || inst->op == IROp::LABEL ||
             inst->op == IROp::MOVE || inst->is_terminator() ||
+            // TEST 设置的标志位属于紧跟的条件跳转，跳转留在循环里，TEST 也不能离开（交给 loop-unswitch）
+            inst->op == IROp::TEST ||
             // I/O指令有副作用，不能外提
             inst->op == IROp::INPUT_I32 || inst->op == IROp::INPUT_I8 ||
             inst->op == IROp::OUTPUT_I32 || inst->op == IROp::OUTPUT_I8 ||
@@ -253,8 +115,9 @@ class LICMPass : public FunctionPass {
     bool hoist_loop_invariants(IRFunction &F, LoopInfo *loop) {
         bool changed = false;
 
-        // 迭代查找循环不变式
+        // 迭代查找循环不变式；invariant_order 记录发现顺序，操作数的定义总在使用之前
         std::unordered_set<IRInstruction *> invariants;
+        std::vector<IRInstruction *> invariant_order;
         bool found_new = true;
 
         while (found_new) {
@@ -266,21 +129,32 @@ class LICMPass : public FunctionPass {
 
                     if (is_loop_invariant(&inst, loop, invariants)) {
                         invariants.insert(&inst);
+                        invariant_order.push_back(&inst);
                         found_new = true;
                     }
                 }
             }
         }
 
-        // 外提循环不变式
+        // 外提循环不变式：操作数在循环内的定义也必须外提，否则留在循环里的定义会晚于外提的使用
         std::vector<std::pair<IRBasicBlock *, IRInstruction *>> to_hoist;
+        std::unordered_set<IRInstruction *> hoisted;
 
-        for (auto inv_inst : invariants) {
+        for (auto inv_inst : invariant_order) {
             IRBasicBlock *block = current_function->inst_to_block_map[inv_inst];
+            bool operands_hoisted = std::all_of(
+                inv_inst->args.begin(), inv_inst->args.end(), [&](const IROperand &arg) {
+                    if (arg.op_type != IROperandType::REG) return true;
+                    auto def_it = current_function->var_def_inst_map.find(arg.name);
+                    return def_it == current_function->var_def_inst_map.end() ||
+                           !invariants.contains(def_it->second) ||
+                           hoisted.contains(def_it->second);
+                });
 
             // 检查是否安全移动
-            if (is_safe_to_move(inv_inst, loop)) {
+            if (operands_hoisted && is_safe_to_move(inv_inst, loop)) {
                 to_hoist.push_back({ block, inv_inst });
+                hoisted.insert(inv_inst);
             }
         }
 
@@ -292,6 +166,7 @@ class LICMPass : public FunctionPass {
         // 确保有预头块（只在需要时创建）
         if (!loop->preheader) {
             create_preheader(F, loop);
+            add_stat("preheaders created");
         }
 
         // 执行外提
@@ -300,42 +175,199 @@ class LICMPass : public FunctionPass {
             auto it = std::find_if(block->insts.begin(), block->insts.end(),
                                    [inst](const IRInstruction &i) { return &i == inst; });
             if (it != block->insts.end()) {
-                IRInstruction moved_inst = std::move(*it);
-                block->insts.erase(it);
-
-                // 插入到预头块的跳转指令之前
+                // 插入到预头块的跳转指令之前；splice 不改变指令地址，def-use 信息仍然有效
                 auto preheader_it = loop->preheader->insts.end();
                 --preheader_it; // 跳过最后的 BR 指令
-                loop->preheader->insts.insert(preheader_it, std::move(moved_inst));
+                loop->preheader->insts.splice(preheader_it, block->insts, it);
+                current_function->inst_to_block_map[inst] = loop->preheader;
 
                 changed = true;
-
-                std::cout << "    Hoisted invariant from " << block->label << std::endl;
+                add_stat("instructions hoisted");
             }
         }
 
         return changed;
     }
 
-  public:
-    bool run(IRFunction &F) override {
-        std::cout << "Running LICMPass on function: " << F.name << std::endl;
+    // ---- 标量提升 ----
 
-        current_function = &F;
+    // 循环里经由同一个不变地址的一组 load / store
+    struct PromotionCandidate {
+        IROperand addr;
+        std::vector<IRInstruction *> accesses;
+        bool has_store = false;
+    };
+
+    // 提升时引入的临时 alloca，它们不与任何别的内存重叠
+    std::unordered_set<std::string> promotion_temps;
+
+    static const IROperand *access_address(const IRInstruction &inst) {
+        if (inst.op == IROp::LOAD) return &inst.args[0];
+        if (inst.op == IROp::STORE) return &inst.args[1];
+        return nullptr;
+    }
+
+    bool is_temp_access(const IRInstruction &inst) const {
+        const IROperand *addr = access_address(inst);
+        return addr && addr->op_type == IROperandType::REG && promotion_temps.contains(addr->name);
+    }
+
+    // 地址是全局变量、参数或在循环外定义的寄存器
+    bool is_invariant_address(const IROperand &addr, LoopInfo *loop) {
+        if (addr.op_type == IROperandType::GLOBAL) return true;
+        if (addr.op_type != IROperandType::REG || promotion_temps.contains(addr.name)) {
+            return false;
+        }
+        auto def = current_function->var_def_inst_map.find(addr.name);
+        if (def == current_function->var_def_inst_map.end()) return true;
+        return !loop->contains(current_function->inst_to_block_map[def->second]);
+    }
+
+    std::vector<PromotionCandidate> find_promotable(IRFunction &F, LoopInfo *loop,
+                                                    AliasAnalysis &aa) {
+        std::vector<IRInstruction *> mem; // 循环里所有读写内存的指令
+        std::vector<PromotionCandidate> groups;
+        for (auto &block : F.blocks) {
+            if (!loop->contains(block.get())) continue;
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::CALL || inst.op == IROp::OUTPUT_STR) mem.push_back(&inst);
+                const IROperand *addr = access_address(inst);
+                if (!addr || is_temp_access(inst)) continue;
+                mem.push_back(&inst);
+                if (!is_invariant_address(*addr, loop)) continue;
+                auto group = std::find_if(groups.begin(), groups.end(), [&](const auto &g) {
+                    return g.addr.op_type == addr->op_type && g.addr.name == addr->name;
+                });
+                if (group == groups.end()) {
+                    groups.push_back(PromotionCandidate{ *addr, {}, false });
+                    group = std::prev(groups.end());
+                }
+                group->accesses.push_back(&inst);
+                group->has_store |= inst.op == IROp::STORE;
+            }
+        }
+
+        // 组外的访存（包括调用）都不能读写这个位置
+        std::erase_if(groups, [&](const PromotionCandidate &g) {
+            MemoryLocation loc = aa.location(*g.accesses.front());
+            for (IRInstruction *inst : mem) {
+                if (std::find(g.accesses.begin(), g.accesses.end(), inst) != g.accesses.end()) {
+                    continue;
+                }
+                if (inst->op == IROp::CALL) {
+                    if (aa.get_mod_ref(*inst, loc) != ModRefInfo::NoModRef) return true;
+                } else if (aa.may_alias(aa.location(*inst), loc)) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        return groups;
+    }
+
+    // 提升需要预头块和专用退出块；补上了任何一个时返回 true，调用者重新计算循环信息
+    bool prepare_loop(IRFunction &F, LoopInfo *loop) {
+        if (!loop->preheader) {
+            create_preheader(F, loop);
+            add_stat("preheaders created");
+            return true;
+        }
+        for (IRBasicBlock *exit : loop->exit_blocks) {
+            std::vector<IRBasicBlock *> inside;
+            for (IRBasicBlock *pred : exit->predecessors) {
+                if (loop->contains(pred)) inside.push_back(pred);
+            }
+            if (inside.size() == exit->predecessors.size()) continue;
+            split_edges(F, exit, inside, "loopexit" + exit->label);
+            add_stat("dedicated exits created");
+            return true;
+        }
+        return false;
+    }
+
+    void promote(IRFunction &F, LoopInfo *loop, const PromotionCandidate &c) {
+        IRType *value_type = c.addr.type->get_pointee_type();
+        IROperand temp = F.new_reg(c.addr.type);
+        promotion_temps.insert(temp.name);
+        IRBasicBlock *entry = F.blocks.front().get();
+        entry->insts.insert(std::next(entry->insts.begin()),
+                            IRInstruction(IROp::ALLOCA, {}, temp));
+
+        // 预头块里读入初值
+        IROperand init = F.new_reg(value_type);
+        auto pos = std::prev(loop->preheader->insts.end());
+        loop->preheader->insts.insert(pos, IRInstruction(IROp::LOAD, { c.addr }, init));
+        loop->preheader->insts.insert(pos, IRInstruction(IROp::STORE, { init, temp }));
+
+        for (IRInstruction *inst : c.accesses) {
+            inst->args[inst->op == IROp::LOAD ? 0 : 1] = temp;
+        }
+
+        // 每个退出块开头写回
+        if (c.has_store) {
+            for (IRBasicBlock *exit : loop->exit_blocks) {
+                auto at = exit->insts.begin();
+                while (at != exit->insts.end() && (at->op == IROp::LABEL || at->op == IROp::PHI)) {
+                    ++at;
+                }
+                IROperand value = F.new_reg(value_type);
+                exit->insts.insert(at, IRInstruction(IROp::LOAD, { temp }, value));
+                exit->insts.insert(at, IRInstruction(IROp::STORE, { value, c.addr }));
+            }
+        }
+        add_stat("memory locations promoted");
+        add_stat("memory accesses promoted", static_cast<long>(c.accesses.size()));
+    }
+
+    bool promote_memory(IRFunction &F) {
+        AliasAnalysis aa(F);
+        promotion_temps.clear();
         bool changed = false;
+        bool again = true;
+        while (again) {
+            again = false;
+            // 内层循环先处理，外层循环随后还能提升内层预头块的读和退出块的写
+            for (auto it = F.loops.rbegin(); it != F.loops.rend(); ++it) {
+                LoopInfo *loop = it->get();
+                if (loop->exit_blocks.empty()) continue; // 不终止的循环没有写回的位置
+                std::vector<PromotionCandidate> candidates = find_promotable(F, loop, aa);
+                if (candidates.empty()) continue;
+                if (prepare_loop(F, loop)) {
+                    // 新块改变了外层循环的块集合，重新计算后从头再来
+                    DominatorTreePass{}.run(F);
+                    LoopAnalysisPass{}.run(F);
+                    again = changed = true;
+                    break;
+                }
+                for (const auto &c : candidates) promote(F, loop, c);
+                changed = true;
+            }
+        }
+        if (promotion_temps.empty()) return changed;
+
+        DominatorTreePass{}.run(F);
+        DominanceFrontierPass{}.run(F);
+        Mem2RegPhiInsertionPass{}.run(F);
+        return true;
+    }
 
-        // 检测循环
-        detect_loops(F);
+  public:
+    const char *name() const override {
+        return "licm";
+    }
 
-        std::cout << "  Found " << all_loops.size() << " loop(s)" << std::endl;
+    bool run(IRFunction &F) override {
+        current_function = &F;
+        bool changed = false;
 
-        // 对每个循环执行 LICM
-        for (auto &loop : all_loops) {
-            std::cout << "  Processing loop with header: " << loop->header->label << std::endl;
-            if (hoist_loop_invariants(F, loop.get())) {
+        // 对每个循环执行 LICM（循环信息由 LoopAnalysisPass 计算）。
+        // 内层循环先处理，外提到内层预头块的指令随后还能继续外提出外层循环
+        for (auto it = F.loops.rbegin(); it != F.loops.rend(); ++it) {
+            if (hoist_loop_invariants(F, it->get())) {
                 changed = true;
             }
         }
+        if (promote_memory(F)) changed = true;
 
         current_function = nullptr;
         return changed;
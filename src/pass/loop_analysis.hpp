@@ -0,0 +1,498 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dom_analysis.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 循环分析 ---
+// LoopAnalysisPass 建立循环嵌套森林（结果存放在 IRFunction::loops 与 IRBasicBlock::loop），
+// LoopSimplifyPass 把循环规范化为带预头块、专用退出块的形式。
+// LICM 等循环优化共用这里的结果和 create_preheader。
+// ========================================================
+
+inline bool has_unconditional_terminator(const IRBasicBlock *block) {
+    return std::any_of(block->insts.begin(), block->insts.end(), [](const IRInstruction &inst) {
+        return inst.op == IROp::BR || inst.op == IROp::RET;
+    });
+}
+
+/**
+ * @brief 把 preds -> target 的边改为经过一个新块 preds -> N -> target
+ * 新块放在 target 之前，只含一条跳转；target 中来自 preds 的 PHI 入边在 N 中合并，
+ * 只有一个前驱时直接改标签。CFG 边同步更新，支配树与循环信息由调用者负责
+ * @return 新建的块
+ */
+inline IRBasicBlock *split_edges(IRFunction &F, IRBasicBlock *target,
+                                 const std::vector<IRBasicBlock *> &preds, std::string label) {
+    // 标签必须唯一（汇编器只接受字母数字）
+    std::unordered_set<std::string> labels;
+    for (auto &block : F.blocks) labels.insert(block->label);
+    if (labels.contains(label)) {
+        int n = 1;
+        while (labels.contains(label + std::to_string(n))) n++;
+        label += std::to_string(n);
+    }
+
+    auto block_ptr = std::make_unique<IRBasicBlock>(label);
+    IRBasicBlock *N = block_ptr.get();
+    N->insts.emplace_back(IROp::LABEL, std::vector{ IROperand::create_label(label) });
+    N->insts.emplace_back(IROp::BR, std::vector{ IROperand::create_label(target->label) });
+
+    auto is_pred = [&](const std::string &l) {
+        return std::any_of(preds.begin(), preds.end(),
+                           [&](IRBasicBlock *p) { return p->label == l; });
+    };
+
+    // 合并 target 中来自 preds 的 PHI 入边
+    auto insert_pos = std::next(N->insts.begin());
+    for (auto &inst : target->insts) {
+        if (inst.op == IROp::LABEL) continue;
+        if (inst.op != IROp::PHI) break;
+        std::vector<IROperand> moved, kept;
+        for (size_t i = 0; i + 1 < inst.args.size(); i += 2) {
+            auto &dst = is_pred(inst.args[i + 1].name) ? moved : kept;
+            dst.push_back(inst.args[i]);
+            dst.push_back(inst.args[i + 1]);
+        }
+        if (moved.empty()) continue;
+
+        bool same = true;
+        for (size_t i = 2; i < moved.size(); i += 2) {
+            same &= moved[i].to_string() == moved[0].to_string();
+        }
+        IROperand value = moved[0];
+        if (!same) {
+            value = F.new_reg(inst.result->type);
+            N->insts.insert(insert_pos, IRInstruction(IROp::PHI, moved, value));
+        }
+        kept.push_back(value);
+        kept.push_back(IROperand::create_label(label));
+        inst.args = std::move(kept);
+    }
+
+    // 前驱的跳转改到新块
+    for (IRBasicBlock *pred : preds) {
+        for (auto &inst : pred->insts) {
+            if (!inst.is_terminator()) continue;
+            for (auto &arg : inst.args) {
+                if (arg.op_type == IROperandType::LABEL && arg.name == target->label) {
+                    arg.name = label;
+                }
+            }
+        }
+        for (auto &succ : pred->successors) {
+            if (succ == target) succ = N;
+        }
+        N->predecessors.push_back(pred);
+    }
+    std::erase_if(target->predecessors, [&](IRBasicBlock *p) {
+        return std::find(preds.begin(), preds.end(), p) != preds.end();
+    });
+    target->predecessors.push_back(N);
+    N->successors.push_back(target);
+
+    // 新块插在 target 之前；原先顺序落入 target 的块补上显式跳转
+    auto it = std::find_if(F.blocks.begin(), F.blocks.end(),
+                           [target](const auto &b) { return b.get() == target; });
+    if (it != F.blocks.begin()) {
+        IRBasicBlock *prev = std::prev(it)->get();
+        if (!has_unconditional_terminator(prev) &&
+            std::find(preds.begin(), preds.end(), prev) == preds.end()) {
+            prev->insts.emplace_back(IROp::BR,
+                                     std::vector{ IROperand::create_label(target->label) });
+        }
+    }
+    F.blocks.insert(it, std::move(block_ptr));
+    if (!F.label_to_block_map.empty()) F.label_to_block_map[label] = N;
+    return N;
+}
+
+/**
+ * @brief 为循环创建预头块（已有时直接返回）
+ * 同步更新支配树（预头块成为循环头的直接支配者）和外层循环的块集合
+ */
+inline IRBasicBlock *create_preheader(IRFunction &F, LoopInfo *loop) {
+    if (loop->preheader) return loop->preheader;
+    IRBasicBlock *header = loop->header;
+
+    std::vector<IRBasicBlock *> outside_preds;
+    for (IRBasicBlock *pred : header->predecessors) {
+        if (!loop->contains(pred)) outside_preds.push_back(pred);
+    }
+    IRBasicBlock *preheader = split_edges(F, header, outside_preds, "preheader" + header->label);
+
+    if (header->dom_in >= 0) {
+        preheader->idom = header->idom;
+        if (IRBasicBlock *idom = header->idom) {
+            std::replace(idom->dom_child.begin(), idom->dom_child.end(), header, preheader);
+        }
+        preheader->dom_child.push_back(header);
+        header->idom = preheader;
+    }
+
+    preheader->loop = loop->parent;
+    for (LoopInfo *outer = loop->parent; outer; outer = outer->parent) {
+        outer->blocks.insert(preheader);
+    }
+    loop->preheader = preheader;
+    return preheader;
+}
+
+// 退出条件中的比较关系（迭代次数和 SCEV 回边执行次数共用）
+enum class Rel { LT, LE, GT, GE, EQ, NE };
+
+// 交换比较的两个操作数："a rel b" 等价于 "b swap_rel(rel) a"
+inline Rel swap_rel(Rel rel) {
+    switch (rel) {
+        case Rel::LT: return Rel::GT;
+        case Rel::LE: return Rel::GE;
+        case Rel::GT: return Rel::LT;
+        case Rel::GE: return Rel::LE;
+        default: return rel;
+    }
+}
+
+// 比较取反："!(a rel b)" 等价于 "a negate_rel(rel) b"
+inline Rel negate_rel(Rel rel) {
+    switch (rel) {
+        case Rel::LT: return Rel::GE;
+        case Rel::LE: return Rel::GT;
+        case Rel::GT: return Rel::LE;
+        case Rel::GE: return Rel::LT;
+        case Rel::EQ: return Rel::NE;
+        case Rel::NE: return Rel::EQ;
+    }
+    return rel;
+}
+
+class LoopAnalysisPass : public FunctionPass {
+  private:
+    // 以 header 为头、latches 为回边源，逆 CFG 收集循环体；已属于内层循环的块整体跳过
+    void discover_loop(LoopInfo *loop) {
+        loop->header->loop = loop;
+        loop->blocks.insert(loop->header);
+        std::vector<IRBasicBlock *> work(loop->latches.begin(), loop->latches.end());
+        while (!work.empty()) {
+            IRBasicBlock *block = work.back();
+            work.pop_back();
+            if (block->dom_in < 0) continue; // 不可达
+
+            if (!block->loop) {
+                block->loop = loop;
+                loop->blocks.insert(block);
+                if (block != loop->header) {
+                    work.insert(work.end(), block->predecessors.begin(),
+                                block->predecessors.end());
+                }
+                continue;
+            }
+
+            LoopInfo *sub = block->loop;
+            while (sub->parent) sub = sub->parent;
+            if (sub == loop) continue;
+            sub->parent = loop;
+            loop->sub_loops.push_back(sub);
+            loop->blocks.insert(sub->blocks.begin(), sub->blocks.end());
+            for (IRBasicBlock *pred : sub->header->predecessors) {
+                if (!sub->contains(pred)) work.push_back(pred);
+            }
+        }
+    }
+
+    void fill_edges(IRFunction &F, LoopInfo *loop) {
+        for (auto &b : F.blocks) {
+            IRBasicBlock *block = b.get();
+            if (!loop->contains(block)) continue;
+            if (std::find(block->successors.begin(), block->successors.end(), loop->header) !=
+                block->successors.end()) {
+                loop->latches.push_back(block);
+            }
+            bool exiting = false;
+            for (IRBasicBlock *succ : block->successors) {
+                if (loop->contains(succ)) continue;
+                exiting = true;
+                if (std::find(loop->exit_blocks.begin(), loop->exit_blocks.end(), succ) ==
+                    loop->exit_blocks.end()) {
+                    loop->exit_blocks.push_back(succ);
+                }
+            }
+            if (exiting) loop->exiting_blocks.push_back(block);
+        }
+
+        IRBasicBlock *candidate = nullptr;
+        for (IRBasicBlock *pred : loop->header->predecessors) {
+            if (loop->contains(pred)) continue;
+            if (candidate) return; // 多个循环外前驱
+            candidate = pred;
+        }
+        if (candidate && candidate->successors.size() == 1 &&
+            has_unconditional_terminator(candidate)) {
+            loop->preheader = candidate;
+        }
+    }
+
+    // ---- 常量迭代次数 ----
+
+    // 归纳变量每次检查时的值为 start + k * step (k = 0, 1, ...)，
+    // 返回条件 "v rel bound" 第一次不成立时的 k；无法确定（或可能不终止）时返回 -1
+    static long first_failure(int64_t start, int64_t step, Rel rel, int64_t bound) {
+        switch (rel) {
+            case Rel::LE: return first_failure(start, step, Rel::LT, bound + 1);
+            case Rel::GE: return first_failure(start, step, Rel::GT, bound - 1);
+            case Rel::LT:
+                if (start >= bound) return 0;
+                if (step <= 0) return -1;
+                return (bound - start + step - 1) / step;
+            case Rel::GT:
+                if (start <= bound) return 0;
+                if (step >= 0) return -1;
+                return (start - bound + (-step) - 1) / (-step);
+            case Rel::EQ:
+                if (start != bound) return 0;
+                return step == 0 ? -1 : 1;
+            case Rel::NE: {
+                if (start == bound) return 0;
+                if (step == 0 || (bound - start) % step != 0) return -1;
+                int64_t k = (bound - start) / step;
+                return k > 0 ? k : -1;
+            }
+        }
+        return -1;
+    }
+
+    // 只处理唯一退出块为循环头或唯一回边块、退出条件为 "test iv C; brX; br" 的循环，
+    // iv 是循环头中 [常量, 循环外] / [iv ± 常量, 回边块] 形式的 PHI（或其递增后的值）
+    void compute_trip_count(LoopInfo *loop) {
+        IRBasicBlock *latch = loop->single_latch();
+        if (!latch || loop->exiting_blocks.size() != 1) return;
+        IRBasicBlock *exiting = loop->exiting_blocks.front();
+        if (exiting != loop->header && exiting != latch) return;
+
+        // 退出块末尾：test a b; brX L1; br L2
+        auto &insts = exiting->insts;
+        if (insts.size() < 4) return;
+        auto it = std::prev(insts.end());
+        const IRInstruction &br = *it--;
+        const IRInstruction &cond_br = *it--;
+        const IRInstruction &test = *it;
+        if (br.op != IROp::BR || test.op != IROp::TEST ||
+            (cond_br.op != IROp::BRLT && cond_br.op != IROp::BRGT && cond_br.op != IROp::BRZ)) {
+            return;
+        }
+        bool taken_stays = false;
+        bool taken_in = loop->contains(block_of(cond_br.args[0].name));
+        bool fall_in = loop->contains(block_of(br.args[0].name));
+        if (taken_in == fall_in) return;
+        taken_stays = taken_in;
+
+        // 归纳变量
+        struct Induction {
+            int64_t start, step;
+            std::string phi, next;
+        };
+        std::vector<Induction> ivs;
+        std::unordered_map<std::string, const IRInstruction *> defs;
+        for (IRBasicBlock *block : loop->blocks) {
+            for (const auto &inst : block->insts) {
+                if (inst.result) defs[inst.result->name] = &inst;
+            }
+        }
+        for (const auto &inst : loop->header->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            if (inst.op != IROp::PHI) break;
+            if (inst.args.size() != 4) continue;
+            size_t in = loop->contains(block_of(inst.args[1].name)) ? 2 : 0;
+            const IROperand &init = inst.args[in];
+            const IROperand &next = inst.args[2 - in];
+            if (!loop->contains(block_of(inst.args[3 - in].name))) continue;
+            if (init.op_type != IROperandType::IMM || next.op_type != IROperandType::REG) continue;
+            auto def = defs.find(next.name);
+            if (def == defs.end()) continue;
+            const IRInstruction &upd = *def->second;
+            if (upd.op != IROp::ADD && upd.op != IROp::SUB) continue;
+            const IROperand &a = upd.args[0], &b = upd.args[1];
+            int64_t step;
+            if (a.op_type == IROperandType::REG && a.name == inst.result->name &&
+                b.op_type == IROperandType::IMM) {
+                step = upd.op == IROp::ADD ? b.imm_value : -int64_t(b.imm_value);
+            } else if (upd.op == IROp::ADD && b.op_type == IROperandType::REG &&
+                       b.name == inst.result->name && a.op_type == IROperandType::IMM) {
+                step = a.imm_value;
+            } else {
+                continue;
+            }
+            ivs.push_back({ init.imm_value, step, inst.result->name, next.name });
+        }
+
+        // test 的一边是归纳变量，另一边是常量
+        Rel rel = cond_br.op == IROp::BRLT ? Rel::LT : cond_br.op == IROp::BRGT ? Rel::GT : Rel::EQ;
+        const IROperand *iv_op = &test.args[0], *bound_op = &test.args[1];
+        if (iv_op->op_type == IROperandType::IMM) {
+            std::swap(iv_op, bound_op);
+            rel = swap_rel(rel);
+        }
+        if (iv_op->op_type != IROperandType::REG || bound_op->op_type != IROperandType::IMM) return;
+        if (!taken_stays) rel = negate_rel(rel);
+
+        for (const auto &iv : ivs) {
+            int64_t start;
+            if (iv_op->name == iv.phi) {
+                start = iv.start;
+            } else if (iv_op->name == iv.next) {
+                start = iv.start + iv.step;
+            } else {
+                continue;
+            }
+            long k = first_failure(start, iv.step, rel, bound_op->imm_value);
+            if (k < 0) return;
+            // 检查过程中的值必须都在 i32 范围内，否则会回绕
+            int64_t last = start + int64_t(k) * iv.step;
+            if (last < std::numeric_limits<int32_t>::min() ||
+                last > std::numeric_limits<int32_t>::max()) {
+                return;
+            }
+            // 退出条件在回边块（包括单块循环）：循环体先执行一次再判断，共执行 k + 1 次；
+            // 在循环头：条件成立 k 次，循环体执行 k 次
+            loop->backedge_taken_count = k;
+            loop->trip_count = exiting == latch ? k + 1 : k;
+            add_stat("constant trip counts");
+            return;
+        }
+    }
+
+    std::unordered_map<std::string, IRBasicBlock *> label_map;
+
+    static bool by_header_preorder(const LoopInfo *a, const LoopInfo *b) {
+        return a->header->dom_in < b->header->dom_in;
+    }
+
+    IRBasicBlock *block_of(const std::string &label) const {
+        auto it = label_map.find(label);
+        return it == label_map.end() ? nullptr : it->second;
+    }
+
+  public:
+    const char *name() const override {
+        return "loops";
+    }
+
+    bool run(IRFunction &F) override {
+        F.clear_loops();
+        label_map.clear();
+        for (auto &block : F.blocks) label_map[block->label] = block.get();
+
+        // 回边 n -> h（h 支配 n），按循环头分组
+        std::vector<IRBasicBlock *> headers;
+        std::unordered_map<IRBasicBlock *, std::vector<IRBasicBlock *>> latches;
+        for (auto &block : F.blocks) {
+            if (block->dom_in < 0) continue;
+            for (IRBasicBlock *succ : block->successors) {
+                if (!succ->dominates(block.get())) continue;
+                auto &l = latches[succ];
+                if (l.empty()) headers.push_back(succ);
+                l.push_back(block.get());
+            }
+        }
+
+        // 按支配树先序的逆序处理循环头，内层循环先于外层被发现
+        std::sort(headers.begin(), headers.end(),
+                  [](IRBasicBlock *a, IRBasicBlock *b) { return a->dom_in > b->dom_in; });
+        std::vector<std::unique_ptr<LoopInfo>> found;
+        for (IRBasicBlock *header : headers) {
+            auto loop = std::make_unique<LoopInfo>(header);
+            loop->latches = latches[header];
+            discover_loop(loop.get());
+            found.push_back(std::move(loop));
+        }
+
+        // 按先序（外层在前）整理，计算深度
+        for (auto &loop : found) {
+            if (!loop->parent) F.top_level_loops.push_back(loop.get());
+        }
+        std::sort(F.top_level_loops.begin(), F.top_level_loops.end(), by_header_preorder);
+        std::vector<LoopInfo *> order;
+        std::vector<LoopInfo *> stack(F.top_level_loops.rbegin(), F.top_level_loops.rend());
+        while (!stack.empty()) {
+            LoopInfo *loop = stack.back();
+            stack.pop_back();
+            loop->depth = loop->parent ? loop->parent->depth + 1 : 1;
+            order.push_back(loop);
+            std::sort(loop->sub_loops.begin(), loop->sub_loops.end(), by_header_preorder);
+            stack.insert(stack.end(), loop->sub_loops.rbegin(), loop->sub_loops.rend());
+        }
+        for (LoopInfo *loop : order) {
+            for (auto &owned : found) {
+                if (owned.get() == loop) F.loops.push_back(std::move(owned));
+            }
+        }
+
+        for (auto &loop : F.loops) {
+            loop->latches.clear();
+            fill_edges(F, loop.get());
+            compute_trip_count(loop.get());
+        }
+        add_stat("loops found", static_cast<long>(F.loops.size()));
+        return false;
+    }
+};
+
+// 循环规范化：每个循环都有预头块，每个退出块的前驱都在循环内（专用退出块）。
+// 新块会改变外层循环的块集合和支配树，所以每修改一处就重新计算两者
+class LoopSimplifyPass : public FunctionPass {
+  private:
+    // 规范化一个循环中的一处，没有需要修改的地方时返回 false
+    bool simplify_one(IRFunction &F, LoopInfo *loop) {
+        if (!loop->preheader) {
+            create_preheader(F, loop);
+            add_stat("preheaders created");
+            return true;
+        }
+        for (IRBasicBlock *exit : loop->exit_blocks) {
+            std::vector<IRBasicBlock *> inside;
+            bool dedicated = true;
+            for (IRBasicBlock *pred : exit->predecessors) {
+                if (loop->contains(pred)) {
+                    inside.push_back(pred);
+                } else {
+                    dedicated = false;
+                }
+            }
+            if (dedicated) continue;
+            split_edges(F, exit, inside, "loopexit" + exit->label);
+            add_stat("dedicated exits created");
+            return true;
+        }
+        return false;
+    }
+
+  public:
+    const char *name() const override {
+        return "loop-simplify";
+    }
+
+    bool run(IRFunction &F) override {
+        bool changed = false;
+        bool again = true;
+        while (again) {
+            again = false;
+            // 内层循环先处理
+            for (auto it = F.loops.rbegin(); it != F.loops.rend(); ++it) {
+                if (!simplify_one(F, it->get())) continue;
+                DominatorTreePass{}.run(F);
+                LoopAnalysisPass{}.run(F);
+                changed = again = true;
+                break;
+            }
+        }
+        return changed;
+    }
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// ========================================================
+// --- 复制循环的 Pass 共用的部分 ---
+// 循环展开、循环外提分支和循环旋转都要复制循环里的指令：副本中的寄存器换成新名字，
+// 新块的标签不能和已有的重名；前两者复制整个循环，还要按机器指令估计副本的大小，
+// 并且不能超出汇编器的标签表：整个模块最多 100 个标签，由 LabelBudgetPass 分给各个函数。
+// ========================================================
+
+// 块在汇编中占用的标签数：块标签本身，加上每个调用的返回地址标签
+inline int asm_labels(const IRBasicBlock &block) {
+    return 1 + static_cast<int>(std::count_if(
+                   block.insts.begin(), block.insts.end(),
+                   [](const IRInstruction &inst) { return inst.op == IROp::CALL; }));
+}
+
+// 函数在汇编中占用的标签数（含函数入口标签）
+inline int asm_labels(const IRFunction &F) {
+    int n = 1;
+    for (const auto &block : F.blocks) n += asm_labels(*block);
+    return n;
+}
+
+/**
+ * @brief 把汇编器标签表的剩余容量平均分给各个函数
+ * 函数级 Pass 可能并行运行、互相看不到对方新增的标签，因此在流水线之前按模块统一分配：
+ * 每个函数的上限是它现有的标签数加上一份均分的余量，复制循环的 Pass 不会让函数超过上限
+ */
+class LabelBudgetPass : public ModulePass {
+  private:
+    static constexpr int LABEL_LIMIT = 100;  // 汇编器标签表的大小（asm-machine 的 LABNUM）
+    static constexpr int LABEL_RESERVE = 10; // 留给拆分关键边、补预头块等其他 Pass 新增的标签
+
+  public:
+    bool run(IRModule &M) override {
+        if (M.functions.empty()) return false;
+        // 程序入口的返回标签 EXIT 和每个全局变量 / 字符串各占一个
+        int used = 1 + static_cast<int>(M.globals.size());
+        for (const auto &F : M.functions) used += asm_labels(F);
+        int share = std::max(0, LABEL_LIMIT - LABEL_RESERVE - used) /
+                    static_cast<int>(M.functions.size());
+        for (auto &F : M.functions) F.label_budget = asm_labels(F) + share;
+        return false;
+    }
+};
+
+// 副本中的寄存器按 values 换名，不在表中的操作数原样保留
+inline IROperand remap(const std::unordered_map<std::string, IROperand> &values,
+                       const IROperand &op) {
+    if (op.op_type != IROperandType::REG) return op;
+    auto it = values.find(op.name);
+    return it == values.end() ? op : it->second;
+}
+
+class LoopCloningPass : public FunctionPass {
+  protected:
+    // ---- 代价模型 ----
+    // 目标机指令定长 8 字节，代码、全局数据和栈共用 64KB 地址空间
+    static constexpr int INST_BYTES = 8;
+    static constexpr int ADDRESS_SPACE = 65536;
+    static constexpr int ASM_PER_IR = 3; // 一条 IR 平均生成的机器指令数
+
+    std::unordered_map<std::string, IRBasicBlock *> def_block; // 寄存器 -> 定义所在的块
+    std::unordered_set<std::string> labels;                    // 函数中已用的块标签
+
+    void index_defs(IRFunction &F) {
+        def_block.clear();
+        labels.clear();
+        for (auto &block : F.blocks) {
+            labels.insert(block->label);
+            for (auto &inst : block->insts) {
+                if (inst.result) def_block[inst.result->name] = block.get();
+            }
+        }
+    }
+
+    // 复制一份循环新增的汇编标签数
+    static int loop_labels(const LoopInfo *loop) {
+        int n = 0;
+        for (const IRBasicBlock *block : loop->blocks) n += asm_labels(*block);
+        return n;
+    }
+
+    // 函数再新增 n 个标签后仍在标签预算之内
+    static bool fits_labels(const IRFunction &F, long n) {
+        return F.label_budget < 0 || asm_labels(F) + n <= F.label_budget;
+    }
+
+    // 新块标签：汇编器只接受字母数字，新建的副本之间也不能和已有的重名
+    std::string fresh_label(const std::string &base) {
+        std::string label = base;
+        for (int n = 1; labels.contains(label); ++n) label = base + std::to_string(n);
+        labels.insert(label);
+        return label;
+    }
+};
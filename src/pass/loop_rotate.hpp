@@ -0,0 +1,248 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/loop_clone.hpp"
+#include "pass/simplify_cfg.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 循环旋转 ---
+// while / for 生成的循环在循环头判断：每次迭代都要 test、条件跳转进循环体，循环体末尾再无条件跳回。
+// 把循环头（PHI、计算条件的少量指令和退出判断）复制两份：
+// 一份放在预头块末尾作为守卫（不进入循环时直接去退出块），一份放在回边块末尾，
+// 由它的条件跳转直接回到循环体，原循环头删除，循环体入口成为新的循环头。
+// 循环头定义的值在新循环头和退出块里各用一个 PHI 合并两份副本。
+// 旋转之后每次迭代只执行一次条件回跳，循环有了被守卫的预头块，LICM 外提的指令不会在零次迭代时执行。
+// ========================================================
+
+class LoopRotatePass : public FunctionPass {
+  private:
+    static constexpr size_t MAX_HEADER_INSTS = 8; // 循环头里允许复制的非 PHI 指令数
+
+    // 在预头块和回边块各执行一次与原来在循环头执行一次效果相同的指令
+    static bool can_duplicate(const IRInstruction &inst) {
+        switch (inst.op) {
+            case IROp::ADD:
+            case IROp::SUB:
+            case IROp::MUL:
+            case IROp::DIV:
+            case IROp::GEP:
+            case IROp::LOAD:
+            case IROp::MOVE: return true;
+            default: return false;
+        }
+    }
+
+    static std::list<IRInstruction>::iterator after_label(IRBasicBlock *block) {
+        auto it = block->insts.begin();
+        if (it != block->insts.end() && it->op == IROp::LABEL) ++it;
+        return it;
+    }
+
+    static bool has_phi(const IRBasicBlock *block) {
+        return std::any_of(block->insts.begin(), block->insts.end(),
+                           [](const IRInstruction &inst) { return inst.op == IROp::PHI; });
+    }
+
+    // 循环头末尾的 test、条件跳转与 br；不满足旋转条件时返回空
+    static std::optional<std::list<IRInstruction>::iterator> exit_test(const LoopInfo *loop) {
+        IRBasicBlock *header = loop->header;
+        IRBasicBlock *latch = loop->single_latch();
+        if (!latch || latch == header || loop->exiting_blocks.size() != 1 ||
+            loop->exiting_blocks.front() != header || loop->exit_blocks.size() != 1) {
+            return std::nullopt;
+        }
+        // 回边块只无条件跳回循环头
+        if (latch->successors.size() != 1 || latch->insts.back().op != IROp::BR) {
+            return std::nullopt;
+        }
+
+        auto &insts = header->insts;
+        if (insts.size() < 4) return std::nullopt;
+        auto test = std::prev(insts.end(), 3);
+        if (test->op != IROp::TEST || !std::next(test)->is_cond_b() ||
+            insts.back().op != IROp::BR) {
+            return std::nullopt;
+        }
+        size_t duplicated = 0;
+        for (auto it = insts.begin(); it != test; ++it) {
+            if (it->op == IROp::LABEL || it->op == IROp::PHI) continue;
+            if (!can_duplicate(*it) || ++duplicated > MAX_HEADER_INSTS) return std::nullopt;
+        }
+        return test;
+    }
+
+    // 把循环头的 [first, last) 复制到 block 末尾的跳转之前，values 给出 PHI 的值并记录新定义
+    static void copy_header(IRFunction &F, IRBasicBlock *block,
+                            std::list<IRInstruction>::iterator first,
+                            std::list<IRInstruction>::iterator last,
+                            std::unordered_map<std::string, IROperand> &values) {
+        block->insts.pop_back(); // br header
+        for (auto it = first; it != last; ++it) {
+            if (it->op == IROp::LABEL || it->op == IROp::PHI) continue;
+            IRInstruction copy = *it;
+            for (auto &arg : copy.args) arg = remap(values, arg);
+            if (copy.result) {
+                copy.result = F.new_reg(it->result->type);
+                values[it->result->name] = *copy.result;
+            }
+            block->insts.push_back(std::move(copy));
+        }
+    }
+
+    bool rotate(IRFunction &F, LoopInfo *loop) {
+        std::optional<std::list<IRInstruction>::iterator> found = exit_test(loop);
+        if (!found) return false;
+        IRBasicBlock *header = loop->header;
+        IRBasicBlock *latch = loop->single_latch();
+        auto test = *found;
+        const IRInstruction &cond_br = *std::next(test);
+        const IRInstruction &br = header->insts.back();
+
+        IRBasicBlock *exit = loop->exit_blocks.front();
+        const std::string &body_label =
+            cond_br.args[0].name == exit->label ? br.args[0].name : cond_br.args[0].name;
+        auto body_it = std::find_if(header->successors.begin(), header->successors.end(),
+                                    [&](IRBasicBlock *b) { return b->label == body_label; });
+        if (body_it == header->successors.end()) return false;
+        IRBasicBlock *body = *body_it;
+        if (body == header || body->predecessors.size() != 1 || has_phi(body)) return false;
+        if (loop->preheader && loop->preheader->insts.back().op != IROp::BR) return false;
+
+        SimplifyCFGPass::make_fallthrough_explicit(F);
+        IRBasicBlock *preheader = create_preheader(F, loop);
+        // 退出块将有预头块和回边块两个前驱，需要时先给循环头一个专用的退出块
+        if (exit->predecessors.size() > 1) {
+            exit = split_edges(F, exit, { header }, "loopexit" + exit->label);
+        }
+
+        // 循环头定义的值在守卫和回边块里的两份副本
+        std::vector<IRInstruction *> phis;
+        std::vector<IROperand> header_values;
+        for (auto &inst : header->insts) {
+            if (inst.op == IROp::PHI) phis.push_back(&inst);
+            if (inst.result) header_values.push_back(*inst.result);
+        }
+        std::unordered_map<std::string, IROperand> entry_values, latch_values, body_values;
+        for (const IROperand &value : header_values) {
+            body_values[value.name] = F.new_reg(value.type);
+        }
+        for (IRInstruction *phi : phis) {
+            entry_values[phi->result->name] = *phi->incoming(preheader->label);
+            // 回边上的值若也是循环头的值，旋转后在新循环头里对应它的 PHI
+            latch_values[phi->result->name] =
+                remap(body_values, *phi->incoming(latch->label));
+        }
+        copy_header(F, preheader, header->insts.begin(), header->insts.end(), entry_values);
+        copy_header(F, latch, header->insts.begin(), header->insts.end(), latch_values);
+
+        // 新循环头和退出块里合并两份副本
+        auto phi_for = [&](const IROperand &value, const IROperand &result) {
+            return IRInstruction(IROp::PHI,
+                                 { remap(entry_values, value),
+                                   IROperand::create_label(preheader->label),
+                                   remap(latch_values, value),
+                                   IROperand::create_label(latch->label) },
+                                 result);
+        };
+        std::unordered_map<std::string, IROperand> exit_values;
+        for (auto &inst : exit->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            if (inst.op != IROp::PHI) break;
+            std::optional<IROperand> value = inst.incoming(header->label);
+            if (!value) continue;
+            std::vector<IROperand> args;
+            for (size_t i = 0; i + 1 < inst.args.size(); i += 2) {
+                if (inst.args[i + 1].name == header->label) continue;
+                args.push_back(inst.args[i]);
+                args.push_back(inst.args[i + 1]);
+            }
+            IRInstruction merged = phi_for(*value, *inst.result);
+            args.insert(args.end(), merged.args.begin(), merged.args.end());
+            inst.args = std::move(args);
+        }
+        auto body_pos = after_label(body);
+        auto exit_pos = after_label(exit);
+        std::unordered_set<std::string> new_phis;
+        for (const IROperand &value : header_values) {
+            exit_values[value.name] = F.new_reg(value.type);
+            body->insts.insert(body_pos, phi_for(value, body_values.at(value.name)));
+            exit->insts.insert(exit_pos, phi_for(value, exit_values.at(value.name)));
+            new_phis.insert(body_values.at(value.name).name);
+            new_phis.insert(exit_values.at(value.name).name);
+        }
+
+        // 其余的使用：循环内用新循环头的 PHI，循环外（都经过退出块）用退出块的 PHI
+        for (auto &block : F.blocks) {
+            if (block.get() == header) continue;
+            const auto &values = loop->contains(block.get()) ? body_values : exit_values;
+            for (auto &inst : block->insts) {
+                for (auto &arg : inst.args) arg = remap(values, arg);
+            }
+        }
+
+        std::erase_if(F.blocks, [&](const auto &b) { return b.get() == header; });
+        F.clear_loops();
+        F.clear_dominators();
+        remove_unused_phis(F, new_phis);
+        add_stat("loops rotated");
+        return true;
+    }
+
+    // 合并副本时为每个循环头的值都建了 PHI，删掉其中结果没有被使用的
+    static void remove_unused_phis(IRFunction &F, const std::unordered_set<std::string> &phis) {
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            std::unordered_set<std::string> used;
+            for (auto &block : F.blocks) {
+                for (auto &inst : block->insts) {
+                    for (auto &arg : inst.args) {
+                        if (arg.op_type == IROperandType::REG) used.insert(arg.name);
+                    }
+                }
+            }
+            for (auto &block : F.blocks) {
+                progress |= std::erase_if(block->insts, [&](const IRInstruction &inst) {
+                                return inst.op == IROp::PHI && phis.contains(inst.result->name) &&
+                                       !used.contains(inst.result->name);
+                            }) > 0;
+            }
+        }
+    }
+
+  public:
+    const char *name() const override {
+        return "loop-rotate";
+    }
+
+    bool run(IRFunction &F) override {
+        bool changed = false;
+        bool progress = true;
+        while (progress && !F.loops.empty()) {
+            progress = false;
+            for (auto it = F.loops.rbegin(); it != F.loops.rend(); ++it) {
+                if (!rotate(F, it->get())) continue;
+                progress = changed = true;
+                break;
+            }
+            if (!progress) break;
+            BuildCFGPass{}.run(F);
+            DeadBlockEliminationPass{}.run(F);
+            DominatorTreePass{}.run(F);
+            LoopAnalysisPass{}.run(F);
+        }
+        return changed;
+    }
+};
@@ -0,0 +1,442 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/loop_clone.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/scalar_evolution.hpp"
+#include "pass/simplify_cfg.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 循环展开 ---
+// 每次迭代都要付出循环控制的开销：test 的操作数重载、TST、条件跳转、回跳，
+// 以及分支前溢出所有寄存器时回边块末尾经过栈槽的 PHI 拷贝。
+// 1. 完全展开：常量迭代次数为 n 时把迭代复制 n 份首尾相接，删去所有退出判断，
+//    归纳变量在每份副本里都变成已知值，留给 SCCP / GVN 折叠；
+// 2. 带运行时余数的部分展开：退出条件为 "归纳变量 与 循环不变量 比较" 且随迭代单调时，
+//    在原循环前放一个展开 K 次的循环，循环头一次判断 "接下来 K 次判断都会留在循环里"，
+//    成立就连续执行 K 份没有退出判断的副本，否则进入原循环执行剩下的（不足 K 次的）迭代。
+// 展开因子由代价模型决定：节省的周期按循环控制开销在一次迭代中的占比估计，
+// 代码大小按机器指令定长 8 字节估计，受 64KB 地址空间的预算限制。
+// 只处理最内层、只有一个回边块、唯一退出块是循环头或回边块的循环；和 SCEV 一样假定归纳变量不回绕。
+// ========================================================
+
+class LoopUnrollPass : public LoopCloningPass {
+  private:
+    // ---- 代价模型（指令大小与地址空间见 LoopCloningPass）----
+    static constexpr int FUNCTION_BUDGET = ADDRESS_SPACE / 16; // 每个函数因展开增加的字节数上限
+    static constexpr int LOOP_BUDGET = ADDRESS_SPACE / 64;     // 展开后一个循环的字节数上限
+    static constexpr int MAX_FACTOR = 8;
+    static constexpr int MIN_GAIN = 16; // 因子再翻倍至少要省下循环时间的 1/16
+    // 一次迭代的控制开销：test 两个操作数的重载、TST、条件跳转与回跳；每个循环头 PHI 另加一次拷贝
+    static constexpr int CONTROL_CYCLES = 26;
+    static constexpr int PHI_COPY_CYCLES = 30;
+
+    static int cycles(const IRInstruction &inst) {
+        switch (inst.op) {
+            case IROp::LOAD:
+            case IROp::STORE: return 12;
+            case IROp::MUL:
+            case IROp::DIV: return 7;
+            case IROp::CALL: return 40;
+            default: return 3;
+        }
+    }
+
+    static bool is_control(const IRInstruction &inst) {
+        return inst.op == IROp::LABEL || inst.op == IROp::PHI || inst.op == IROp::TEST ||
+               inst.op == IROp::BR || inst.is_cond_b();
+    }
+
+    // 满足展开条件的循环
+    struct LoopShape {
+        LoopInfo *loop;
+        std::vector<IRBasicBlock *> blocks; // 按块布局顺序
+        IRBasicBlock *latch, *exiting, *exit;
+        std::string stay;                   // 退出块留在循环内的后继
+        std::vector<IRInstruction *> phis;  // 循环头的 PHI
+        IRInstruction *test, *cond_br;
+        int size = 0;      // 一份副本的估计字节数
+        int labels = 0;    // 一份副本新增的汇编标签数
+        int overhead = 0;  // 一次迭代的控制开销（周期）
+        int body = 0;      // 一次迭代其余部分的周期
+    };
+
+    // 部分展开时 test 中的归纳变量操作数 = phi + offset，步长 step
+    struct Guard {
+        size_t index;
+        IRInstruction *phi;
+        int64_t offset, step;
+    };
+
+    std::unordered_set<std::string> unrolled; // 本次运行已展开过的循环头
+    int budget = 0;
+
+    bool is_invariant(const IROperand &op, const LoopInfo *loop) const {
+        if (op.op_type != IROperandType::REG) return true;
+        auto it = def_block.find(op.name);
+        return it == def_block.end() || !loop->contains(it->second);
+    }
+
+    std::optional<LoopShape> analyze(IRFunction &F, LoopInfo *loop) const {
+        if (!loop->sub_loops.empty() || unrolled.contains(loop->header->label)) return std::nullopt;
+        IRBasicBlock *latch = loop->single_latch();
+        if (!latch || loop->exiting_blocks.size() != 1 || loop->exit_blocks.size() != 1) {
+            return std::nullopt;
+        }
+        IRBasicBlock *exiting = loop->exiting_blocks.front();
+        if (exiting != loop->header && exiting != latch) return std::nullopt;
+
+        // 退出块末尾：test a b; brX L1; br L2
+        auto &insts = exiting->insts;
+        if (insts.size() < 4) return std::nullopt;
+        auto it = std::prev(insts.end());
+        IRInstruction &br = *it--;
+        IRInstruction &cond_br = *it--;
+        IRInstruction &test = *it;
+        if (br.op != IROp::BR || !cond_br.is_cond_b() || test.op != IROp::TEST) return std::nullopt;
+
+        LoopShape shape{ loop, {}, latch, exiting, loop->exit_blocks.front(), "", {}, &test,
+                         &cond_br };
+        const std::string &exit_label = shape.exit->label;
+        if ((cond_br.args[0].name == exit_label) == (br.args[0].name == exit_label)) {
+            return std::nullopt;
+        }
+        shape.stay = cond_br.args[0].name == exit_label ? br.args[0].name : cond_br.args[0].name;
+
+        // 在循环头退出时，循环头里只能有 PHI 和退出判断（其余的值在最后一次判断时没有副本）
+        bool exits_at_header = exiting != latch;
+        for (auto &block : F.blocks) {
+            if (!loop->contains(block.get())) continue;
+            shape.blocks.push_back(block.get());
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::ALLOCA || inst.op == IROp::RET) return std::nullopt;
+                if (block.get() == loop->header && inst.op == IROp::PHI) {
+                    shape.phis.push_back(&inst);
+                    continue;
+                }
+                if (is_control(inst)) continue;
+                if (exits_at_header && block.get() == loop->header) return std::nullopt;
+                shape.size += ASM_PER_IR * INST_BYTES;
+                shape.body += cycles(inst);
+            }
+        }
+        shape.size = std::max(shape.size, ASM_PER_IR * INST_BYTES);
+        shape.labels = loop_labels(loop);
+        shape.overhead = CONTROL_CYCLES + PHI_COPY_CYCLES * static_cast<int>(shape.phis.size());
+        return shape;
+    }
+
+    // 迭代越往后越可能退出时，K 次判断中最后一次留在循环里就说明前面的也都留在循环里
+    std::optional<Guard> find_guard(ScalarEvolution &se, const LoopShape &shape) const {
+        const IRInstruction &test = *shape.test;
+        if (shape.cond_br->op == IROp::BRZ) return std::nullopt;
+        for (size_t index = 0; index < 2; ++index) {
+            const SCEV *iv = se.get(test.args[index]);
+            if (!iv->is_affine() || iv->loop != shape.loop) continue;
+            if (!is_invariant(test.args[1 - index], shape.loop)) return std::nullopt;
+            int64_t step = iv->step()->value;
+            bool taken_when_small = (shape.cond_br->op == IROp::BRLT) == (index == 0);
+            bool taken_stays = shape.cond_br->args[0].name == shape.stay;
+            bool stays_when_small = taken_when_small == taken_stays;
+            if (step == 0 || stays_when_small != (step > 0)) return std::nullopt;
+
+            for (IRInstruction *phi : shape.phis) {
+                const SCEV *s = se.get(phi->result->name);
+                if (!s->is_affine() || s->loop != shape.loop || s->step() != iv->step()) continue;
+                const SCEV *offset = se.get_minus(iv->start(), s->start());
+                if (offset->is_constant()) return Guard{ index, phi, offset->value, step };
+            }
+            return std::nullopt;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief 复制 count 份迭代，首尾相接
+     * 第 k 份副本的退出判断删去，跳回循环头的边改到第 k+1 份，最后一份跳到 after；
+     * 第 0 份副本中循环头 PHI 的值为 first，之后每份为上一份从回边块进来的值
+     * @param[out] final 最后一份副本之后循环头 PHI 的值
+     * @param[out] last 最后一份副本的值映射
+     * @return 新块（按副本、块布局顺序）
+     */
+    std::vector<std::unique_ptr<IRBasicBlock>>
+    clone_iterations(IRFunction &F, const LoopShape &shape, int count,
+                     std::unordered_map<std::string, IROperand> first, const std::string &after,
+                     std::unordered_map<std::string, IROperand> &final,
+                     std::unordered_map<std::string, IROperand> &last,
+                     std::vector<std::unordered_map<std::string, std::string>> &block_labels) {
+        IRBasicBlock *header = shape.loop->header;
+        block_labels.assign(count, {});
+        for (int k = 0; k < count; ++k) {
+            for (IRBasicBlock *block : shape.blocks) {
+                block_labels[k][block->label] = fresh_label(block->label + "u" + std::to_string(k));
+            }
+        }
+
+        std::vector<std::unique_ptr<IRBasicBlock>> out;
+        std::unordered_map<std::string, IROperand> values = std::move(first);
+        for (int k = 0; k < count; ++k) {
+            const auto &labels_k = block_labels[k];
+            std::string next_header = k + 1 < count ? block_labels[k + 1].at(header->label) : after;
+            auto map_label = [&](const std::string &label) {
+                if (label == header->label) return next_header;
+                auto it = labels_k.find(label);
+                return it == labels_k.end() ? label : it->second;
+            };
+
+            // 先给副本里定义的值取新名字（块布局顺序不一定是支配顺序）
+            for (IRBasicBlock *block : shape.blocks) {
+                for (auto &inst : block->insts) {
+                    if (!inst.result || (block == header && inst.op == IROp::PHI)) continue;
+                    values[inst.result->name] = F.new_reg(inst.result->type);
+                }
+            }
+            for (IRBasicBlock *block : shape.blocks) {
+                std::string label = labels_k.at(block->label);
+                auto copy = std::make_unique<IRBasicBlock>(label);
+                copy->insts.emplace_back(IROp::LABEL,
+                                         std::vector{ IROperand::create_label(label) });
+                for (auto &inst : block->insts) {
+                    if (inst.op == IROp::LABEL) continue;
+                    if (block == header && inst.op == IROp::PHI) continue;
+                    if (block == shape.exiting && (&inst == shape.test || &inst == shape.cond_br)) {
+                        continue;
+                    }
+                    // 退出判断删去之后只剩留在循环内的那条边
+                    if (block == shape.exiting && inst.op == IROp::BR) {
+                        std::string stay = map_label(shape.stay);
+                        copy->insts.emplace_back(IROp::BR,
+                                                 std::vector{ IROperand::create_label(stay) });
+                        continue;
+                    }
+                    IRInstruction clone = inst;
+                    for (auto &arg : clone.args) {
+                        if (arg.op_type == IROperandType::LABEL) {
+                            // 循环内块的 PHI 入边来自同一份副本，不会是回边
+                            arg.name = clone.op == IROp::PHI ? labels_k.at(arg.name)
+                                                             : map_label(arg.name);
+                        } else {
+                            arg = remap(values, arg);
+                        }
+                    }
+                    if (clone.result) clone.result = values.at(inst.result->name);
+                    copy->insts.push_back(std::move(clone));
+                }
+                out.push_back(std::move(copy));
+            }
+
+            std::unordered_map<std::string, IROperand> next;
+            for (IRInstruction *phi : shape.phis) {
+                next[phi->result->name] = remap(values, *phi->incoming(shape.latch->label));
+            }
+            if (k + 1 == count) {
+                final = next;
+                last = values;
+            }
+            for (auto &[name, value] : next) values[name] = value;
+        }
+        return out;
+    }
+
+    // 新块放在循环头之前
+    static void insert_blocks(IRFunction &F, IRBasicBlock *before,
+                              std::vector<std::unique_ptr<IRBasicBlock>> &blocks) {
+        auto it = std::find_if(F.blocks.begin(), F.blocks.end(),
+                               [before](const auto &b) { return b.get() == before; });
+        F.blocks.insert(it, std::make_move_iterator(blocks.begin()),
+                        std::make_move_iterator(blocks.end()));
+    }
+
+    static void retarget(IRBasicBlock *block, const std::string &from, const std::string &to) {
+        for (auto &inst : block->insts) {
+            if (!inst.is_terminator() && !inst.is_cond_b()) continue;
+            for (auto &arg : inst.args) {
+                if (arg.op_type == IROperandType::LABEL && arg.name == from) arg.name = to;
+            }
+        }
+    }
+
+    void unroll_fully(IRFunction &F, const LoopShape &shape, int count) {
+        LoopInfo *loop = shape.loop;
+        IRBasicBlock *header = loop->header;
+        IRBasicBlock *preheader = loop->preheader;
+        std::unordered_map<std::string, IROperand> first, final, last;
+        for (IRInstruction *phi : shape.phis) {
+            first[phi->result->name] = *phi->incoming(preheader->label);
+        }
+        std::vector<std::unordered_map<std::string, std::string>> block_labels;
+        auto blocks = clone_iterations(F, shape, count, first, shape.exit->label, final, last,
+                                       block_labels);
+        // 在回边块退出时，退出时的值是最后一份副本里的值；在循环头退出时是再回到循环头时 PHI 的值
+        if (shape.exiting == shape.latch) final = last;
+        std::string from = block_labels.back().at(shape.latch->label);
+
+        for (auto &inst : shape.exit->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            if (inst.op != IROp::PHI) break;
+            for (size_t i = 0; i + 1 < inst.args.size(); i += 2) {
+                if (inst.args[i + 1].name != shape.exiting->label) continue;
+                inst.args[i] = remap(final, inst.args[i]);
+                inst.args[i + 1] = IROperand::create_label(from);
+            }
+        }
+        for (auto &block : F.blocks) {
+            if (loop->contains(block.get())) continue;
+            for (auto &inst : block->insts) {
+                for (auto &arg : inst.args) {
+                    if (arg.op_type == IROperandType::REG && is_invariant(arg, loop)) continue;
+                    arg = remap(final, arg);
+                }
+            }
+        }
+        retarget(preheader, header->label, block_labels.front().at(header->label));
+
+        insert_blocks(F, header, blocks);
+        std::erase_if(F.blocks, [&](const auto &b) { return loop->contains(b.get()); });
+        F.clear_loops();
+        F.clear_dominators();
+    }
+
+    void unroll_with_remainder(IRFunction &F, const LoopShape &shape, const Guard &guard,
+                               int factor) {
+        IRBasicBlock *header = shape.loop->header;
+        IRBasicBlock *preheader = shape.loop->preheader;
+        std::string label = fresh_label("unrolled" + header->label);
+
+        // 展开后的循环头：PHI 从预头块和最后一份副本进来
+        auto unrolled_header = std::make_unique<IRBasicBlock>(label);
+        unrolled_header->insts.emplace_back(IROp::LABEL,
+                                            std::vector{ IROperand::create_label(label) });
+        std::unordered_map<std::string, IROperand> first, final, last;
+        std::vector<IRInstruction *> new_phis;
+        for (IRInstruction *phi : shape.phis) {
+            IROperand value = F.new_reg(phi->result->type);
+            unrolled_header->insts.emplace_back(
+                IROp::PHI,
+                std::vector{ *phi->incoming(preheader->label),
+                             IROperand::create_label(preheader->label) },
+                value);
+            new_phis.push_back(&unrolled_header->insts.back());
+            first[phi->result->name] = value;
+        }
+
+        std::vector<std::unordered_map<std::string, std::string>> block_labels;
+        auto blocks = clone_iterations(F, shape, factor, first, label, final, last, block_labels);
+        std::string from = block_labels.back().at(shape.latch->label);
+        for (size_t i = 0; i < shape.phis.size(); ++i) {
+            new_phis[i]->args.push_back(final.at(shape.phis[i]->result->name));
+            new_phis[i]->args.push_back(IROperand::create_label(from));
+        }
+
+        // 判断第 factor 次检查时归纳变量的值：iv = phi + offset + (factor - 1) * step
+        IROperand iv = first.at(guard.phi->result->name);
+        int64_t delta = guard.offset + (factor - 1) * guard.step;
+        IRInstruction test = *shape.test;
+        if (delta != 0) {
+            IROperand sum = F.new_reg(iv.type);
+            IROperand imm = IROperand::create_imm(static_cast<int>(delta), iv.type);
+            unrolled_header->insts.emplace_back(IROp::ADD, std::vector{ iv, imm }, sum);
+            iv = sum;
+        }
+        test.args[guard.index] = iv;
+        unrolled_header->insts.push_back(std::move(test));
+        // 成立时进入第一份副本，否则由原循环执行剩下的迭代
+        std::string body = block_labels.front().at(header->label);
+        for (IRInstruction *branch : { shape.cond_br, &shape.exiting->insts.back() }) {
+            IRInstruction copy = *branch;
+            copy.args[0].name = copy.args[0].name == shape.stay ? body : header->label;
+            unrolled_header->insts.push_back(std::move(copy));
+        }
+
+        for (IRInstruction *phi : shape.phis) {
+            for (size_t i = 0; i + 1 < phi->args.size(); i += 2) {
+                if (phi->args[i + 1].name != preheader->label) continue;
+                phi->args[i] = first.at(phi->result->name);
+                phi->args[i + 1] = IROperand::create_label(label);
+            }
+        }
+        retarget(preheader, header->label, label);
+
+        blocks.insert(blocks.begin(), std::move(unrolled_header));
+        insert_blocks(F, header, blocks);
+        F.clear_loops();
+        unrolled.insert(label);
+        unrolled.insert(header->label);
+    }
+
+    // 选择展开方式并展开；返回 false 表示不值得展开
+    bool unroll(IRFunction &F, ScalarEvolution &se, LoopShape &shape) {
+        LoopInfo *loop = shape.loop;
+        long trip = loop->trip_count;
+        if (trip > 0 && trip * shape.size <= LOOP_BUDGET && (trip - 1) * shape.size <= budget &&
+            fits_labels(F, (trip - 1) * shape.labels)) {
+            SimplifyCFGPass::make_fallthrough_explicit(F);
+            create_preheader(F, loop);
+            budget -= static_cast<int>((trip - 1) * shape.size);
+            unroll_fully(F, shape, static_cast<int>(trip));
+            add_stat("loops fully unrolled");
+            return true;
+        }
+
+        // 因子 K 相对 K/2 多省下控制开销的 1/K；K 份副本之外还有展开后的循环头
+        int factor = MAX_FACTOR;
+        while (factor > 1 &&
+               (factor * (shape.overhead + shape.body) > MIN_GAIN * shape.overhead ||
+                factor * shape.size > std::min(LOOP_BUDGET, budget) ||
+                !fits_labels(F, factor * shape.labels + 1) ||
+                (trip >= 0 && factor > trip))) {
+            factor /= 2;
+        }
+        if (factor < 2) return false;
+        std::optional<Guard> guard = find_guard(se, shape);
+        if (!guard) return false;
+
+        SimplifyCFGPass::make_fallthrough_explicit(F);
+        create_preheader(F, loop);
+        budget -= factor * shape.size;
+        unroll_with_remainder(F, shape, *guard, factor);
+        add_stat("loops unrolled with runtime remainder");
+        return true;
+    }
+
+  public:
+    const char *name() const override {
+        return "loop-unroll";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.loops.empty()) return false;
+        unrolled.clear();
+        budget = FUNCTION_BUDGET;
+        bool changed = false;
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            index_defs(F);
+            ScalarEvolution se(F);
+            for (auto it = F.loops.rbegin(); it != F.loops.rend() && !progress; ++it) {
+                std::optional<LoopShape> shape = analyze(F, it->get());
+                if (shape && unroll(F, se, *shape)) progress = true;
+            }
+            if (!progress) break;
+            changed = true;
+            // 展开改变了 CFG：重建分析后再找下一个循环
+            BuildCFGPass{}.run(F);
+            DeadBlockEliminationPass{}.run(F);
+            DominatorTreePass{}.run(F);
+            LoopAnalysisPass{}.run(F);
+        }
+        return changed;
+    }
+};
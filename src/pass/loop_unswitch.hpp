@@ -0,0 +1,289 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/loop_clone.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/simplify_cfg.hpp"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 循环外提分支（unswitching）---
+// 循环里形如 if (flag == 1) 的分支，条件的两个操作数都在循环外定义，每次迭代的结果都一样，
+// 但 LICM 只能外提操作数，每次迭代仍要重载操作数、TST 并条件跳转（跳转前还要溢出寄存器）。
+// 把整个循环复制一份：原循环对应条件成立，副本对应不成立，两份里的这个分支都改成无条件跳转，
+// 判断本身移到预头块，按结果进入其中一份。退出块的 PHI 为副本补上入边，
+// 循环内定义、在循环外使用的值在唯一的退出块里用 PHI 合并两份。
+// 复制使代码翻倍，按机器指令定长 8 字节估计循环大小，受 64KB 地址空间的预算限制。
+// ========================================================
+
+class LoopUnswitchPass : public LoopCloningPass {
+  private:
+    // ---- 代价模型（指令大小与地址空间见 LoopCloningPass）----
+    static constexpr int FUNCTION_BUDGET = ADDRESS_SPACE / 32; // 每个函数因复制循环增加的字节数上限
+    static constexpr int LOOP_BUDGET = ADDRESS_SPACE / 64;     // 被复制的循环的字节数上限
+
+    int budget = 0;
+
+    bool defined_in(const IROperand &op, const LoopInfo *loop) const {
+        if (op.op_type != IROperandType::REG) return false;
+        auto it = def_block.find(op.name);
+        return it != def_block.end() && loop->contains(it->second);
+    }
+
+    // 循环内末尾为 test a b; brX L1; br L2、a 和 b 都是循环不变量的块
+    IRBasicBlock *find_branch(IRFunction &F, const LoopInfo *loop) const {
+        for (auto &block : F.blocks) {
+            if (!loop->contains(block.get()) || block->insts.size() < 4) continue;
+            auto it = std::prev(block->insts.end());
+            const IRInstruction &br = *it--;
+            const IRInstruction &cond_br = *it--;
+            const IRInstruction &test = *it;
+            if (br.op != IROp::BR || !cond_br.is_cond_b() || test.op != IROp::TEST) continue;
+            if (br.args[0].name == cond_br.args[0].name) continue;
+            // 两个都是立即数的留给 SCCP 折叠
+            bool has_reg = false, invariant = true;
+            for (const auto &arg : test.args) {
+                has_reg |= arg.op_type == IROperandType::REG;
+                invariant &= !defined_in(arg, loop);
+            }
+            if (has_reg && invariant) return block.get();
+        }
+        return nullptr;
+    }
+
+    // 一份循环的估计字节数；含 alloca 的循环不复制，返回 -1
+    static int loop_size(IRFunction &F, const LoopInfo *loop) {
+        int size = 0;
+        for (auto &block : F.blocks) {
+            if (!loop->contains(block.get())) continue;
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::ALLOCA) return -1;
+                if (inst.op == IROp::LABEL || inst.op == IROp::PHI) continue;
+                size += ASM_PER_IR * INST_BYTES;
+            }
+        }
+        return size;
+    }
+
+    // 复制需要预头块和专用退出块；补上了任何一个时返回 true，调用者重新计算循环信息
+    bool prepare_loop(IRFunction &F, LoopInfo *loop) {
+        if (!loop->preheader) {
+            create_preheader(F, loop);
+            add_stat("preheaders created");
+            return true;
+        }
+        for (IRBasicBlock *exit : loop->exit_blocks) {
+            std::vector<IRBasicBlock *> inside;
+            for (IRBasicBlock *pred : exit->predecessors) {
+                if (loop->contains(pred)) inside.push_back(pred);
+            }
+            if (inside.size() == exit->predecessors.size()) continue;
+            split_edges(F, exit, inside, "loopexit" + exit->label);
+            add_stat("dedicated exits created");
+            return true;
+        }
+        return false;
+    }
+
+    // 对循环外的每个寄存器操作数调用 fn；退出块 PHI 来自循环内的入边属于循环内的使用，跳过
+    template <typename Fn>
+    static void for_outside_uses(IRFunction &F, const LoopInfo *loop, Fn &&fn) {
+        std::unordered_set<std::string> loop_labels;
+        for (IRBasicBlock *block : loop->blocks) loop_labels.insert(block->label);
+        for (auto &block : F.blocks) {
+            if (loop->contains(block.get())) continue;
+            for (auto &inst : block->insts) {
+                for (size_t i = 0; i < inst.args.size(); ++i) {
+                    IROperand &arg = inst.args[i];
+                    if (arg.op_type != IROperandType::REG) continue;
+                    if (inst.op == IROp::PHI && i + 1 < inst.args.size() &&
+                        loop_labels.contains(inst.args[i + 1].name)) {
+                        continue;
+                    }
+                    fn(arg);
+                }
+            }
+        }
+    }
+
+    // 循环内定义、在循环外使用的值
+    std::vector<IROperand> escaping_values(IRFunction &F, const LoopInfo *loop) const {
+        std::vector<IROperand> values;
+        std::unordered_set<std::string> seen;
+        for_outside_uses(F, loop, [&](IROperand &arg) {
+            if (defined_in(arg, loop) && seen.insert(arg.name).second) values.push_back(arg);
+        });
+        return values;
+    }
+
+    // 删去 block 中 PHI 来自 label 的入边
+    static void remove_incoming(IRBasicBlock *block, const std::string &label) {
+        for (auto &inst : block->insts) {
+            if (inst.op != IROp::PHI) continue;
+            std::vector<IROperand> args;
+            for (size_t i = 0; i + 1 < inst.args.size(); i += 2) {
+                if (inst.args[i + 1].name == label) continue;
+                args.push_back(inst.args[i]);
+                args.push_back(inst.args[i + 1]);
+            }
+            inst.args = std::move(args);
+        }
+    }
+
+    // 条件分支改为只跳到 target，另一个后继的 PHI 删去这条入边
+    static void fold_branch(IRBasicBlock *block, const std::string &target,
+                            const std::unordered_map<std::string, IRBasicBlock *> &blocks) {
+        auto br = std::prev(block->insts.end());
+        auto cond_br = std::prev(br);
+        std::string dropped = br->args[0].name == target ? cond_br->args[0].name : br->args[0].name;
+        block->insts.erase(std::prev(cond_br), br);
+        br->args[0].name = target;
+        remove_incoming(blocks.at(dropped), block->label);
+    }
+
+    void unswitch(IRFunction &F, LoopInfo *loop, IRBasicBlock *branch,
+                  const std::vector<IROperand> &escaping) {
+        IRBasicBlock *header = loop->header;
+        IRBasicBlock *preheader = loop->preheader;
+        std::vector<IRBasicBlock *> blocks;
+        for (auto &block : F.blocks) {
+            if (loop->contains(block.get())) blocks.push_back(block.get());
+        }
+
+        // 在唯一的退出块里合并循环外使用的值；两份的入边在下面和其他退出块 PHI 一起补上
+        std::unordered_map<std::string, IROperand> exit_values;
+        for (const IROperand &value : escaping) exit_values[value.name] = F.new_reg(value.type);
+        for_outside_uses(F, loop, [&](IROperand &arg) { arg = remap(exit_values, arg); });
+        if (!escaping.empty()) {
+            IRBasicBlock *exit = loop->exit_blocks.front();
+            auto pos = std::next(exit->insts.begin());
+            for (const IROperand &value : escaping) {
+                std::vector<IROperand> args;
+                for (IRBasicBlock *pred : exit->predecessors) {
+                    args.push_back(value);
+                    args.push_back(IROperand::create_label(pred->label));
+                }
+                exit->insts.insert(pos, IRInstruction(IROp::PHI, args, exit_values.at(value.name)));
+            }
+        }
+
+        // 复制循环：块和值都取新名字，跳到循环外的边不变
+        std::unordered_map<std::string, std::string> block_labels;
+        std::unordered_map<std::string, IROperand> values;
+        for (IRBasicBlock *block : blocks) {
+            block_labels[block->label] = fresh_label(block->label + "us");
+            for (auto &inst : block->insts) {
+                if (inst.result) values[inst.result->name] = F.new_reg(inst.result->type);
+            }
+        }
+        std::vector<std::unique_ptr<IRBasicBlock>> copies;
+        for (IRBasicBlock *block : blocks) {
+            auto copy = std::make_unique<IRBasicBlock>(block_labels.at(block->label));
+            for (auto &inst : block->insts) {
+                IRInstruction clone = inst;
+                for (auto &arg : clone.args) {
+                    if (arg.op_type != IROperandType::LABEL) {
+                        arg = remap(values, arg);
+                        continue;
+                    }
+                    auto it = block_labels.find(arg.name);
+                    if (it != block_labels.end()) arg.name = it->second;
+                }
+                if (clone.result) clone.result = values.at(inst.result->name);
+                copy->insts.push_back(std::move(clone));
+            }
+            copies.push_back(std::move(copy));
+        }
+        for (IRBasicBlock *exit : loop->exit_blocks) {
+            for (auto &inst : exit->insts) {
+                if (inst.op != IROp::PHI) continue;
+                size_t n = inst.args.size();
+                for (size_t i = 0; i + 1 < n; i += 2) {
+                    auto it = block_labels.find(inst.args[i + 1].name);
+                    if (it == block_labels.end()) continue;
+                    inst.args.push_back(remap(values, inst.args[i]));
+                    inst.args.push_back(IROperand::create_label(it->second));
+                }
+            }
+        }
+
+        // 预头块判断一次：成立进入原循环，否则进入副本
+        auto test = std::prev(branch->insts.end(), 3);
+        IRInstruction cond_br = *std::next(test);
+        std::string taken = cond_br.args[0].name;
+        std::string other = branch->insts.back().args[0].name;
+        preheader->insts.pop_back(); // br header
+        preheader->insts.push_back(*test);
+        cond_br.args[0].name = header->label;
+        preheader->insts.push_back(std::move(cond_br));
+        preheader->insts.emplace_back(
+            IROp::BR, std::vector{ IROperand::create_label(block_labels.at(header->label)) });
+
+        std::unordered_map<std::string, IRBasicBlock *> label_map;
+        for (auto &block : F.blocks) label_map[block->label] = block.get();
+        for (auto &copy : copies) label_map[copy->label] = copy.get();
+        auto copied = [&](const std::string &label) {
+            auto it = block_labels.find(label);
+            return it == block_labels.end() ? label : it->second;
+        };
+        fold_branch(branch, taken, label_map);
+        fold_branch(label_map.at(copied(branch->label)), copied(other), label_map);
+
+        // 副本放在原循环最后一个块之后
+        auto last = std::find_if(F.blocks.begin(), F.blocks.end(),
+                                 [&](const auto &b) { return b.get() == blocks.back(); });
+        F.blocks.insert(std::next(last), std::make_move_iterator(copies.begin()),
+                        std::make_move_iterator(copies.end()));
+        F.clear_loops();
+        add_stat("branches unswitched");
+    }
+
+  public:
+    const char *name() const override {
+        return "loop-unswitch";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.loops.empty()) return false;
+        budget = FUNCTION_BUDGET;
+        bool changed = false;
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            index_defs(F);
+            // 内层循环先处理：条件对外层也不变时，外层之后会把两份内层循环一起复制
+            for (auto it = F.loops.rbegin(); it != F.loops.rend() && !progress; ++it) {
+                LoopInfo *loop = it->get();
+                IRBasicBlock *branch = find_branch(F, loop);
+                if (!branch) continue;
+                int size = loop_size(F, loop);
+                if (size < 0 || size > std::min(LOOP_BUDGET, budget)) continue;
+                if (!fits_labels(F, loop_labels(loop))) continue;
+                std::vector<IROperand> escaping = escaping_values(F, loop);
+                if (!escaping.empty() && loop->exit_blocks.size() != 1) continue;
+
+                SimplifyCFGPass::make_fallthrough_explicit(F);
+                progress = true;
+                if (prepare_loop(F, loop)) break;
+                budget -= size;
+                unswitch(F, loop, branch, escaping);
+            }
+            if (!progress) break;
+            changed = true;
+            // 复制改变了 CFG：重建分析后再找下一个分支
+            BuildCFGPass{}.run(F);
+            DeadBlockEliminationPass{}.run(F);
+            DominatorTreePass{}.run(F);
+            LoopAnalysisPass{}.run(F);
+        }
+        return changed;
+    }
+};
@@ -0,0 +1,339 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/scalar_evolution.hpp"
+#include "type.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 循环强度削减（LSR） ---
+// 循环里以本循环归纳变量 i = {start,+,step} 为下标的 GEP 每次迭代都要算 base + i * size（MUL）。
+// 把地址到 i 那一层为止的前缀做成指针归纳变量：预头块里按 start 算初值，回边块里前进 step 个元素
+// （常量下标的 GEP 在代码生成时不需要乘法）；原来的 GEP 改为在指针上取剩下的下标
+// （结构体字段、内层常量下标），没有剩下的就直接用指针。
+// 改写之后计数器只剩循环里的比较在用时，把比较换成指针与预头块里算好的边界指针比较，删掉计数器。
+// ========================================================
+
+class LoopStrengthReducePass : public FunctionPass {
+  private:
+    // 循环头上步长为常量的基本归纳变量
+    struct InductionVar {
+        IRInstruction *phi;
+        IROperand start; // 从预头块进来的值
+        IROperand next;  // 从回边块进来的值
+        int64_t step;
+    };
+
+    // 由一个归纳变量派生出的指针归纳变量
+    struct PointerIV {
+        const InductionVar *iv;
+        std::vector<IROperand> prefix; // 到归纳变量那一层为止的 GEP 操作数
+        size_t position;               // 归纳变量在 prefix 中的下标
+        IROperand phi, next;
+    };
+
+    std::unordered_map<std::string, IRBasicBlock *> def_block;
+    std::unordered_map<std::string, IRInstruction *> def_inst;
+
+    void index_defs(IRFunction &F) {
+        def_block.clear();
+        def_inst.clear();
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                if (!inst.result) continue;
+                def_block[inst.result->name] = block.get();
+                def_inst[inst.result->name] = &inst;
+            }
+        }
+    }
+
+    // 常量、全局变量、参数以及在循环外定义的寄存器
+    bool is_invariant(const IROperand &op, const LoopInfo *loop) const {
+        if (op.op_type != IROperandType::REG) return true;
+        auto it = def_block.find(op.name);
+        return it == def_block.end() || !loop->contains(it->second);
+    }
+
+    std::vector<InductionVar> find_induction_vars(ScalarEvolution &se, LoopInfo *loop) {
+        std::vector<InductionVar> ivs;
+        IRBasicBlock *latch = loop->latches.front();
+        for (auto &inst : loop->header->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            if (inst.op != IROp::PHI) break;
+            if (inst.args.size() != 4 || !inst.result->type->is_int()) continue;
+            const SCEV *s = se.get(inst.result->name);
+            if (!s->is_affine() || s->loop != loop || s->step()->is_zero()) continue;
+            size_t in = inst.args[1].name == latch->label ? 2 : 0;
+            ivs.push_back({ &inst, inst.args[in], inst.args[2 - in], s->step()->value });
+        }
+        return ivs;
+    }
+
+    /**
+     * @brief GEP 中哪一个下标是归纳变量，以及在那一层每个下标值对应的元素类型
+     * 只有一个下标是归纳变量、其余操作数都循环不变时才返回 true
+     */
+    bool match_gep(const IRInstruction &gep, const LoopInfo *loop,
+                   const std::vector<InductionVar> &ivs, size_t &position, const InductionVar *&iv,
+                   IRType *&element) const {
+        if (!is_invariant(gep.args[0], loop)) return false;
+        iv = nullptr;
+        IRType *type = gep.args[0].type->get_pointee_type();
+        for (size_t i = 1; i < gep.args.size(); ++i) {
+            const IROperand &idx = gep.args[i];
+            IRType *indexed = type; // 第 i 个下标每加 1 前进一个 indexed
+            if (i > 1) {
+                if (type->is_struct()) {
+                    if (idx.op_type != IROperandType::IMM) return false;
+                    type = type->get_field_type_by_index(idx.imm_value);
+                    continue;
+                }
+                if (!type->is_array()) return false;
+                indexed = type = type->get_array_element_type();
+            }
+            auto match = std::find_if(ivs.begin(), ivs.end(), [&](const InductionVar &v) {
+                return idx.op_type == IROperandType::REG && v.phi->result->name == idx.name;
+            });
+            if (match != ivs.end()) {
+                if (iv) return false;
+                if (indexed->size() <= 0) return false;
+                iv = &*match;
+                position = i;
+                element = indexed;
+            } else if (!is_invariant(idx, loop)) {
+                return false;
+            }
+        }
+        return iv != nullptr;
+    }
+
+    // 前缀 GEP 把归纳变量换成 value 后的指令
+    static IRInstruction instantiate(const PointerIV &p, const IROperand &value,
+                                     const IROperand &result) {
+        std::vector<IROperand> args = p.prefix;
+        args[p.position] = value;
+        return IRInstruction(IROp::GEP, args, result);
+    }
+
+    PointerIV &get_pointer_iv(IRFunction &F, LoopInfo *loop, std::list<PointerIV> &ptrs,
+                              const IRInstruction &gep, size_t position, const InductionVar *iv,
+                              IRType *element) {
+        std::vector<IROperand> prefix_args(gep.args.begin(), gep.args.begin() + position + 1);
+        for (auto &p : ptrs) {
+            if (p.iv != iv || p.prefix.size() != prefix_args.size()) continue;
+            bool same = std::equal(prefix_args.begin(), prefix_args.end(), p.prefix.begin(),
+                                   [](const IROperand &a, const IROperand &b) {
+                                       return a.op_type == b.op_type && a.name == b.name &&
+                                              a.imm_value == b.imm_value;
+                                   });
+            if (same) return p;
+        }
+
+        IRType *ptr_type = IRType::get_pointer(element);
+        PointerIV &p = ptrs.emplace_back();
+        p.iv = iv;
+        p.prefix = prefix_args;
+        p.position = position;
+        p.phi = F.new_reg(ptr_type);
+        p.next = F.new_reg(ptr_type);
+
+        IRBasicBlock *preheader = loop->preheader;
+        IRBasicBlock *latch = loop->latches.front();
+        IROperand init = F.new_reg(ptr_type);
+        preheader->insts.insert(std::prev(preheader->insts.end()), instantiate(p, iv->start, init));
+        loop->header->insts.insert(std::next(loop->header->insts.begin()),
+                                   IRInstruction(IROp::PHI,
+                                                 { init, IROperand::create_label(preheader->label),
+                                                   p.next, IROperand::create_label(latch->label) },
+                                                 p.phi));
+        IROperand step = IROperand::create_imm(static_cast<int>(iv->step), IRType::get_i32());
+        latch->insts.insert(latch->branch_begin(),
+                            IRInstruction(IROp::GEP, { p.phi, step }, p.next));
+        add_stat("pointer induction variables created");
+        return p;
+    }
+
+    static void replace_uses(IRFunction &F, const std::string &name, const IROperand &value) {
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                for (auto &arg : inst.args) {
+                    if (arg.op_type == IROperandType::REG && arg.name == name) arg = value;
+                }
+            }
+        }
+    }
+
+    static bool used_outside(IRFunction &F, const LoopInfo *loop, const IRInstruction &def) {
+        for (auto &block : F.blocks) {
+            if (loop->contains(block.get())) continue;
+            for (auto &inst : block->insts) {
+                for (auto &arg : inst.args) {
+                    if (arg.op_type == IROperandType::REG && arg.name == def.result->name) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 计数器只剩循环里和不变值的比较在用时，改为比较指针并删掉计数器
+     * 指针 = 基址 + 计数器 × 元素大小，随计数器严格递增（与步长的符号无关），比较结果不变
+     */
+    bool remove_counter(IRFunction &F, LoopInfo *loop, const PointerIV &p) {
+        const InductionVar &iv = *p.iv;
+        const std::string &cur = iv.phi->result->name;
+        if (iv.next.op_type != IROperandType::REG) return false;
+        IRInstruction *inc = def_inst.at(iv.next.name);
+        if (inc->op != IROp::ADD && inc->op != IROp::SUB) return false;
+
+        std::vector<IRInstruction *> tests;
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                if (&inst == iv.phi || &inst == inc) continue;
+                bool uses = std::any_of(inst.args.begin(), inst.args.end(), [&](const auto &a) {
+                    return a.op_type == IROperandType::REG &&
+                           (a.name == cur || a.name == iv.next.name);
+                });
+                if (!uses) continue;
+                if (inst.op != IROp::TEST || !loop->contains(block.get())) return false;
+                // 一边是计数器，另一边循环不变
+                const IROperand &a = inst.args[0], &b = inst.args[1];
+                bool a_iv = a.op_type == IROperandType::REG &&
+                            (a.name == cur || a.name == iv.next.name);
+                bool b_iv = b.op_type == IROperandType::REG &&
+                            (b.name == cur || b.name == iv.next.name);
+                if (a_iv == b_iv || !is_invariant(a_iv ? b : a, loop)) return false;
+                tests.push_back(&inst);
+            }
+        }
+
+        IRBasicBlock *preheader = loop->preheader;
+        IRType *ptr_type = p.phi.type;
+        std::map<std::string, IROperand> bounds; // 边界值 -> 边界指针
+        for (IRInstruction *test : tests) {
+            for (auto &arg : test->args) {
+                if (arg.op_type == IROperandType::REG && arg.name == cur) {
+                    arg = p.phi;
+                } else if (arg.op_type == IROperandType::REG && arg.name == iv.next.name) {
+                    arg = p.next;
+                } else {
+                    std::string key = arg.to_string();
+                    auto it = bounds.find(key);
+                    if (it == bounds.end()) {
+                        IROperand bound = F.new_reg(ptr_type);
+                        preheader->insts.insert(std::prev(preheader->insts.end()),
+                                                instantiate(p, arg, bound));
+                        it = bounds.emplace(key, bound).first;
+                    }
+                    arg = it->second;
+                }
+            }
+            add_stat("exit tests rewritten");
+        }
+
+        for (auto &block : F.blocks) {
+            block->insts.remove_if(
+                [&](const IRInstruction &inst) { return &inst == iv.phi || &inst == inc; });
+        }
+        add_stat("induction variables removed");
+        return true;
+    }
+
+    bool reduce_loop(IRFunction &F, LoopInfo *loop) {
+        if (loop->latches.size() != 1) return false;
+        ScalarEvolution se(F);
+        std::vector<InductionVar> ivs = find_induction_vars(se, loop);
+        if (ivs.empty()) return false;
+
+        struct Use {
+            IRInstruction *gep;
+            size_t position;
+            const InductionVar *iv;
+            IRType *element;
+        };
+        std::vector<Use> uses;
+        for (auto &block : F.blocks) {
+            if (!loop->contains(block.get())) continue;
+            for (auto &inst : block->insts) {
+                Use use{ &inst, 0, nullptr, nullptr };
+                if (inst.op != IROp::GEP) continue;
+                if (match_gep(inst, loop, ivs, use.position, use.iv, use.element)) {
+                    uses.push_back(use);
+                }
+            }
+        }
+        if (uses.empty()) return false;
+        if (!loop->preheader) {
+            create_preheader(F, loop);
+            add_stat("preheaders created");
+            // 预头块改变了循环头 PHI 的入边标签
+            for (auto &iv : ivs) {
+                size_t in = iv.phi->args[1].name == loop->latches.front()->label ? 2 : 0;
+                iv.start = iv.phi->args[in];
+            }
+        }
+
+        std::list<PointerIV> ptrs;
+        std::unordered_set<std::string> dead;
+        for (const Use &use : uses) {
+            PointerIV &p = get_pointer_iv(F, loop, ptrs, *use.gep, use.position, use.iv,
+                                          use.element);
+            if (use.position + 1 == use.gep->args.size() && !used_outside(F, loop, *use.gep)) {
+                // 没有剩下的下标：GEP 就是指针本身。循环外看到的是最后一次执行时的值，
+                // 从循环头退出时指针已经多前进了一步，所以那种情况保留一条 GEP
+                replace_uses(F, use.gep->result->name, p.phi);
+                dead.insert(use.gep->result->name);
+            } else {
+                std::vector<IROperand> args{ p.phi, IROperand::create_imm(0, IRType::get_i32()) };
+                args.insert(args.end(), use.gep->args.begin() + use.position + 1,
+                            use.gep->args.end());
+                use.gep->args = args;
+            }
+            add_stat("addresses strength-reduced");
+        }
+        for (auto &block : F.blocks) {
+            block->insts.remove_if([&](const IRInstruction &inst) {
+                return inst.result && dead.contains(inst.result->name);
+            });
+        }
+
+        // 每个归纳变量用它的第一个指针归纳变量替换比较
+        std::unordered_set<const InductionVar *> done;
+        for (const auto &p : ptrs) {
+            if (!done.insert(p.iv).second) continue;
+            remove_counter(F, loop, p);
+        }
+        return true;
+    }
+
+  public:
+    const char *name() const override {
+        return "lsr";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.loops.empty()) return false;
+        index_defs(F);
+        bool changed = false;
+        // 内层循环先处理；改写只发生在循环内部和它的预头块里
+        for (auto it = F.loops.rbegin(); it != F.loops.rend(); ++it) {
+            if (!reduce_loop(F, it->get())) continue;
+            index_defs(F);
+            changed = true;
+        }
+        return changed;
+    }
+};
@@ -2,6 +2,7 @@
 
 #include "ir.hpp"
 #include "pass.hpp"
+#include "pass/dataflow_analyses.hpp"
 #include "type.hpp"
 #include <iostream>
 #include <stdexcept>
@@ -83,33 +84,73 @@ class Mem2RegPhiInsertionPass : public FunctionPass {
         }
     }
 
+    /**
+     * 求每个可提升 alloca 在哪些块入口活跃（后向、并集的 gen/kill 问题）：
+     * 块内先 LOAD 后 STORE 的 alloca 为 gen，块内有 STORE 的为 kill
+     */
+    std::vector<BitVector> compute_live_in(const BlockNumbering &numbering,
+                                           const DenseNameMap &allocas) {
+        GenKillProblem<BitVector> problem;
+        problem.direction = DataflowDirection::Backward;
+        problem.universe = allocas.size();
+        problem.gen.assign(numbering.size(), BitVector(allocas.size()));
+        problem.kill.assign(numbering.size(), BitVector(allocas.size()));
+        for (size_t b = 0; b < numbering.size(); ++b) {
+            for (auto &inst : numbering.block(b)->insts) {
+                if (inst.op == IROp::LOAD) {
+                    int a = allocas.find(inst.args[0].name);
+                    if (a >= 0 && !problem.kill[b].test(a)) problem.gen[b].set(a);
+                } else if (inst.op == IROp::STORE) {
+                    int a = allocas.find(inst.args[1].name);
+                    if (a >= 0) problem.kill[b].set(a);
+                }
+            }
+        }
+        return solve_dataflow(numbering, problem).in;
+    }
+
+    // 在迭代支配边界上插入 PHI，只保留变量在块入口活跃的位置（pruned SSA）
     void insert_phiNodes(IRFunction &F) {
+        BlockNumbering numbering(F);
+        DenseNameMap allocas;
         for (auto const &[alloca_name, var_type] : promotable_allocas) {
-            std::unordered_set<IRBasicBlock *> has_phi_inserted;
-            std::unordered_set<IRBasicBlock *> def_blocks;
-            for (auto &block : F.blocks) {
-                for (auto &inst : block->insts) {
-                    if (inst.op == IROp::STORE) {
-                        if (inst.args[1].op_type == IROperandType::REG &&
-                            inst.args[1].name == alloca_name) {
-                            def_blocks.insert(block.get());
-                        }
-                    }
-                }
+            allocas.get_or_add(alloca_name);
+        }
+
+        // 每个 alloca 的定值块集合，按块编号存成位向量
+        std::vector<BitVector> def_blocks(allocas.size(), BitVector(numbering.size()));
+        for (size_t b = 0; b < numbering.size(); ++b) {
+            for (auto &inst : numbering.block(b)->insts) {
+                if (inst.op != IROp::STORE || inst.args[1].op_type != IROperandType::REG) continue;
+                int a = allocas.find(inst.args[1].name);
+                if (a >= 0) def_blocks[a].set(b);
             }
-            std::vector<IRBasicBlock *> work_list(def_blocks.begin(), def_blocks.end());
+        }
+        std::vector<BitVector> live_in = compute_live_in(numbering, allocas);
+
+        for (size_t a = 0; a < allocas.size(); ++a) {
+            const std::string &alloca_name = allocas.name(a);
+            IRType *var_type = promotable_allocas.at(alloca_name);
+            BitVector has_phi_inserted(numbering.size());
+            std::vector<IRBasicBlock *> work_list;
+            def_blocks[a].for_each([&](size_t b) { work_list.push_back(numbering.block(b)); });
             while (!work_list.empty()) {
                 IRBasicBlock *d = work_list.back();
                 work_list.pop_back();
                 for (IRBasicBlock *b : d->dom_frontiers) {
-                    if (not has_phi_inserted.contains(b)) {
-                        IROperand res = F.new_reg(var_type); // 定义新SSA变量给phi节点
-                        IRInstruction phi_inst(IROp::PHI, {}, res);
-                        b->insts.insert(++b->insts.begin(), phi_inst);
-                        has_phi_inserted.insert(b);
-                        work_list.push_back(b);
-                        phi_to_alloca_map.insert({ res.name, alloca_name });
+                    int bi = numbering[b];
+                    if (has_phi_inserted.test(bi)) continue;
+                    has_phi_inserted.set(bi);
+                    if (!live_in[bi].test(a)) {
+                        add_stat("dead phis pruned");
+                        continue;
                     }
+                    IROperand res = F.new_reg(var_type); // 定义新SSA变量给phi节点
+                    IRInstruction phi_inst(IROp::PHI, {}, res);
+                    b->insts.insert(++b->insts.begin(), phi_inst);
+                    work_list.push_back(b);
+                    phi_to_alloca_map.insert({ res.name, alloca_name });
+                    add_stat("phis inserted");
                 }
             }
         }
@@ -162,7 +203,10 @@ class Mem2RegPhiInsertionPass : public FunctionPass {
                 continue;
             }
             if (inst.op == IROp::PHI) {
-                std::string alloca_name = phi_to_alloca_map.at(inst.result->name);
+                // 已经是 SSA 的函数（例如 LCM 引入临时变量后再次提升）里原有的 PHI 不归这里管
+                auto phi_alloca = phi_to_alloca_map.find(inst.result->name);
+                if (phi_alloca == phi_to_alloca_map.end()) continue;
+                std::string alloca_name = phi_alloca->second;
                 auto new_def = inst.result.value();
                 def_map_stacks[alloca_name].push_back(new_def);
                 definitions_pushed_count[alloca_name]++;
@@ -202,7 +246,17 @@ class Mem2RegPhiInsertionPass : public FunctionPass {
             for (auto &succ_inst : S->insts) {
                 if (succ_inst.op == IROp::LABEL) continue; // 跳过标签指令
                 if (succ_inst.op != IROp::PHI) break;      // 只处理开头的一系列 PHI 节点
-                std::string alloca_name = phi_to_alloca_map.at(succ_inst.result->name);
+                auto phi_alloca = phi_to_alloca_map.find(succ_inst.result->name);
+                if (phi_alloca == phi_to_alloca_map.end()) {
+                    // 原有 PHI 从本块进来的值可能是被删掉的 LOAD
+                    for (size_t i = 0; i + 1 < succ_inst.args.size(); i += 2) {
+                        auto renamed = rename_map.find(succ_inst.args[i].name);
+                        if (succ_inst.args[i + 1].name != B->label) continue;
+                        if (renamed != rename_map.end()) succ_inst.args[i] = renamed->second;
+                    }
+                    continue;
+                }
+                std::string alloca_name = phi_alloca->second;
                 if ((not def_map_stacks.contains(alloca_name)) or
                     def_map_stacks.at(alloca_name).empty()) {
                     throw std::runtime_error("Def stack is empty when filling PHI nodes");
@@ -243,8 +297,11 @@ class Mem2RegPhiInsertionPass : public FunctionPass {
     }
 
   public:
+    const char *name() const override {
+        return "mem2reg";
+    }
+
     bool run(IRFunction &F) override {
-        std::cout << "Running Mem2RegPhiInsertionPass on function: " << F.name << std::endl;
         if (F.blocks.empty()) return false;
 
         // 找出哪些 alloca 可以提升
@@ -268,6 +325,8 @@ class Mem2RegPhiInsertionPass : public FunctionPass {
         // F.dump(std::cout);
 
         // 清理
+        add_stat("allocas promoted", static_cast<long>(promotable_allocas.size()));
+        add_stat("memory ops removed", static_cast<long>(instructions_to_delete.size()));
         cleanup_instructions(F);
 
         return true;
@@ -0,0 +1,320 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/alias_analysis.hpp"
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ========================================================
+// --- Memory SSA ---
+// 把整个内存看成一个变量，对它做 SSA 构造：写内存的指令（store / call）是 MemoryDef，
+// 读内存的指令（load / output_str / 只读的 call）是 MemoryUse，汇合点是 MemoryPhi。
+// PHI 的位置与 Mem2RegPhiInsertionPass 一样取定值块的迭代支配边界，需要先计算 domfrontier。
+// 每个访问都指向支配它的上一个 MemoryDef / MemoryPhi，沿这条链借助别名分析向上走，
+// 就能找到真正可能改写某个位置的访问（clobber），结果带缓存。
+// ========================================================
+
+enum class MemoryAccessKind { LiveOnEntry, Def, Use, Phi };
+
+struct MemoryAccess {
+    MemoryAccessKind kind;
+    unsigned id;                        // 打印用的编号，LiveOnEntry 为 0
+    IRInstruction *inst = nullptr;      // Def / Use 对应的指令
+    IRBasicBlock *block = nullptr;      // 所在的块（LiveOnEntry 为 nullptr）
+    MemoryAccess *defining = nullptr;   // Def / Use：之前最近的 Def 或 Phi
+    std::vector<MemoryAccess *> users;  // 以本访问为 defining 或 incoming 的访问
+    // Phi：每个前驱块带来的内存状态；函数入口块本身是循环头时，来自函数入口的项前驱为 nullptr
+    std::vector<std::pair<MemoryAccess *, IRBasicBlock *>> incoming;
+
+    std::string to_string() const {
+        return kind == MemoryAccessKind::LiveOnEntry ? "liveOnEntry" : std::to_string(id);
+    }
+};
+
+class MemorySSA {
+  private:
+    // 走查的步数上限：超出后保守地把当前访问当作 clobber，避免在很大的 CFG 上退化
+    static constexpr unsigned MAX_WALK_STEPS = 1000;
+
+    IRFunction &F;
+    AliasAnalysis &AA;
+    std::vector<std::unique_ptr<MemoryAccess>> accesses; // accesses[0] 是 LiveOnEntry
+    std::unordered_map<const IRInstruction *, MemoryAccess *> inst_access;
+    std::unordered_map<const IRBasicBlock *, MemoryAccess *> block_phi;
+    std::unordered_map<const IRBasicBlock *, std::vector<MemoryAccess *>> block_accesses;
+    std::unordered_map<const MemoryAccess *, MemoryAccess *> clobber_cache;
+    unsigned cache_hits = 0;
+
+    // 一次走查的状态：正在求解的 PHI、已求出的 PHI，以及遇到的"回到正在求解的 PHI"的环
+    struct WalkState {
+        std::unordered_set<MemoryAccess *> in_progress;
+        std::unordered_map<MemoryAccess *, MemoryAccess *> done;
+        std::vector<MemoryAccess *> cycle_hits;
+        unsigned steps = 0;
+    };
+
+    MemoryAccess *create(MemoryAccessKind kind, IRInstruction *inst, IRBasicBlock *block) {
+        auto access = std::make_unique<MemoryAccess>();
+        access->kind = kind;
+        access->id = static_cast<unsigned>(accesses.size());
+        access->inst = inst;
+        access->block = block;
+        accesses.push_back(std::move(access));
+        return accesses.back().get();
+    }
+
+    // 按被调函数的摘要区分 call：可能写内存的是 Def，只读的是 Use，都不做的不参与 Memory SSA
+    bool is_def(const IRInstruction &inst) const {
+        if (inst.op == IROp::CALL) {
+            const FunctionSummary *s = F.callee_summary(inst);
+            return !s || s->may_write();
+        }
+        return inst.op == IROp::STORE;
+    }
+
+    bool is_use(const IRInstruction &inst) const {
+        if (inst.op == IROp::CALL) {
+            const FunctionSummary *s = F.callee_summary(inst);
+            return s && !s->may_write() && s->may_read();
+        }
+        return inst.op == IROp::LOAD || inst.op == IROp::OUTPUT_STR;
+    }
+
+    // 在含 MemoryDef 的块的迭代支配边界上放置 MemoryPhi
+    void insert_phis() {
+        std::vector<IRBasicBlock *> work_list;
+        for (auto &block : F.blocks) {
+            if (block->dom_in < 0) continue;
+            for (auto &inst : block->insts) {
+                if (is_def(inst)) {
+                    work_list.push_back(block.get());
+                    break;
+                }
+            }
+        }
+        while (!work_list.empty()) {
+            IRBasicBlock *d = work_list.back();
+            work_list.pop_back();
+            for (IRBasicBlock *b : d->dom_frontiers) {
+                if (block_phi.contains(b)) continue;
+                block_phi[b] = create(MemoryAccessKind::Phi, nullptr, b);
+                work_list.push_back(b);
+            }
+        }
+    }
+
+    // 沿支配树重命名，current 是进入块 B 时的内存状态
+    void rename_recursive(IRBasicBlock *B, MemoryAccess *current) {
+        auto &list = block_accesses[B];
+        if (auto it = block_phi.find(B); it != block_phi.end()) {
+            current = it->second;
+            list.push_back(current);
+        }
+        for (auto &inst : B->insts) {
+            bool def = is_def(inst);
+            if (!def && !is_use(inst)) continue;
+            MemoryAccess *access =
+                create(def ? MemoryAccessKind::Def : MemoryAccessKind::Use, &inst, B);
+            access->defining = current;
+            current->users.push_back(access);
+            inst_access[&inst] = access;
+            list.push_back(access);
+            if (def) current = access;
+        }
+
+        for (IRBasicBlock *S : B->successors) {
+            auto it = block_phi.find(S);
+            if (it == block_phi.end()) continue;
+            it->second->incoming.push_back({ current, B });
+            current->users.push_back(it->second);
+        }
+
+        for (IRBasicBlock *C : B->dom_child) {
+            rename_recursive(C, current);
+        }
+    }
+
+    static bool may_mod(ModRefInfo mr) {
+        return static_cast<int>(mr) & static_cast<int>(ModRefInfo::Mod);
+    }
+
+    // 从 a 开始向上找第一个可能改写 loc 的访问；返回 nullptr 表示只绕回了正在求解的 PHI
+    MemoryAccess *walk(MemoryAccess *a, const MemoryLocation &loc, WalkState &state) {
+        while (true) {
+            if (++state.steps > MAX_WALK_STEPS) return a;
+            switch (a->kind) {
+                case MemoryAccessKind::LiveOnEntry: return a;
+                case MemoryAccessKind::Phi: return walk_phi(a, loc, state);
+                case MemoryAccessKind::Def:
+                    if (may_mod(AA.get_mod_ref(*a->inst, loc))) return a;
+                    a = a->defining;
+                    break;
+                case MemoryAccessKind::Use: a = a->defining; break;
+            }
+        }
+    }
+
+    // 所有入边给出同一个 clobber 时越过 PHI，否则 PHI 本身就是 clobber。
+    // 绕回正在求解的 PHI 的路径上没有新的写，不影响结果（乐观假设，求解完该 PHI 后成立）
+    MemoryAccess *walk_phi(MemoryAccess *phi, const MemoryLocation &loc, WalkState &state) {
+        if (auto it = state.done.find(phi); it != state.done.end()) return it->second;
+        if (state.in_progress.contains(phi)) {
+            state.cycle_hits.push_back(phi);
+            return nullptr;
+        }
+
+        state.in_progress.insert(phi);
+        size_t hits_before = state.cycle_hits.size();
+        MemoryAccess *result = nullptr;
+        for (auto &[value, pred] : phi->incoming) {
+            MemoryAccess *r = walk(value, loc, state);
+            if (!r) continue;
+            if (!result) {
+                result = r;
+            } else if (result != r) {
+                result = phi;
+                break;
+            }
+        }
+        state.in_progress.erase(phi);
+
+        // 只依赖本 PHI 自身的环在这里已经闭合；还依赖外层 PHI 的结果不能记住
+        std::erase(state.cycle_hits, phi);
+        bool optimistic = state.cycle_hits.size() > hits_before;
+        if (!optimistic) state.done[phi] = result;
+        return result;
+    }
+
+  public:
+    MemorySSA(IRFunction &F, AliasAnalysis &AA) : F(F), AA(AA) {
+        create(MemoryAccessKind::LiveOnEntry, nullptr, nullptr);
+        if (F.blocks.empty()) return;
+        insert_phis();
+
+        IRBasicBlock *entry = F.blocks.front().get();
+        if (auto it = block_phi.find(entry); it != block_phi.end()) {
+            it->second->incoming.push_back({ live_on_entry(), nullptr });
+            live_on_entry()->users.push_back(it->second);
+        }
+        rename_recursive(entry, live_on_entry());
+    }
+
+    MemoryAccess *live_on_entry() const {
+        return accesses.front().get();
+    }
+
+    // 指令对应的 MemoryDef / MemoryUse，不访问内存的指令返回 nullptr
+    MemoryAccess *get_memory_access(const IRInstruction *inst) const {
+        auto it = inst_access.find(inst);
+        return it == inst_access.end() ? nullptr : it->second;
+    }
+
+    MemoryAccess *get_memory_phi(const IRBasicBlock *block) const {
+        auto it = block_phi.find(block);
+        return it == block_phi.end() ? nullptr : it->second;
+    }
+
+    // 块内的访问，按出现顺序（MemoryPhi 在最前）
+    const std::vector<MemoryAccess *> &get_block_accesses(const IRBasicBlock *block) {
+        return block_accesses[block];
+    }
+
+    // 从 start 开始（包含 start）向上找可能改写 loc 的访问
+    MemoryAccess *get_clobbering_access(MemoryAccess *start, const MemoryLocation &loc) {
+        WalkState state;
+        MemoryAccess *r = walk(start, loc, state);
+        return r ? r : start;
+    }
+
+    // MemoryUse 读到的值由哪个访问写入；MemoryDef 覆盖的位置之前由哪个访问写入
+    // （call 没有单一的位置，直接返回它的 defining）
+    MemoryAccess *get_clobbering_access(MemoryAccess *access) {
+        if (access->kind == MemoryAccessKind::Phi ||
+            access->kind == MemoryAccessKind::LiveOnEntry) {
+            return access;
+        }
+        if (access->inst->op == IROp::CALL) return access->defining;
+        if (auto it = clobber_cache.find(access); it != clobber_cache.end()) {
+            cache_hits++;
+            return it->second;
+        }
+        MemoryAccess *r = get_clobbering_access(access->defining, AA.location(*access->inst));
+        clobber_cache[access] = r;
+        return r;
+    }
+
+    unsigned get_cache_hits() const {
+        return cache_hits;
+    }
+
+    size_t num_accesses() const {
+        return accesses.size() - 1;
+    }
+
+    // 在 IR 中间穿插 MemorySSA 注释打印出来，MemoryUse 同时给出走查得到的 clobber
+    void print(std::ostream &os) {
+        os << "MemorySSA for " << F.name << ":\n";
+        for (auto &block : F.blocks) {
+            os << block->label << ":\n";
+            if (MemoryAccess *phi = get_memory_phi(block.get())) {
+                os << "  ; " << phi->id << " = MemoryPhi(";
+                for (size_t i = 0; i < phi->incoming.size(); ++i) {
+                    auto [value, pred] = phi->incoming[i];
+                    os << (i ? ", " : "") << "{" << (pred ? pred->label : "<entry>") << ","
+                       << value->to_string() << "}";
+                }
+                os << ")\n";
+            }
+            for (auto &inst : block->insts) {
+                if (inst.op == IROp::LABEL) continue;
+                if (MemoryAccess *access = get_memory_access(&inst)) {
+                    if (access->kind == MemoryAccessKind::Def) {
+                        os << "  ; " << access->id << " = MemoryDef("
+                           << access->defining->to_string() << ")\n";
+                    } else {
+                        os << "  ; MemoryUse(" << access->defining->to_string()
+                           << ")  clobber: " << get_clobbering_access(access)->to_string()
+                           << "\n";
+                    }
+                }
+                inst.dump(os);
+                os << "\n";
+            }
+        }
+    }
+};
+
+// 打印函数的 MemorySSA（到标准错误），不修改 IR
+class PrintMemorySSAPass : public FunctionPass {
+  public:
+    const char *name() const override {
+        return "print-memoryssa";
+    }
+
+    bool run(IRFunction &F) override {
+        AliasAnalysis aa(F);
+        MemorySSA mssa(F, aa);
+        std::ostringstream os;
+        mssa.print(os);
+        trace_out() << os.str();
+
+        add_stat("memory accesses", static_cast<long>(mssa.num_accesses()));
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                MemoryAccess *access = mssa.get_memory_access(&inst);
+                if (!access || access->kind != MemoryAccessKind::Use) continue;
+                if (mssa.get_clobbering_access(access) != access->defining) {
+                    add_stat("uses optimized past their defining access");
+                }
+            }
+        }
+        return false;
+    }
+};
@@ -0,0 +1,603 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/loop_analysis.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ========================================================
+// --- 标量演化（SCEV）---
+// 把 SSA 寄存器表示成常量、未知值、加法、乘法以及加法递推 {start,+,step}<loop> 的表达式，
+// 并从循环的退出条件求出符号化的回边执行次数。
+// 需要 mem2reg 之后的 SSA 形式和 LoopAnalysisPass 的结果；假定归纳变量不会溢出回绕。
+// ========================================================
+
+enum class SCEVKind { Constant, Unknown, Add, Mul, AddRec, SMax, Div, CouldNotCompute };
+
+// SCEV 节点由 ScalarEvolution 统一创建并去重，同一表达式只有一个节点，可以直接比较指针
+struct SCEV {
+    SCEVKind kind;
+    int64_t value = 0;              // Constant
+    std::string name;               // Unknown：寄存器 / 全局变量名
+    std::vector<const SCEV *> ops;  // 操作数；AddRec 为 {start, step}，Div 为 {lhs, rhs}
+    const LoopInfo *loop = nullptr; // AddRec 所属的循环
+    std::string key;                // 规范化的文本形式，也用于去重
+
+    bool is_constant() const {
+        return kind == SCEVKind::Constant;
+    }
+    bool is_zero() const {
+        return kind == SCEVKind::Constant && value == 0;
+    }
+    bool is_add_rec() const {
+        return kind == SCEVKind::AddRec;
+    }
+    bool could_not_compute() const {
+        return kind == SCEVKind::CouldNotCompute;
+    }
+    const SCEV *start() const {
+        return ops[0];
+    }
+    const SCEV *step() const {
+        return ops[1];
+    }
+    // 步长为常量的加法递推
+    bool is_affine() const {
+        return kind == SCEVKind::AddRec && ops[1]->is_constant();
+    }
+    const std::string &to_string() const {
+        return key;
+    }
+};
+
+class ScalarEvolution {
+  private:
+    IRFunction &F;
+    std::unordered_map<std::string, std::unique_ptr<SCEV>> uniq;
+    std::unordered_map<std::string, const SCEV *> cache; // 寄存器 -> SCEV
+    std::unordered_map<std::string, std::pair<const IRInstruction *, IRBasicBlock *>> defs;
+    std::unordered_map<std::string, IRBasicBlock *> label_map;
+    std::unordered_map<const LoopInfo *, const SCEV *> btc_cache;
+
+    const SCEV *make(SCEVKind kind, std::string key, int64_t value = 0, std::string name = "",
+                     std::vector<const SCEV *> ops = {}, const LoopInfo *loop = nullptr) {
+        auto &slot = uniq[key];
+        if (!slot) {
+            slot = std::make_unique<SCEV>(
+                SCEV{ kind, value, std::move(name), std::move(ops), loop, key });
+        }
+        return slot.get();
+    }
+
+    static bool by_key(const SCEV *a, const SCEV *b) {
+        // 常量排在最前面，其余按文本排序
+        if (a->is_constant() != b->is_constant()) return a->is_constant();
+        return a->key < b->key;
+    }
+
+    static std::string join(const std::vector<const SCEV *> &ops, const char *sep) {
+        std::string s = "(";
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (i) s += sep;
+            s += ops[i]->key;
+        }
+        return s + ")";
+    }
+
+    // 拆成 系数 * 其余部分
+    std::pair<int64_t, const SCEV *> split_coefficient(const SCEV *s) {
+        if (s->kind == SCEVKind::Mul && s->ops[0]->is_constant()) {
+            std::vector<const SCEV *> rest(s->ops.begin() + 1, s->ops.end());
+            return { s->ops[0]->value, rest.size() == 1 ? rest[0] : make_mul(rest) };
+        }
+        return { 1, s };
+    }
+
+    const SCEV *make_add(std::vector<const SCEV *> ops) {
+        std::sort(ops.begin(), ops.end(), by_key);
+        std::string key = join(ops, " + ");
+        return make(SCEVKind::Add, std::move(key), 0, "", std::move(ops));
+    }
+    const SCEV *make_mul(std::vector<const SCEV *> ops) {
+        std::sort(ops.begin(), ops.end(), by_key);
+        std::string key = join(ops, " * ");
+        return make(SCEVKind::Mul, std::move(key), 0, "", std::move(ops));
+    }
+
+    // ---- IR -> SCEV ----
+
+    const SCEV *operand_scev(const IROperand &op) {
+        switch (op.op_type) {
+            case IROperandType::IMM: return get_constant(op.imm_value);
+            case IROperandType::REG: return get(op.name);
+            default: return get_unknown(op.name);
+        }
+    }
+
+    // 块 use 中看到的值：其中不包含 use 的循环的递推已经结束，换成它们的终值
+    const SCEV *at_scope(const SCEV *s, const IRBasicBlock *use) {
+        switch (s->kind) {
+            case SCEVKind::AddRec:
+                if (s->loop->contains(use)) return s;
+                return at_scope(exit_value(s, s->loop), use);
+            case SCEVKind::Add: {
+                std::vector<const SCEV *> ops;
+                for (const SCEV *op : s->ops) ops.push_back(at_scope(op, use));
+                return get_add(ops);
+            }
+            case SCEVKind::Mul: {
+                const SCEV *result = get_constant(1);
+                for (const SCEV *op : s->ops) result = get_mul(result, at_scope(op, use));
+                return result;
+            }
+            case SCEVKind::SMax:
+                return get_smax(at_scope(s->ops[0], use), at_scope(s->ops[1], use));
+            case SCEVKind::Div: return get_div(at_scope(s->ops[0], use), at_scope(s->ops[1], use));
+            default: return s;
+        }
+    }
+
+    const SCEV *compute(const std::string &reg) {
+        auto it = defs.find(reg);
+        if (it == defs.end()) return get_unknown(reg); // 参数，或被多次定义（dessa 之后）
+        const IRInstruction &inst = *it->second.first;
+        IRBasicBlock *block = it->second.second;
+        auto arg = [&](size_t i) { return at_scope(operand_scev(inst.args[i]), block); };
+        const SCEV *s = nullptr;
+        switch (inst.op) {
+            case IROp::ADD: s = get_add(arg(0), arg(1)); break;
+            case IROp::SUB: s = get_minus(arg(0), arg(1)); break;
+            case IROp::MUL: s = get_mul(arg(0), arg(1)); break;
+            case IROp::MOVE: s = arg(0); break;
+            case IROp::PHI: s = compute_phi(inst, block); break;
+            default: break;
+        }
+        return s && !s->could_not_compute() ? s : get_unknown(reg);
+    }
+
+    // 循环头的 PHI [start, 循环外], [next, 回边块]：若 next = phi + step 且 step 在循环内不变，
+    // 则 phi = {start,+,step}<loop>
+    const SCEV *compute_phi(const IRInstruction &phi, IRBasicBlock *block) {
+        const std::string &reg = phi.result->name;
+        const LoopInfo *loop = block->loop;
+        if (!loop || loop->header != block || phi.args.size() != 4) return get_unknown(reg);
+        size_t in = loop->contains(block_of(phi.args[1].name)) ? 2 : 0;
+        if (!loop->contains(block_of(phi.args[3 - in].name))) return get_unknown(reg);
+
+        // 先把 PHI 当作未知值，分析回边上的值；期间算出的依赖它的结果事后作废
+        const SCEV *self = get_unknown(reg);
+        cache[reg] = self;
+        std::vector<std::string> before;
+        before.reserve(cache.size());
+        for (auto &[name, s] : cache) before.push_back(name);
+        const SCEV *next = operand_scev(phi.args[2 - in]);
+        std::unordered_set<std::string> keep(before.begin(), before.end());
+        std::erase_if(cache, [&](const auto &entry) { return !keep.contains(entry.first); });
+        cache.erase(reg);
+
+        // next = self + step
+        if (next->kind != SCEVKind::Add) return get_unknown(reg);
+        auto self_it = std::find(next->ops.begin(), next->ops.end(), self);
+        if (self_it == next->ops.end()) return get_unknown(reg);
+        std::vector<const SCEV *> rest(next->ops.begin(), next->ops.end());
+        rest.erase(rest.begin() + (self_it - next->ops.begin()));
+        const SCEV *step = rest.size() == 1 ? rest[0] : get_add(rest);
+        if (!is_loop_invariant(step, loop) || contains_unknown(step, reg)) return get_unknown(reg);
+        return get_add_rec(at_scope(operand_scev(phi.args[in]), block), step, loop);
+    }
+
+    static bool contains_unknown(const SCEV *s, const std::string &name) {
+        if (s->kind == SCEVKind::Unknown) return s->name == name;
+        return std::any_of(s->ops.begin(), s->ops.end(),
+                           [&](const SCEV *op) { return contains_unknown(op, name); });
+    }
+
+    IRBasicBlock *block_of(const std::string &label) const {
+        auto it = label_map.find(label);
+        return it == label_map.end() ? nullptr : it->second;
+    }
+
+    // ---- 回边执行次数 ----
+
+    // 第 k 次检查时 iv = {s,+,c}，求 "iv rel bound" 第一次不成立的 k
+    const SCEV *count_until_failure(const SCEV *iv, Rel rel, const SCEV *bound) {
+        const SCEV *s = iv->start();
+        int64_t c = iv->step()->value;
+        switch (rel) {
+            case Rel::LE: return count_until_failure(iv, Rel::LT, get_add(bound, get_constant(1)));
+            case Rel::GE: return count_until_failure(iv, Rel::GT, get_add(bound, get_constant(-1)));
+            case Rel::LT:
+                // smax(ceil((bound - s) / c), 0)
+                if (c <= 0) break;
+                return get_smax(
+                    get_div(get_add(get_minus(bound, s), get_constant(c - 1)), get_constant(c)),
+                    get_constant(0));
+            case Rel::GT:
+                if (c >= 0) break;
+                return get_smax(
+                    get_div(get_add(get_minus(s, bound), get_constant(-c - 1)), get_constant(-c)),
+                    get_constant(0));
+            case Rel::NE:
+                // 步长为 ±1 时必然恰好到达边界（假定循环会终止）
+                if (c == 1) return get_minus(bound, s);
+                if (c == -1) return get_minus(s, bound);
+                break;
+            case Rel::EQ: break;
+        }
+        return could_not_compute();
+    }
+
+    const SCEV *compute_backedge_taken_count(const LoopInfo *loop) {
+        IRBasicBlock *latch = loop->single_latch();
+        if (!latch || loop->exiting_blocks.size() != 1) return could_not_compute();
+        IRBasicBlock *exiting = loop->exiting_blocks.front();
+        if (exiting != loop->header && exiting != latch) return could_not_compute();
+
+        // 退出块末尾：test a b; brX L1; br L2
+        auto &insts = exiting->insts;
+        if (insts.size() < 4) return could_not_compute();
+        auto it = std::prev(insts.end());
+        const IRInstruction &br = *it--;
+        const IRInstruction &cond_br = *it--;
+        const IRInstruction &test = *it;
+        if (br.op != IROp::BR || test.op != IROp::TEST ||
+            (cond_br.op != IROp::BRLT && cond_br.op != IROp::BRGT && cond_br.op != IROp::BRZ)) {
+            return could_not_compute();
+        }
+        bool taken_in = loop->contains(block_of(cond_br.args[0].name));
+        bool fall_in = loop->contains(block_of(br.args[0].name));
+        if (taken_in == fall_in) return could_not_compute();
+
+        Rel rel = cond_br.op == IROp::BRLT ? Rel::LT : cond_br.op == IROp::BRGT ? Rel::GT : Rel::EQ;
+        const SCEV *lhs = operand_scev(test.args[0]);
+        const SCEV *rhs = operand_scev(test.args[1]);
+        if (!(lhs->is_affine() && lhs->loop == loop)) {
+            std::swap(lhs, rhs);
+            rel = swap_rel(rel);
+        }
+        if (!(lhs->is_affine() && lhs->loop == loop) || !is_loop_invariant(rhs, loop)) {
+            return could_not_compute();
+        }
+        if (!taken_in) rel = negate_rel(rel);
+        return count_until_failure(lhs, rel, rhs);
+    }
+
+  public:
+    /**
+     * @brief 为函数 F 建立 SCEV 分析（按需计算、带缓存）
+     * 调用前需要已经运行 LoopAnalysisPass；IR 改变后应重新创建
+     */
+    explicit ScalarEvolution(IRFunction &func) : F(func) {
+        std::unordered_map<std::string, int> def_count;
+        for (auto &block : F.blocks) {
+            label_map[block->label] = block.get();
+            for (auto &inst : block->insts) {
+                if (!inst.result) continue;
+                defs[inst.result->name] = { &inst, block.get() };
+                def_count[inst.result->name]++;
+            }
+        }
+        std::erase_if(defs, [&](const auto &entry) { return def_count[entry.first] > 1; });
+    }
+
+    // ---- 表达式构造（带化简）----
+
+    const SCEV *get_constant(int64_t v) {
+        return make(SCEVKind::Constant, std::to_string(v), v);
+    }
+    const SCEV *get_unknown(const std::string &name) {
+        return make(SCEVKind::Unknown, name, 0, name);
+    }
+    const SCEV *could_not_compute() {
+        return make(SCEVKind::CouldNotCompute, "***COULDNOTCOMPUTE***");
+    }
+
+    const SCEV *get_add(const SCEV *a, const SCEV *b) {
+        return get_add(std::vector{ a, b });
+    }
+
+    const SCEV *get_add(const std::vector<const SCEV *> &input) {
+        // 展开嵌套加法
+        std::vector<const SCEV *> ops;
+        std::vector<const SCEV *> work(input.rbegin(), input.rend());
+        while (!work.empty()) {
+            const SCEV *s = work.back();
+            work.pop_back();
+            if (s->could_not_compute()) return s;
+            if (s->kind == SCEVKind::Add) {
+                work.insert(work.end(), s->ops.rbegin(), s->ops.rend());
+            } else {
+                ops.push_back(s);
+            }
+        }
+
+        // 同一循环的加法递推逐项相加
+        std::vector<const SCEV *> recs, others;
+        for (const SCEV *s : ops) (s->is_add_rec() ? recs : others).push_back(s);
+        for (size_t i = 0; i < recs.size(); ++i) {
+            for (size_t j = i + 1; j < recs.size();) {
+                if (recs[j]->loop != recs[i]->loop) {
+                    j++;
+                    continue;
+                }
+                recs[i] = get_add_rec(get_add(recs[i]->start(), recs[j]->start()),
+                                      get_add(recs[i]->step(), recs[j]->step()), recs[i]->loop);
+                recs.erase(recs.begin() + j);
+            }
+        }
+        // 步长相消时合并结果不再是递推（{0,+,1} + {-3,+,-1} = -3），把它放回普通项重新化简
+        if (std::any_of(recs.begin(), recs.end(), [](const SCEV *s) { return !s->is_add_rec(); })) {
+            others.insert(others.end(), recs.begin(), recs.end());
+            return get_add(others);
+        }
+        // 在最内层递推所属循环中不变的项并入它的初值
+        if (!recs.empty()) {
+            auto inner = std::max_element(recs.begin(), recs.end(), [](auto *x, auto *y) {
+                return x->loop->depth < y->loop->depth;
+            });
+            const SCEV *rec = *inner;
+            std::vector<const SCEV *> invariant{ rec->start() }, rest;
+            for (const SCEV *s : others) {
+                (is_loop_invariant(s, rec->loop) ? invariant : rest).push_back(s);
+            }
+            for (const SCEV *s : recs) {
+                if (s == rec) continue;
+                (is_loop_invariant(s, rec->loop) ? invariant : rest).push_back(s);
+            }
+            if (invariant.size() > 1) {
+                rest.push_back(get_add_rec(get_add(invariant), rec->step(), rec->loop));
+                return get_add(rest);
+            }
+        }
+        ops = std::move(others);
+        ops.insert(ops.end(), recs.begin(), recs.end());
+
+        // 合并常量与同类项
+        int64_t constant = 0;
+        std::vector<std::pair<const SCEV *, int64_t>> terms;
+        for (const SCEV *s : ops) {
+            if (s->is_constant()) {
+                constant += s->value;
+                continue;
+            }
+            auto [coef, base] = split_coefficient(s);
+            auto it = std::find_if(terms.begin(), terms.end(),
+                                   [base](const auto &t) { return t.first == base; });
+            if (it == terms.end()) {
+                terms.push_back({ base, coef });
+            } else {
+                it->second += coef;
+            }
+        }
+        std::vector<const SCEV *> result;
+        if (constant != 0) result.push_back(get_constant(constant));
+        for (auto [base, coef] : terms) {
+            if (coef != 0) result.push_back(get_mul(get_constant(coef), base));
+        }
+        if (result.empty()) return get_constant(0);
+        if (result.size() == 1) return result[0];
+        return make_add(std::move(result));
+    }
+
+    const SCEV *get_mul(const SCEV *a, const SCEV *b) {
+        std::vector<const SCEV *> ops;
+        for (const SCEV *s : { a, b }) {
+            if (s->could_not_compute()) return s;
+            if (s->kind == SCEVKind::Mul) {
+                ops.insert(ops.end(), s->ops.begin(), s->ops.end());
+            } else {
+                ops.push_back(s);
+            }
+        }
+        int64_t constant = 1;
+        std::vector<const SCEV *> rest;
+        for (const SCEV *s : ops) {
+            if (s->is_constant()) {
+                constant *= s->value;
+            } else {
+                rest.push_back(s);
+            }
+        }
+        if (constant == 0 || rest.empty()) return get_constant(constant);
+
+        // 常量乘以加法 / 加法递推时分配进去
+        if (rest.size() == 1) {
+            const SCEV *s = rest[0];
+            if (constant == 1) return s;
+            if (s->kind == SCEVKind::Add) {
+                std::vector<const SCEV *> terms;
+                for (const SCEV *t : s->ops) terms.push_back(get_mul(get_constant(constant), t));
+                return get_add(terms);
+            }
+            if (s->is_add_rec()) {
+                return get_add_rec(get_mul(get_constant(constant), s->start()),
+                                   get_mul(get_constant(constant), s->step()), s->loop);
+            }
+        }
+        // 加法递推乘以循环不变量仍是加法递推
+        if (rest.size() == 2) {
+            for (int i = 0; i < 2; ++i) {
+                const SCEV *rec = rest[i], *other = rest[1 - i];
+                if (rec->is_add_rec() && is_loop_invariant(other, rec->loop)) {
+                    const SCEV *factor = get_mul(get_constant(constant), other);
+                    return get_add_rec(get_mul(factor, rec->start()), get_mul(factor, rec->step()),
+                                       rec->loop);
+                }
+            }
+        }
+        if (constant != 1) rest.insert(rest.begin(), get_constant(constant));
+        return make_mul(std::move(rest));
+    }
+
+    const SCEV *get_minus(const SCEV *a, const SCEV *b) {
+        return get_add(a, get_mul(get_constant(-1), b));
+    }
+
+    const SCEV *get_add_rec(const SCEV *start, const SCEV *step, const LoopInfo *loop) {
+        if (start->could_not_compute()) return start;
+        if (step->could_not_compute()) return step;
+        if (step->is_zero()) return start;
+        return make(SCEVKind::AddRec,
+                    "{" + start->key + ",+," + step->key + "}<" + loop->header->label + ">", 0, "",
+                    { start, step }, loop);
+    }
+
+    const SCEV *get_smax(const SCEV *a, const SCEV *b) {
+        if (a->could_not_compute()) return a;
+        if (b->could_not_compute()) return b;
+        if (a->is_constant() && b->is_constant()) return get_constant(std::max(a->value, b->value));
+        if (a == b) return a;
+        std::vector<const SCEV *> ops{ a, b };
+        std::sort(ops.begin(), ops.end(), by_key);
+        std::string key = "smax" + join(ops, ", ");
+        return make(SCEVKind::SMax, std::move(key), 0, "", std::move(ops));
+    }
+
+    // 有符号除法（向零取整），只用于除以正常量
+    const SCEV *get_div(const SCEV *a, const SCEV *b) {
+        if (a->could_not_compute()) return a;
+        if (b->could_not_compute()) return b;
+        if (b->is_constant() && b->value == 1) return a;
+        if (a->is_constant() && b->is_constant() && b->value != 0) {
+            return get_constant(a->value / b->value);
+        }
+        return make(SCEVKind::Div, "(" + a->key + " /s " + b->key + ")", 0, "", { a, b });
+    }
+
+    // ---- 查询 ----
+
+    // 寄存器的 SCEV
+    const SCEV *get(const std::string &reg) {
+        if (auto it = cache.find(reg); it != cache.end()) return it->second;
+        const SCEV *s = compute(reg);
+        cache[reg] = s;
+        return s;
+    }
+
+    const SCEV *get(const IROperand &op) {
+        return operand_scev(op);
+    }
+
+    // S 在循环 loop 的每次迭代中是否取同一个值
+    bool is_loop_invariant(const SCEV *s, const LoopInfo *loop) {
+        switch (s->kind) {
+            case SCEVKind::Constant: return true;
+            case SCEVKind::CouldNotCompute: return false;
+            case SCEVKind::Unknown: {
+                // 参数、全局变量和定义在循环外的寄存器
+                auto it = defs.find(s->name);
+                return it == defs.end() || !loop->contains(it->second.second);
+            }
+            case SCEVKind::AddRec:
+                // 只有不嵌套在 loop 内（含 loop 本身）的递推才不随 loop 变化
+                if (loop->contains(s->loop->header)) return false;
+                [[fallthrough]];
+            default:
+                return std::all_of(s->ops.begin(), s->ops.end(),
+                                   [&](const SCEV *op) { return is_loop_invariant(op, loop); });
+        }
+    }
+
+    // 第 k 次迭代时加法递推的值：start + step * k（只支持仿射递推）
+    const SCEV *evaluate_at_iteration(const SCEV *rec, const SCEV *k) {
+        if (!rec->is_add_rec() || rec->step()->is_add_rec()) return could_not_compute();
+        return get_add(rec->start(), get_mul(rec->step(), k));
+    }
+
+    /**
+     * @brief 回边被执行的次数（符号表达式），无法确定时为 CouldNotCompute
+     * 只分析唯一退出块是循环头或唯一回边块、退出条件为归纳变量与循环不变量比较的循环
+     */
+    const SCEV *backedge_taken_count(const LoopInfo *loop) {
+        auto [it, inserted] = btc_cache.try_emplace(loop, nullptr);
+        if (inserted) it->second = compute_backedge_taken_count(loop);
+        return it->second;
+    }
+
+    // 循环体执行的次数（与 LoopInfo::trip_count 含义相同）
+    const SCEV *trip_count(const LoopInfo *loop) {
+        const SCEV *btc = backedge_taken_count(loop);
+        if (btc->could_not_compute()) return btc;
+        bool exits_at_latch = loop->exiting_blocks.front() == loop->single_latch();
+        return exits_at_latch ? get_add(btc, get_constant(1)) : btc;
+    }
+
+    /**
+     * @brief 值 S 在离开循环 loop 之后的值（用于终值替换）
+     * 只对定义所在块支配退出块的值有意义（SSA 中循环外只能直接使用这些值）
+     */
+    const SCEV *exit_value(const SCEV *s, const LoopInfo *loop) {
+        if (is_loop_invariant(s, loop)) return s;
+        switch (s->kind) {
+            case SCEVKind::AddRec: {
+                if (s->loop != loop) return could_not_compute();
+                const SCEV *btc = backedge_taken_count(loop);
+                if (btc->could_not_compute()) return btc;
+                return evaluate_at_iteration(s, btc);
+            }
+            case SCEVKind::Add: {
+                std::vector<const SCEV *> ops;
+                for (const SCEV *op : s->ops) ops.push_back(exit_value(op, loop));
+                return get_add(ops);
+            }
+            case SCEVKind::Mul: {
+                const SCEV *result = get_constant(1);
+                for (const SCEV *op : s->ops) result = get_mul(result, exit_value(op, loop));
+                return result;
+            }
+            default: return could_not_compute();
+        }
+    }
+
+    // 把 SCEV 的结果按循环打印出来（print-scev 使用）
+    void print(std::ostream &os) {
+        os << "SCEV for " << F.name << ":\n";
+        for (auto &loop : F.loops) {
+            os << "  loop " << loop->header->label << " (depth " << loop->depth
+               << "): backedge-taken count = " << backedge_taken_count(loop.get())->to_string()
+               << "\n";
+            for (auto &block : F.blocks) {
+                if (block->loop != loop.get()) continue;
+                for (auto &inst : block->insts) {
+                    if (!inst.result) continue;
+                    const SCEV *s = get(inst.result->name);
+                    if (s->kind == SCEVKind::Unknown) continue;
+                    os << "    " << inst.result->name << " = " << s->to_string();
+                    if (s->is_add_rec() && s->loop == loop.get()) {
+                        os << "  exit value " << exit_value(s, loop.get())->to_string();
+                    }
+                    os << "\n";
+                }
+            }
+        }
+    }
+};
+
+// 打印每个循环的回边执行次数和循环内寄存器的 SCEV（到标准错误），不修改 IR
+class PrintSCEVPass : public FunctionPass {
+  public:
+    const char *name() const override {
+        return "print-scev";
+    }
+
+    bool run(IRFunction &F) override {
+        ScalarEvolution se(F);
+        std::ostringstream os;
+        se.print(os);
+        trace_out() << os.str();
+        for (auto &loop : F.loops) {
+            if (!se.backedge_taken_count(loop.get())->could_not_compute()) {
+                add_stat("backedge-taken counts computed");
+            }
+        }
+        return false;
+    }
+};
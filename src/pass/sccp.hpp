@@ -2,12 +2,14 @@
 
 #include "ir.hpp"
 #include "pass.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <deque>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -87,7 +89,8 @@ class SCCPPass : public FunctionPass {
 
     IRFunction *current_function = nullptr;
 
-    bool ir_changed = false;
+    bool ir_changed = false;  // 格值/可达性是否有变化（分析阶段）
+    bool transformed = false; // 是否真正修改了 IR（作为 run 的返回值）
 
     // 获取操作数的格值
     LatticeValue get_operand_value(const IROperand &op) const {
@@ -150,23 +153,15 @@ class SCCPPass : public FunctionPass {
     void visit_inst(IRInstruction *inst) {
         // phi指令
         if (inst->op == IROp::PHI) {
-            std::cout << "Visiting PHI: " << inst->result->name << std::endl;
             LatticeValue phi_val{ LatticeStatus::UNKNOWN };
             for (size_t i = 0; i < inst->args.size(); i += 2) {
                 const auto &ir_operand = inst->args.at(i);
                 const auto &operand = inst->args.at(i + 1);
                 auto pred_block = current_function->label_to_block_map.at(operand.name);
-                std::cout << "  - Predecessor: " << operand.name << ", Executable: "
-                          << executable_blocks.contains(pred_block) << std::endl;
                 if (executable_blocks.contains(pred_block)) {
-                    auto val = get_operand_value(ir_operand);
-                    std::cout << "    - Value: " << to_string(val.status) << ", " << val.value
-                              << std::endl;
-                    phi_val = phi_val.meet(val);
+                    phi_val = phi_val.meet(get_operand_value(ir_operand));
                 }
             }
-            std::cout << "  - Result: " << to_string(phi_val.status) << ", " << phi_val.value
-                      << std::endl;
             set_value(inst, phi_val);
             return;
         }
@@ -204,7 +199,15 @@ class SCCPPass : public FunctionPass {
             set_value(inst, get_operand_value(inst->args.at(0)));
             return;
         }
-        // CALL, LOAD, GEP, INPUT 均视为 TOP
+        // 每条 ret 都返回同一个常量的函数（见调用图的摘要），调用结果就是这个常量
+        if (inst->op == IROp::CALL && inst->result) {
+            const FunctionSummary *s = current_function->callee_summary(*inst);
+            if (s && s->return_constant) {
+                set_value(inst, { LatticeStatus::CONST, *s->return_constant });
+                return;
+            }
+        }
+        // 其余的 CALL, LOAD, GEP, INPUT 均视为 TOP
         if (inst->result.has_value()) {
             set_value(inst, { LatticeStatus::NOT_CONST });
         }
@@ -290,6 +293,7 @@ class SCCPPass : public FunctionPass {
         block_worklist.clear();
         ssa_worklist.clear();
         ir_changed = false;
+        transformed = false;
 
         for (auto &para : current_function->params) {
             ssa_value_map.insert({ para.name, { LatticeStatus::NOT_CONST } });
@@ -303,6 +307,8 @@ class SCCPPass : public FunctionPass {
         std::unordered_set<IRInstruction *> inst_to_delete;
         std::vector<std::pair<IRInstruction *, IROp>> branch_inst_to_change;
         std::vector<std::pair<IRInstruction *, LatticeValue>> const_inst_to_replace;
+        // 结果是常量但有副作用的 CALL：保留调用，常量改由紧随其后的 move 定义
+        std::vector<std::tuple<IRBasicBlock *, IRInstruction *, LatticeValue>> call_results;
 
         // 遍历所有块
         for (auto &block_ptr : current_function->blocks) {
@@ -330,8 +336,13 @@ class SCCPPass : public FunctionPass {
                     if (inst.result && ssa_value_map.contains(inst.result->name)) {
                         if (LatticeValue val = ssa_value_map.at(inst.result->name);
                             val.is_const()) {
-                            // 标记这条指令替换为 'move const'
-                            const_inst_to_replace.emplace_back(&inst, val);
+                            const FunctionSummary *callee = current_function->callee_summary(inst);
+                            if (inst.op == IROp::CALL && !(callee && callee->is_pure())) {
+                                call_results.emplace_back(block, &inst, val);
+                            } else {
+                                // 标记这条指令替换为 'move const'
+                                const_inst_to_replace.emplace_back(&inst, val);
+                            }
                         }
                     }
 
@@ -380,9 +391,26 @@ class SCCPPass : public FunctionPass {
         // 替换常量指令
         for (const auto &[inst, val] : const_inst_to_replace) {
             if (inst_to_delete.count(inst)) continue; // 别替换一个要被删除的指令
+            if (inst->op == IROp::MOVE && inst->args.at(0).op_type == IROperandType::IMM &&
+                inst->args.at(0).imm_value == val.value) {
+                continue; // 之前已经折叠过
+            }
             IROperand imm = IROperand::create_imm(val.value, inst->result->type);
             inst->op = IROp::MOVE;
             inst->args = { imm };
+            add_stat("constants folded");
+            transformed = true;
+        }
+
+        for (const auto &[block, inst, val] : call_results) {
+            if (inst_to_delete.count(inst)) continue;
+            auto it = std::find_if(block->insts.begin(), block->insts.end(),
+                                   [inst](const IRInstruction &i) { return &i == inst; });
+            IROperand imm = IROperand::create_imm(val.value, inst->result->type);
+            block->insts.insert(std::next(it), IRInstruction(IROp::MOVE, { imm }, inst->result));
+            inst->result.reset();
+            add_stat("constants folded");
+            transformed = true;
         }
 
         // 转换分支
@@ -390,22 +418,29 @@ class SCCPPass : public FunctionPass {
             if (inst_to_delete.count(inst)) continue;
             inst->op = new_op;
             inst->args = { inst->args[0] }; // 只保留 label
+            add_stat("branches folded");
+            transformed = true;
         }
 
         // 执行删除
         if (!inst_to_delete.empty()) {
+            add_stat("instructions deleted", static_cast<long>(inst_to_delete.size()));
+            transformed = true;
             for (const auto &block : current_function->blocks) {
                 block->insts.remove_if([&](IRInstruction &inst) {
                     return inst_to_delete.count(&inst);
                 });
             }
         }
+        for (const auto &block : current_function->blocks) block->hoist_phis();
     }
 
   public:
-    bool run(IRFunction &F) override {
-        std::cout << "Running SCCP on function: " << F.name << std::endl;
+    const char *name() const override {
+        return "sccp";
+    }
 
+    bool run(IRFunction &F) override {
         if (F.blocks.empty()) return false;
 
         init(F);
@@ -416,7 +451,6 @@ class SCCPPass : public FunctionPass {
             while (!block_worklist.empty()) {
                 IRBasicBlock *block = block_worklist.front();
                 block_worklist.pop_front();
-                std::cout << "Visiting block: " << block->label << std::endl;
 
                 for (auto &inst : block->insts) {
                     if (inst.is_terminator() or inst.op == IROp::TEST) break;
@@ -439,6 +473,6 @@ class SCCPPass : public FunctionPass {
 
         transform_ir();
 
-        return ir_changed;
+        return transformed;
     }
 };
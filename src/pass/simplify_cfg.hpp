@@ -0,0 +1,302 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "pass/dom_analysis.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ========================================================
+// --- CFG 化简 ---
+// 反复做下面几种局部变换直到不动点，每次变换后重建 CFG 并删除不可达块：
+// 1. 分支折叠：末尾 br 之前跳到同一目标的条件跳转（以及不再被使用的 test）删除；
+// 2. 空块转发：只有一条 br 的块，把前驱的跳转直接改到它的目标；
+// 3. 块合并：只有一个前驱、且该前驱只有它一个后继的块并入前驱；
+// 4. 跳转穿透：块里只有 PHI 和 test / 分支，从某个前驱进来时条件已知，就让该前驱直接跳到结果块。
+// deSSA 把 PHI 拷贝放在前驱末尾、不拆关键边，因此改跳时不制造通向含 PHI 块的关键边。
+// ========================================================
+
+class SimplifyCFGPass : public FunctionPass {
+  private:
+    static IRInstruction *final_branch(IRBasicBlock *block) {
+        if (block->insts.empty() || block->insts.back().op != IROp::BR) return nullptr;
+        return &block->insts.back();
+    }
+
+    static bool has_terminator(const IRBasicBlock *block) {
+        if (block->insts.empty()) return false;
+        IROp op = block->insts.back().op;
+        return op == IROp::BR || op == IROp::RET;
+    }
+
+    static bool has_cond_branch(const IRBasicBlock *block) {
+        return std::any_of(block->insts.begin(), block->insts.end(),
+                           [](const IRInstruction &inst) { return inst.is_cond_b(); });
+    }
+
+    static std::vector<IRInstruction *> phis(IRBasicBlock *block) {
+        std::vector<IRInstruction *> out;
+        for (auto &inst : block->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            if (inst.op != IROp::PHI) break;
+            out.push_back(&inst);
+        }
+        return out;
+    }
+
+    static void replace_uses(IRFunction &F, const std::string &name, const IROperand &value) {
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                for (auto &arg : inst.args) {
+                    if (arg.op_type == IROperandType::REG && arg.name == name) arg = value;
+                }
+            }
+        }
+    }
+
+    // 把 block 里所有跳到 from 的分支改为跳到 to
+    static void retarget(IRBasicBlock *block, const std::string &from, const std::string &to) {
+        for (auto &inst : block->insts) {
+            if ((inst.op == IROp::BR || inst.is_cond_b()) && inst.args[0].name == from) {
+                inst.args[0] = IROperand::create_label(to);
+            }
+        }
+    }
+
+    // 前驱 pred 改为直接跳到 target 时，target 的 PHI 从 pred 进来的值与原来从 via 进来的相同
+    static void add_incoming(IRBasicBlock *target, const std::string &via,
+                             const std::string &pred) {
+        for (IRInstruction *phi : phis(target)) {
+            std::optional<IROperand> value = phi->incoming(via);
+            if (!value || phi->incoming(pred)) continue;
+            phi->args.push_back(*value);
+            phi->args.push_back(IROperand::create_label(pred));
+        }
+    }
+
+    // pred 改跳到 target 之后 target 的 PHI 是否仍然正确
+    static bool can_retarget(IRBasicBlock *pred, IRBasicBlock *via, IRBasicBlock *target) {
+        std::vector<IRInstruction *> target_phis = phis(target);
+        if (target_phis.empty()) return true;
+        if (pred->successors.size() != 1) return false; // 会成为通向 PHI 块的关键边
+        for (IRInstruction *phi : target_phis) {
+            if (!phi->incoming(via->label)) return false;
+        }
+        return std::find(target->predecessors.begin(), target->predecessors.end(), pred) ==
+               target->predecessors.end();
+    }
+
+    bool fold_branches(IRBasicBlock *block) {
+        IRInstruction *br = final_branch(block);
+        if (!br) return false;
+        bool changed = false;
+        auto it = std::prev(block->insts.end());
+        while (it != block->insts.begin()) {
+            auto prev = std::prev(it);
+            if (!prev->is_cond_b() || prev->args[0].name != br->args[0].name) break;
+            block->insts.erase(prev);
+            add_stat("branches folded");
+            changed = true;
+        }
+        // 后面（到下一条 test 之前）没有条件跳转读取标志的 test 是死的
+        for (auto test = block->insts.begin(); test != block->insts.end();) {
+            if (test->op != IROp::TEST) {
+                ++test;
+                continue;
+            }
+            bool used = false;
+            for (auto next = std::next(test); next != block->insts.end(); ++next) {
+                if (next->op == IROp::TEST) break;
+                if (next->is_cond_b()) {
+                    used = true;
+                    break;
+                }
+            }
+            if (used) {
+                ++test;
+                continue;
+            }
+            test = block->insts.erase(test);
+            changed = true;
+        }
+        return changed;
+    }
+
+    bool forward_empty(IRFunction &F, IRBasicBlock *block) {
+        if (block == F.blocks.front().get() || block->insts.size() != 2) return false;
+        if (block->insts.front().op != IROp::LABEL) return false;
+        IRInstruction *br = final_branch(block);
+        if (!br || block->successors.size() != 1) return false;
+        IRBasicBlock *target = block->successors.front();
+        if (target == block) return false;
+
+        bool changed = false;
+        for (IRBasicBlock *pred : std::vector(block->predecessors)) {
+            if (pred == block || !can_retarget(pred, block, target)) continue;
+            retarget(pred, block->label, target->label);
+            add_incoming(target, block->label, pred->label);
+            add_stat("empty blocks forwarded");
+            changed = true;
+        }
+        return changed;
+    }
+
+    bool merge_into_pred(IRFunction &F, IRBasicBlock *block) {
+        if (block == F.blocks.front().get() || block->predecessors.size() != 1) return false;
+        IRBasicBlock *pred = block->predecessors.front();
+        if (pred == block || pred->successors.size() != 1 || has_cond_branch(pred)) return false;
+        if (!final_branch(pred) || !has_terminator(block)) return false;
+
+        // 只有一个前驱时 PHI 就是那条入边上的值
+        for (IRInstruction *phi : phis(block)) {
+            std::optional<IROperand> value = phi->incoming(pred->label);
+            if (!value || phi->args.size() != 2) return false;
+        }
+        for (IRInstruction *phi : phis(block)) {
+            replace_uses(F, phi->result->name, phi->args[0]);
+        }
+
+        pred->insts.pop_back();
+        for (auto &inst : block->insts) {
+            if (inst.op == IROp::LABEL || inst.op == IROp::PHI) continue;
+            pred->insts.push_back(std::move(inst));
+        }
+        for (IRBasicBlock *succ : block->successors) {
+            for (IRInstruction *phi : phis(succ)) {
+                for (size_t i = 1; i < phi->args.size(); i += 2) {
+                    if (phi->args[i].name == block->label) {
+                        phi->args[i] = IROperand::create_label(pred->label);
+                    }
+                }
+            }
+        }
+        F.clear_loops();
+        F.clear_dominators();
+        std::erase_if(F.blocks, [&](const auto &b) { return b.get() == block; });
+        add_stat("blocks merged");
+        return true;
+    }
+
+    // 用从 pred 进来时 block 里 PHI 的值依次求 test 与分支，条件都已知时返回跳转目标
+    static std::optional<std::string> known_target(IRBasicBlock *block, IRBasicBlock *pred) {
+        std::unordered_map<std::string, IROperand> values;
+        for (IRInstruction *phi : phis(block)) {
+            std::optional<IROperand> value = phi->incoming(pred->label);
+            if (!value) return std::nullopt;
+            values.emplace(phi->result->name, *value);
+        }
+        auto resolve = [&](const IROperand &op) -> std::optional<int> {
+            if (op.op_type == IROperandType::IMM) return op.imm_value;
+            auto it = values.find(op.name);
+            if (op.op_type != IROperandType::REG || it == values.end()) return std::nullopt;
+            if (it->second.op_type != IROperandType::IMM) return std::nullopt;
+            return it->second.imm_value;
+        };
+
+        std::optional<int> lhs, rhs;
+        for (const auto &inst : block->insts) {
+            switch (inst.op) {
+                case IROp::LABEL:
+                case IROp::PHI: continue;
+                case IROp::TEST:
+                    lhs = resolve(inst.args[0]);
+                    rhs = resolve(inst.args[1]);
+                    if (!lhs || !rhs) return std::nullopt;
+                    continue;
+                case IROp::BR: return inst.args[0].name;
+                case IROp::BRZ:
+                case IROp::BRLT:
+                case IROp::BRGT: {
+                    if (!lhs || !rhs) return std::nullopt;
+                    bool taken = inst.op == IROp::BRZ    ? *lhs == *rhs
+                                 : inst.op == IROp::BRLT ? *lhs < *rhs
+                                                         : *lhs > *rhs;
+                    if (taken) return inst.args[0].name;
+                    continue;
+                }
+                default: return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool thread_jumps(IRFunction &F, IRBasicBlock *block) {
+        if (block == F.blocks.front().get() || !has_cond_branch(block)) return false;
+        std::vector<IRInstruction *> block_phis = phis(block);
+        if (block_phis.empty()) return false;
+
+        // 绕过 block 后它的 PHI 在别处就没有定义了，因此只允许 block 内部使用
+        for (auto &other : F.blocks) {
+            if (other.get() == block) continue;
+            for (const auto &inst : other->insts) {
+                for (const auto &arg : inst.args) {
+                    if (arg.op_type != IROperandType::REG) continue;
+                    for (IRInstruction *phi : block_phis) {
+                        if (phi->result->name == arg.name) return false;
+                    }
+                }
+            }
+        }
+
+        std::unordered_map<std::string, IRBasicBlock *> label_map;
+        for (IRBasicBlock *succ : block->successors) label_map[succ->label] = succ;
+        bool changed = false;
+        for (IRBasicBlock *pred : std::vector(block->predecessors)) {
+            if (pred == block) continue;
+            std::optional<std::string> label = known_target(block, pred);
+            if (!label || !label_map.contains(*label)) continue;
+            IRBasicBlock *target = label_map.at(*label);
+            if (target == block || !can_retarget(pred, block, target)) continue;
+            retarget(pred, block->label, target->label);
+            add_incoming(target, block->label, pred->label);
+            add_stat("jumps threaded");
+            changed = true;
+        }
+        return changed;
+    }
+
+  public:
+    // 落空（fall-through）进入下一块的块补上显式的 br，之后块的顺序可以随意改变
+    static bool make_fallthrough_explicit(IRFunction &F) {
+        bool changed = false;
+        for (size_t i = 0; i + 1 < F.blocks.size(); ++i) {
+            IRBasicBlock *block = F.blocks[i].get();
+            if (has_terminator(block)) continue;
+            block->insts.emplace_back(IROp::BR, std::vector{ IROperand::create_label(
+                                                    F.blocks[i + 1]->label) });
+            changed = true;
+        }
+        return changed;
+    }
+
+    const char *name() const override {
+        return "simplifycfg";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.blocks.empty()) return false;
+        bool changed = make_fallthrough_explicit(F);
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            BuildCFGPass{}.run(F);
+            changed |= DeadBlockEliminationPass{}.run(F);
+            for (size_t i = 0; i < F.blocks.size(); ++i) {
+                progress |= fold_branches(F.blocks[i].get());
+            }
+            // 下面的变换会改动边，做完一次就重建 CFG
+            for (size_t i = 0; i < F.blocks.size() && !progress; ++i) {
+                IRBasicBlock *block = F.blocks[i].get();
+                progress = forward_empty(F, block) || merge_into_pred(F, block) ||
+                           thread_jumps(F, block);
+            }
+            changed |= progress;
+        }
+        return changed;
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include "type.hpp"
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ========================================================
+// --- 聚合体标量替换（SROA） ---
+// 结构体 / 数组类型的 alloca 如果只通过常量下标的 GEP 访问到标量字段（或元素），
+// 并且地址没有逃逸（GEP 的结果只用作 LOAD 的地址、STORE 的目标或下一层常量 GEP 的基址），
+// 就把每个被访问到的标量位置拆成一个独立的标量 alloca，之后由 mem2reg 提升到寄存器。
+// ========================================================
+
+class SROAPass : public FunctionPass {
+  private:
+    // 一个指向聚合体内部的指针：从 alloca 出发的下标路径和它指向的类型
+    struct Access {
+        std::vector<int> path;
+        IRType *type;
+    };
+
+    // 指针的一次使用：指令与操作数下标
+    using Use = std::pair<IRInstruction *, size_t>;
+
+    std::unordered_map<std::string, std::vector<Use>> users;
+    std::unordered_map<std::string, int> def_count;
+
+    void collect_uses(IRFunction &F) {
+        users.clear();
+        def_count.clear();
+        for (auto &block : F.blocks) {
+            for (auto &inst : block->insts) {
+                if (inst.result) def_count[inst.result->name]++;
+                for (size_t i = 0; i < inst.args.size(); ++i) {
+                    if (inst.args[i].op_type == IROperandType::REG) {
+                        users[inst.args[i].name].emplace_back(&inst, i);
+                    }
+                }
+            }
+        }
+    }
+
+    // 常量下标的 GEP 在 base 的基础上走到哪里；下标不是常量、第一个下标不为 0 或越界时失败
+    static bool step(const Access &base, const IRInstruction &gep, Access &out) {
+        out.path = base.path;
+        out.type = base.type;
+        for (size_t i = 1; i < gep.args.size(); ++i) {
+            const IROperand &idx = gep.args[i];
+            if (idx.op_type != IROperandType::IMM) return false;
+            int k = idx.imm_value;
+            if (i == 1) {
+                if (k != 0) return false; // 越过了整个对象
+                continue;
+            }
+            if (out.type->is_struct()) {
+                if (k < 0 || k >= static_cast<int>(out.type->get_fields().size())) return false;
+                out.type = out.type->get_field_type_by_index(k);
+            } else if (out.type->is_array()) {
+                if (k < 0 || k >= out.type->get_array_size()) return false;
+                out.type = out.type->get_array_element_type();
+            } else {
+                return false;
+            }
+            out.path.push_back(k);
+        }
+        return true;
+    }
+
+    static bool is_aggregate(const IRType *type) {
+        return type->is_struct() || type->is_array();
+    }
+
+    /**
+     * @brief 从 alloca 出发沿常量 GEP 收集所有派生指针
+     * @return 地址逃逸或有非标量的 LOAD / STORE 时返回 false
+     */
+    bool collect_accesses(const std::string &root, IRType *type,
+                          std::map<std::string, Access> &ptrs) {
+        if (def_count[root] != 1) return false;
+        ptrs[root] = Access{ {}, type };
+        std::vector<std::string> work{ root };
+        while (!work.empty()) {
+            std::string ptr = work.back();
+            work.pop_back();
+            const Access access = ptrs.at(ptr);
+            for (auto [inst, i] : users[ptr]) {
+                if (inst->op == IROp::GEP && i == 0) {
+                    const std::string &res = inst->result->name;
+                    Access next;
+                    if (def_count[res] != 1 || !step(access, *inst, next)) return false;
+                    ptrs[res] = next;
+                    work.push_back(res);
+                    continue;
+                }
+                bool is_addr = (inst->op == IROp::LOAD && i == 0) ||
+                               (inst->op == IROp::STORE && i == 1);
+                if (!is_addr || is_aggregate(access.type)) return false;
+            }
+        }
+        return true;
+    }
+
+    void split(IRFunction &F, IRBasicBlock *block, std::list<IRInstruction>::iterator alloca_it,
+               const std::map<std::string, Access> &ptrs,
+               std::unordered_set<IRInstruction *> &to_delete) {
+        std::map<std::vector<int>, IROperand> slots;
+        auto insert_pos = std::next(alloca_it);
+        for (const auto &[ptr, access] : ptrs) {
+            for (auto [inst, i] : users[ptr]) {
+                if (inst->op == IROp::GEP) {
+                    to_delete.insert(inst);
+                    continue;
+                }
+                auto slot = slots.find(access.path);
+                if (slot == slots.end()) {
+                    IROperand reg = F.new_reg(IRType::get_pointer(access.type));
+                    block->insts.insert(insert_pos, IRInstruction(IROp::ALLOCA, {}, reg));
+                    slot = slots.emplace(access.path, reg).first;
+                    add_stat("scalar allocas created");
+                }
+                inst->args[i] = slot->second;
+            }
+        }
+        to_delete.insert(&*alloca_it);
+    }
+
+  public:
+    const char *name() const override {
+        return "sroa";
+    }
+
+    bool run(IRFunction &F) override {
+        collect_uses(F);
+        std::unordered_set<IRInstruction *> to_delete;
+        for (auto &block : F.blocks) {
+            for (auto it = block->insts.begin(); it != block->insts.end(); ++it) {
+                if (it->op != IROp::ALLOCA) continue;
+                IRType *type = it->result->type->get_pointee_type();
+                if (!is_aggregate(type)) continue;
+                std::map<std::string, Access> ptrs;
+                if (!collect_accesses(it->result->name, type, ptrs)) continue;
+                split(F, block.get(), it, ptrs, to_delete);
+                add_stat("aggregates split");
+            }
+        }
+        if (to_delete.empty()) return false;
+        for (auto &block : F.blocks) {
+            block->insts.remove_if([&](IRInstruction &inst) { return to_delete.contains(&inst); });
+        }
+        return true;
+    }
+};
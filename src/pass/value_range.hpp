@@ -0,0 +1,609 @@
+#pragma once
+
+#include "ir.hpp"
+#include "pass.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// ========================================================
+// --- 值域分析与相关值传播 ---
+// ValueRangeAnalysis 在 SSA 上传播整数区间 [lo, hi]：定义点按运算求区间，条件跳转的两条出边
+// 再用前面的 TEST 收窄比较的操作数（例如 brlt 的真边上 a <= b - 1）。区间按基本块分别保存，
+// 循环头多次变宽后直接放宽到 i32 边界（widening），到达不动点后再按逆后序重算几遍收窄。
+// CorrelatedValuePropagationPass 用结果折叠被前面的条件蕴含的分支、把取值唯一的寄存器换成常量，
+// 并化简乘除 0 / 1 / -1。
+// ========================================================
+
+struct ValueRange {
+    // 端点用 64 位保存，加减乘不会溢出；结果超出 i32 的一律放宽为全集（运行时会回绕）
+    int64_t lo = 1, hi = 0; // 默认是空区间，表示不可达
+
+    static ValueRange full() {
+        return { INT32_MIN, INT32_MAX };
+    }
+
+    static ValueRange constant(int64_t v) {
+        return { v, v };
+    }
+
+    // 超出 i32 的区间放宽为全集
+    static ValueRange make(int64_t lo, int64_t hi) {
+        if (lo > hi) return {};
+        if (lo < INT32_MIN || hi > INT32_MAX) return full();
+        return { lo, hi };
+    }
+
+    bool is_empty() const {
+        return lo > hi;
+    }
+
+    bool is_full() const {
+        return lo == INT32_MIN && hi == INT32_MAX;
+    }
+
+    bool is_constant() const {
+        return lo == hi;
+    }
+
+    bool is_constant(int64_t v) const {
+        return lo == v && hi == v;
+    }
+
+    bool contains(int64_t v) const {
+        return lo <= v && v <= hi;
+    }
+
+    bool operator==(const ValueRange &other) const {
+        if (is_empty() || other.is_empty()) return is_empty() == other.is_empty();
+        return lo == other.lo && hi == other.hi;
+    }
+
+    ValueRange join(const ValueRange &other) const {
+        if (is_empty()) return other;
+        if (other.is_empty()) return *this;
+        return { std::min(lo, other.lo), std::max(hi, other.hi) };
+    }
+
+    ValueRange intersect(int64_t l, int64_t h) const {
+        if (is_empty()) return {};
+        return { std::max(lo, l), std::min(hi, h) };
+    }
+
+    ValueRange intersect(const ValueRange &other) const {
+        return intersect(other.lo, other.hi);
+    }
+
+    // 端点继续增长的一侧直接放宽到边界，保证回边上的迭代有限步结束
+    ValueRange widen(const ValueRange &next) const {
+        if (is_empty()) return next;
+        if (next.is_empty()) return *this;
+        return { next.lo < lo ? INT32_MIN : lo, next.hi > hi ? INT32_MAX : hi };
+    }
+
+    std::string to_string() const {
+        if (is_empty()) return "empty";
+        if (is_full()) return "full";
+        if (is_constant()) return std::to_string(lo);
+        return "[" + std::to_string(lo) + ", " + std::to_string(hi) + "]";
+    }
+};
+
+inline ValueRange range_add(const ValueRange &a, const ValueRange &b) {
+    if (a.is_empty() || b.is_empty()) return {};
+    return ValueRange::make(a.lo + b.lo, a.hi + b.hi);
+}
+
+inline ValueRange range_sub(const ValueRange &a, const ValueRange &b) {
+    if (a.is_empty() || b.is_empty()) return {};
+    return ValueRange::make(a.lo - b.hi, a.hi - b.lo);
+}
+
+inline ValueRange range_mul(const ValueRange &a, const ValueRange &b) {
+    if (a.is_empty() || b.is_empty()) return {};
+    // |端点| < 2^31，乘积不超过 2^62
+    int64_t c[] = { a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+    return ValueRange::make(*std::min_element(c, c + 4), *std::max_element(c, c + 4));
+}
+
+// 除数可能为 0 时运行时行为由虚拟机决定，结果取全集；否则向零取整的商在四个角上取到极值
+inline ValueRange range_div(const ValueRange &a, const ValueRange &b) {
+    if (a.is_empty() || b.is_empty()) return {};
+    if (b.contains(0)) return ValueRange::full();
+    int64_t c[] = { a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi };
+    return ValueRange::make(*std::min_element(c, c + 4), *std::max_element(c, c + 4));
+}
+
+class ValueRangeAnalysis {
+  public:
+    // 条件跳转在不动点上两个方向是否可能发生
+    struct BranchFate {
+        bool taken = false;
+        bool fallthrough = false;
+    };
+
+  private:
+    // 某个程序点上已知的区间；没有记录的寄存器视为全集
+    using RangeMap = std::unordered_map<std::string, ValueRange>;
+    using Edge = std::pair<IRBasicBlock *, IRBasicBlock *>;
+
+    static constexpr int WIDEN_AFTER = 3;   // 循环头第几次变宽之后开始放宽
+    static constexpr int NARROW_ROUNDS = 2; // 不动点之后收窄的轮数
+
+    IRFunction &F;
+    std::unordered_map<std::string, IRBasicBlock *> label_map;
+    std::vector<IRBasicBlock *> rpo;
+    std::unordered_map<IRBasicBlock *, size_t> rpo_index;
+
+    std::unordered_map<IRBasicBlock *, RangeMap> block_in;
+    std::map<Edge, RangeMap> edge_out; // 只保存可行的边
+    std::unordered_map<IRBasicBlock *, int> visits;
+    std::unordered_set<IRBasicBlock *> loop_headers; // 有逆后序回边进入的块
+
+    std::unordered_map<std::string, ValueRange> def_range;
+    std::unordered_map<const IRInstruction *, std::vector<ValueRange>> use_ranges;
+    std::unordered_map<const IRInstruction *, BranchFate> fates;
+
+    static ValueRange lookup(const RangeMap &state, const IROperand &op) {
+        if (op.op_type == IROperandType::IMM) return ValueRange::constant(op.imm_value);
+        if (op.op_type != IROperandType::REG) return ValueRange::full();
+        auto it = state.find(op.name);
+        return it == state.end() ? ValueRange::full() : it->second;
+    }
+
+    void compute_rpo() {
+        std::unordered_set<IRBasicBlock *> seen{ F.blocks.front().get() };
+        std::vector<std::pair<IRBasicBlock *, size_t>> dfs{ { F.blocks.front().get(), 0 } };
+        while (!dfs.empty()) {
+            auto &[block, next] = dfs.back();
+            if (next == block->successors.size()) {
+                rpo.push_back(block);
+                dfs.pop_back();
+                continue;
+            }
+            IRBasicBlock *succ = block->successors[next++];
+            if (seen.insert(succ).second) dfs.push_back({ succ, 0 });
+        }
+        std::reverse(rpo.begin(), rpo.end());
+        for (size_t i = 0; i < rpo.size(); ++i) rpo_index[rpo[i]] = i;
+        for (IRBasicBlock *block : rpo) {
+            for (IRBasicBlock *succ : block->successors) {
+                if (rpo_index.at(succ) <= rpo_index.at(block)) loop_headers.insert(succ);
+            }
+        }
+    }
+
+    // 假设 test 的比较结果满足 (op, taken)，收窄 state 中两个操作数的区间；返回该路径是否可行
+    static bool refine(RangeMap &state, const IRInstruction &test, IROp op, bool taken) {
+        const IROperand &a = test.args[0], &b = test.args[1];
+        ValueRange ra = lookup(state, a), rb = lookup(state, b);
+        ValueRange na = ra, nb = rb;
+        // BRGT 与 BRLT 对称：交换两边按 BRLT 处理
+        bool swapped = op == IROp::BRGT;
+        const ValueRange &l = swapped ? rb : ra, &r = swapped ? ra : rb;
+
+        if (op == IROp::BRZ && taken) {
+            na = nb = ra.intersect(rb);
+        } else if (op == IROp::BRZ) {
+            auto exclude = [](const ValueRange &x, const ValueRange &c) {
+                if (!c.is_constant()) return x;
+                if (x.is_constant(c.lo)) return ValueRange{};
+                if (x.lo == c.lo) return ValueRange{ x.lo + 1, x.hi };
+                if (x.hi == c.lo) return ValueRange{ x.lo, x.hi - 1 };
+                return x;
+            };
+            na = exclude(ra, rb);
+            nb = exclude(rb, ra);
+        } else if (taken) {
+            na = l.intersect(INT32_MIN, r.hi - 1); // l < r
+            nb = r.intersect(l.lo + 1, INT32_MAX);
+        } else {
+            na = l.intersect(r.lo, INT32_MAX); // l >= r
+            nb = r.intersect(INT32_MIN, l.hi);
+        }
+        if (swapped) std::swap(na, nb);
+
+        if (na.is_empty() || nb.is_empty()) return false;
+        if (a.op_type == IROperandType::REG) state[a.name] = na;
+        if (b.op_type == IROperandType::REG) {
+            ValueRange &slot = state[b.name];
+            slot = a.op_type == IROperandType::REG && a.name == b.name ? na.intersect(nb) : nb;
+            if (slot.is_empty()) return false;
+        }
+        return true;
+    }
+
+    ValueRange transfer(const IRInstruction &inst, const RangeMap &state) const {
+        auto arg = [&](size_t i) { return lookup(state, inst.args[i]); };
+        switch (inst.op) {
+            case IROp::ADD: return range_add(arg(0), arg(1));
+            case IROp::SUB: return range_sub(arg(0), arg(1));
+            case IROp::MUL: return range_mul(arg(0), arg(1));
+            case IROp::DIV: return range_div(arg(0), arg(1));
+            case IROp::MOVE: return lookup(state, inst.args[0]);
+            case IROp::CALL: {
+                const FunctionSummary *s = F.callee_summary(inst);
+                if (s && s->return_constant) return ValueRange::constant(*s->return_constant);
+                return ValueRange::full();
+            }
+            default: return ValueRange::full();
+        }
+    }
+
+    // 汇合所有可行入边的状态；没有可行入边（块不可达）时返回 false
+    bool entry_state(IRBasicBlock *block, RangeMap &state) const {
+        if (block == F.blocks.front().get()) {
+            state.clear();
+            return true;
+        }
+        bool reached = false;
+        for (IRBasicBlock *pred : block->predecessors) {
+            auto it = edge_out.find({ pred, block });
+            if (it == edge_out.end()) continue;
+            if (!reached) {
+                state = it->second;
+                reached = true;
+                continue;
+            }
+            for (auto s = state.begin(); s != state.end();) {
+                auto other = it->second.find(s->first);
+                if (other == it->second.end()) {
+                    s = state.erase(s);
+                    continue;
+                }
+                s->second = s->second.join(other->second);
+                ++s;
+            }
+        }
+        if (!reached) return false;
+
+        // PHI 的区间取自各条可行入边上传入值的区间
+        for (auto &inst : block->insts) {
+            if (inst.op == IROp::LABEL) continue;
+            if (inst.op != IROp::PHI) break;
+            ValueRange r;
+            for (size_t i = 0; i < inst.args.size(); i += 2) {
+                auto pred = label_map.find(inst.args[i + 1].name);
+                if (pred == label_map.end()) continue;
+                auto it = edge_out.find({ pred->second, block });
+                if (it == edge_out.end()) continue;
+                r = r.join(lookup(it->second, inst.args[i]));
+            }
+            state[inst.result->name] = r;
+        }
+        return true;
+    }
+
+    // 用入口状态重新计算一个块，返回出边状态发生变化的后继
+    std::vector<IRBasicBlock *> visit(IRBasicBlock *block, bool widen) {
+        RangeMap state;
+        std::vector<IRBasicBlock *> changed;
+        std::map<IRBasicBlock *, RangeMap> out;
+        auto drop_edges = [&] {
+            for (IRBasicBlock *succ : block->successors) {
+                if (edge_out.erase({ block, succ })) changed.push_back(succ);
+            }
+        };
+
+        if (!entry_state(block, state)) {
+            block_in.erase(block);
+            drop_edges();
+            return changed;
+        }
+        auto old = block_in.find(block);
+        if (widen && old != block_in.end()) {
+            // 只在循环头放宽：循环体内的值由循环条件收窄，不会跟着放宽到溢出
+            if (loop_headers.contains(block) && ++visits[block] > WIDEN_AFTER) {
+                for (auto &[reg, range] : state) {
+                    auto prev = old->second.find(reg);
+                    if (prev != old->second.end()) range = prev->second.widen(range);
+                }
+            }
+            if (old->second == state) return changed;
+        }
+        block_in[block] = state;
+
+        const IRInstruction *last_test = nullptr;
+        bool feasible = true;
+        for (auto &inst : block->insts) {
+            fates.erase(&inst);
+        }
+        for (auto &inst : block->insts) {
+            if (!feasible) break;
+            if (inst.op == IROp::LABEL || inst.op == IROp::PHI) {
+                if (inst.op == IROp::PHI) def_range[inst.result->name] = state[inst.result->name];
+                continue;
+            }
+            auto &uses = use_ranges[&inst];
+            uses.clear();
+            for (const auto &arg : inst.args) uses.push_back(lookup(state, arg));
+
+            if (inst.op == IROp::TEST) {
+                last_test = &inst;
+                continue;
+            }
+            if (inst.op == IROp::RET) break;
+
+            auto target = inst.is_terminator() ? label_map.find(inst.args[0].name)
+                                               : label_map.end();
+            if (inst.op == IROp::BR) {
+                if (target != label_map.end()) {
+                    auto [it, inserted] = out.try_emplace(target->second, state);
+                    if (!inserted) it->second = join_states(it->second, state);
+                }
+                break;
+            }
+            if (inst.is_cond_b()) {
+                RangeMap taken = state;
+                BranchFate &fate = fates[&inst];
+                fate.taken = !last_test || refine(taken, *last_test, inst.op, true);
+                fate.fallthrough = !last_test || refine(state, *last_test, inst.op, false);
+                if (fate.taken && target != label_map.end()) {
+                    auto [it, inserted] = out.try_emplace(target->second, taken);
+                    if (!inserted) it->second = join_states(it->second, taken);
+                }
+                feasible = fate.fallthrough;
+                continue;
+            }
+
+            if (inst.result) {
+                ValueRange r = transfer(inst, state);
+                state[inst.result->name] = r;
+                def_range[inst.result->name] = r;
+            }
+        }
+
+        for (IRBasicBlock *succ : block->successors) {
+            auto it = out.find(succ);
+            if (it == out.end()) {
+                if (edge_out.erase({ block, succ })) changed.push_back(succ);
+                continue;
+            }
+            auto prev = edge_out.find({ block, succ });
+            if (prev != edge_out.end() && prev->second == it->second) continue;
+            edge_out[{ block, succ }] = std::move(it->second);
+            changed.push_back(succ);
+        }
+        return changed;
+    }
+
+    static RangeMap join_states(const RangeMap &a, const RangeMap &b) {
+        RangeMap result;
+        for (const auto &[reg, range] : a) {
+            auto it = b.find(reg);
+            if (it != b.end()) result[reg] = range.join(it->second);
+        }
+        return result;
+    }
+
+  public:
+    explicit ValueRangeAnalysis(IRFunction &func) : F(func) {
+        if (F.blocks.empty()) return;
+        for (auto &block : F.blocks) label_map[block->label] = block.get();
+        compute_rpo();
+
+        // 按逆后序编号做工作表，先处理靠前的块
+        std::set<size_t> worklist{ 0 };
+        while (!worklist.empty()) {
+            IRBasicBlock *block = rpo[*worklist.begin()];
+            worklist.erase(worklist.begin());
+            for (IRBasicBlock *succ : visit(block, true)) worklist.insert(rpo_index.at(succ));
+        }
+        for (int round = 0; round < NARROW_ROUNDS; ++round) {
+            for (IRBasicBlock *block : rpo) visit(block, false);
+        }
+    }
+
+    bool is_reachable(IRBasicBlock *block) const {
+        return block_in.contains(block);
+    }
+
+    // SSA 寄存器在定义点的区间（对所有使用都成立）
+    ValueRange range_of(const std::string &reg) const {
+        auto it = def_range.find(reg);
+        return it == def_range.end() ? ValueRange::full() : it->second;
+    }
+
+    // inst 的第 i 个操作数在 inst 处的区间，已经按支配它的条件收窄过
+    ValueRange operand_range(const IRInstruction &inst, size_t i) const {
+        auto it = use_ranges.find(&inst);
+        if (it == use_ranges.end() || i >= it->second.size()) return ValueRange::full();
+        return it->second[i];
+    }
+
+    BranchFate fate(const IRInstruction &branch) const {
+        auto it = fates.find(&branch);
+        return it == fates.end() ? BranchFate{ true, true } : it->second;
+    }
+
+    void print(std::ostream &os) const {
+        os << "Value ranges for function " << F.name << ":\n";
+        for (IRBasicBlock *block : rpo) {
+            if (!is_reachable(block)) continue;
+            os << block->label << ":\n";
+            for (const auto &inst : block->insts) {
+                if (inst.result && def_range.contains(inst.result->name)) {
+                    const std::string &reg = inst.result->name;
+                    os << "  " << reg << " = " << range_of(reg).to_string() << "\n";
+                }
+                if (!inst.is_cond_b() || !fates.contains(&inst)) continue;
+                BranchFate f = fate(inst);
+                if (f.taken && f.fallthrough) continue;
+                os << "  " << op_to_string(inst.op) << " " << inst.args[0].name << ": "
+                   << (f.taken ? "always taken" : "never taken") << "\n";
+            }
+        }
+        for (auto &block : F.blocks) {
+            if (!is_reachable(block.get())) os << block->label << ": unreachable\n";
+        }
+    }
+};
+
+class CorrelatedValuePropagationPass : public FunctionPass {
+  private:
+    bool changed = false;
+
+    void replace_with_move(IRInstruction &inst, IROperand value) {
+        inst.op = IROp::MOVE;
+        inst.args = { std::move(value) };
+        changed = true;
+    }
+
+    // 乘除 0 / 1 / -1：x*0 -> 0，x*1、x/1 -> x，x*-1、x/-1 -> 0-x
+    bool simplify_mul_div(IRInstruction &inst, const ValueRangeAnalysis &vra) {
+        if (inst.op != IROp::MUL && inst.op != IROp::DIV) return false;
+        for (size_t i = 0; i < 2; ++i) {
+            if (inst.op == IROp::DIV && i == 0) continue; // 被除数是 1 什么也说明不了
+            ValueRange r = vra.operand_range(inst, i);
+            IROperand other = inst.args[1 - i];
+            IRType *type = inst.result->type;
+            if (r.is_constant(0) && inst.op == IROp::MUL) {
+                replace_with_move(inst, IROperand::create_imm(0, type));
+            } else if (r.is_constant(1)) {
+                replace_with_move(inst, other);
+            } else if (r.is_constant(-1)) {
+                inst.op = IROp::SUB;
+                inst.args = { IROperand::create_imm(0, type), other };
+                changed = true;
+            } else {
+                continue;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // 一组 TEST 之后若已没有条件跳转使用它，就删掉
+    void remove_unused_tests(IRBasicBlock *block) {
+        auto last_test = block->insts.end();
+        bool used = false;
+        for (auto it = block->insts.begin(); it != block->insts.end();) {
+            auto next = std::next(it);
+            if (it->op == IROp::TEST || it->op == IROp::BR || it->op == IROp::RET) {
+                if (last_test != block->insts.end() && !used) {
+                    block->insts.erase(last_test);
+                    add_stat("instructions deleted");
+                    changed = true;
+                }
+                last_test = it->op == IROp::TEST ? it : block->insts.end();
+                used = false;
+            } else if (it->is_cond_b()) {
+                used = true;
+            }
+            it = next;
+        }
+    }
+
+  public:
+    const char *name() const override {
+        return "cvp";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.blocks.empty()) return false;
+        changed = false;
+        ValueRangeAnalysis vra(F);
+
+        for (auto &block : F.blocks) {
+            if (!vra.is_reachable(block.get())) {
+                // 不可达的块只留下标签，由 dead-block-elim 删除
+                long n = static_cast<long>(
+                    std::count_if(block->insts.begin(), block->insts.end(),
+                                  [](const IRInstruction &i) { return i.op != IROp::LABEL; }));
+                if (n == 0) continue;
+                block->insts.remove_if([](const IRInstruction &i) { return i.op != IROp::LABEL; });
+                add_stat("instructions deleted", n);
+                changed = true;
+                continue;
+            }
+
+            bool dead = false;
+            for (auto it = block->insts.begin(); it != block->insts.end();) {
+                IRInstruction &inst = *it;
+                if (dead) {
+                    it = block->insts.erase(it);
+                    add_stat("instructions deleted");
+                    continue;
+                }
+                if (inst.is_cond_b()) {
+                    auto fate = vra.fate(inst);
+                    if (fate.taken && fate.fallthrough) {
+                        ++it;
+                        continue;
+                    }
+                    add_stat("branches folded");
+                    changed = true;
+                    if (fate.fallthrough) {
+                        it = block->insts.erase(it); // 永远不会跳转
+                        continue;
+                    }
+                    inst.op = IROp::BR; // 总会跳转，后面的指令都死了
+                    inst.args = { inst.args[0] };
+                    dead = true;
+                    ++it;
+                    continue;
+                }
+                if (inst.op == IROp::BR || inst.op == IROp::RET) dead = true;
+
+                // 整个结果只有一个可能的值
+                bool foldable = inst.is_calc() || inst.op == IROp::PHI ||
+                                (inst.op == IROp::MOVE &&
+                                 inst.args[0].op_type == IROperandType::REG);
+                ValueRange r = inst.result ? vra.range_of(inst.result->name) : ValueRange::full();
+                if (foldable && r.is_constant()) {
+                    replace_with_move(inst, IROperand::create_imm(static_cast<int>(r.lo),
+                                                                  inst.result->type));
+                    add_stat("values replaced");
+                    ++it;
+                    continue;
+                }
+                if (simplify_mul_div(inst, vra)) {
+                    add_stat("mul/div simplified");
+                    ++it;
+                    continue;
+                }
+
+                // 在这里取值唯一的操作数换成立即数
+                if (inst.is_calc() || inst.op == IROp::TEST || inst.op == IROp::OUTPUT_I32 ||
+                    inst.op == IROp::OUTPUT_I8) {
+                    for (size_t i = 0; i < inst.args.size(); ++i) {
+                        IROperand &arg = inst.args[i];
+                        ValueRange use = vra.operand_range(inst, i);
+                        if (arg.op_type != IROperandType::REG || !use.is_constant()) continue;
+                        arg = IROperand::create_imm(static_cast<int>(use.lo), arg.type);
+                        add_stat("operands replaced");
+                        changed = true;
+                    }
+                }
+                ++it;
+            }
+            block->hoist_phis();
+            remove_unused_tests(block.get());
+        }
+        return changed;
+    }
+};
+
+// 打印每个可达块中 SSA 值的区间和能确定方向的分支（到标准错误），不修改 IR
+class PrintValueRangePass : public FunctionPass {
+  public:
+    const char *name() const override {
+        return "print-ranges";
+    }
+
+    bool run(IRFunction &F) override {
+        if (F.blocks.empty()) return false;
+        ValueRangeAnalysis vra(F);
+        std::ostringstream os;
+        vra.print(os);
+        trace_out() << os.str();
+        return false;
+    }
+};
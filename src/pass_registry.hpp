@@ -0,0 +1,268 @@
+// pass_registry.hpp
+#pragma once
+
+#include "pass.hpp"
+#include "pass/GVNPass.hpp"
+#include "pass/adce.hpp"
+#include "pass/alias_analysis.hpp"
+#include "pass/call_graph.hpp"
+#include "pass/deSSA.hpp"
+#include "pass/dom_analysis.hpp"
+#include "pass/lcm.hpp"
+#include "pass/licm.hpp"
+#include "pass/loop_analysis.hpp"
+#include "pass/loop_rotate.hpp"
+#include "pass/loop_unroll.hpp"
+#include "pass/loop_unswitch.hpp"
+#include "pass/lsr.hpp"
+#include "pass/mem2reg.hpp"
+#include "pass/memory_ssa.hpp"
+#include "pass/scalar_evolution.hpp"
+#include "pass/sccp.hpp"
+#include "pass/simplify_cfg.hpp"
+#include "pass/sroa.hpp"
+#include "pass/value_range.hpp"
+#include <cctype>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct PassInfo {
+    std::string name;
+    std::string description;
+    std::vector<std::string> requires_passes; // 运行前需要（重新）计算的分析，按顺序展开
+    FunctionPassFactory factory;
+};
+
+// Pass 注册表：把名字映射到工厂，并负责解析 -O 级别与 --passes 流水线字符串。
+//
+// 流水线语法：
+//   pipeline := [ elem { ',' elem } ]
+//   elem     := atom [ '*' [ N ] ]
+//   atom     := pass-name | '(' pipeline ')'
+// "(licm,sccp)*" 表示重复执行直到不再变化，"(licm,sccp)*3" 表示固定执行 3 次。
+// 每个 Pass 依赖的分析会自动插在它前面；用于代码生成时末尾总会追加 dessa 消去 PHI。
+class PassRegistry {
+  private:
+    std::vector<PassInfo> passes;
+
+    template <typename T>
+    void add(std::string name, std::string description, std::vector<std::string> requires_passes) {
+        passes.push_back(PassInfo{ std::move(name), std::move(description),
+                                   std::move(requires_passes),
+                                   []() { return std::make_unique<T>(); } });
+    }
+
+    PassRegistry() {
+        add<BuildCFGPass>("build-cfg", "build predecessor/successor edges", {});
+        add<DeadBlockEliminationPass>("dead-block-elim", "remove unreachable blocks",
+                                      { "build-cfg" });
+        add<DominatorTreePass>("domtree", "compute the dominator tree", { "dead-block-elim" });
+        add<DominanceFrontierPass>("domfrontier", "compute dominance frontiers", { "domtree" });
+        add<PostDominatorTreePass>("postdomtree", "compute the post-dominator tree",
+                                   { "dead-block-elim" });
+        add<ControlDependencePass>("controldeps", "compute the control-dependence graph",
+                                   { "postdomtree" });
+        add<LoopAnalysisPass>("loops", "compute the loop nesting forest and trip counts",
+                              { "domtree" });
+        add<LoopSimplifyPass>("loop-simplify", "give loops preheaders and dedicated exits",
+                              { "loops" });
+        add<PrintSCEVPass>("print-scev", "print scalar evolution of loop values to stderr",
+                           { "loops" });
+        add<PrintCallGraphPass>("print-callgraph",
+                                "print call graph nodes and side-effect summaries to stderr", {});
+        add<PrintAliasPass>("print-alias", "print alias results of memory accesses to stderr", {});
+        add<PrintMemorySSAPass>("print-memoryssa", "print memory SSA and load clobbers to stderr",
+                                { "domfrontier" });
+        add<DataFlowAnalysisPass>("dataflow", "build def-use chains", {});
+        add<SROAPass>("sroa", "split struct/array allocas accessed by constant indices", {});
+        add<Mem2RegPhiInsertionPass>("mem2reg", "promote allocas to SSA registers",
+                                     { "domfrontier", "dataflow" });
+        add<SCCPPass>("sccp", "sparse conditional constant propagation",
+                      { "dead-block-elim", "dataflow" });
+        add<CorrelatedValuePropagationPass>("cvp", "value ranges and correlated value propagation",
+                                            { "dead-block-elim" });
+        add<PrintValueRangePass>("print-ranges",
+                                 "print value ranges and implied branches to stderr",
+                                 { "dead-block-elim" });
+        add<SimplifyCFGPass>("simplifycfg",
+                             "merge blocks, forward empty blocks, fold and thread branches",
+                             { "dead-block-elim" });
+        add<ADCEPass>("adce", "aggressive dead code elimination",
+                      { "controldeps", "loops" });
+        add<GVNPass>("gvn", "global value numbering with memory-aware load elimination",
+                     { "domfrontier" });
+        add<LICMPass>("licm", "loop invariant code motion", { "loops", "dataflow" });
+        add<LoopRotatePass>("loop-rotate", "turn top-tested loops into guarded bottom-tested loops",
+                            { "loops" });
+        add<LoopUnswitchPass>("loop-unswitch", "hoist loop-invariant branches by cloning the loop",
+                              { "loops" });
+        add<LoopUnrollPass>("loop-unroll", "unroll small loops under a code size budget",
+                            { "loops" });
+        add<LoopStrengthReducePass>("lsr", "strength-reduce loop addresses to pointer induction",
+                                    { "loops" });
+        add<LazyCodeMotionPass>("lcm", "partial redundancy elimination by lazy code motion",
+                                { "dead-block-elim" });
+        add<DeSSAPass>("dessa", "replace PHIs with copies", { "dead-block-elim" });
+    }
+
+    // 先递归放入依赖，再放入 Pass 本身；同一次展开中每个分析只出现一次
+    void expand(const PassInfo &info, std::vector<PassPipelineEntry> &out,
+                std::unordered_set<std::string> &added) const {
+        for (const auto &dep : info.requires_passes) {
+            if (added.contains(dep)) continue;
+            expand(*lookup(dep), out, added);
+        }
+        added.insert(info.name);
+        out.push_back(PassPipelineEntry{ .factory = info.factory });
+    }
+
+    class Parser {
+      private:
+        const PassRegistry &registry;
+        const std::string &text;
+        size_t pos = 0;
+
+        [[noreturn]] void error(const std::string &msg) const {
+            throw std::runtime_error("invalid pass pipeline '" + text + "' at column " +
+                                     std::to_string(pos + 1) + ": " + msg);
+        }
+
+        void skip_space() {
+            while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        }
+
+        bool peek(char c) {
+            skip_space();
+            return pos < text.size() && text[pos] == c;
+        }
+
+        unsigned parse_count() {
+            size_t start = pos;
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) pos++;
+            if (start == pos) return 0; // 只有 '*'：迭代到不动点
+            unsigned n = static_cast<unsigned>(std::stoul(text.substr(start, pos - start)));
+            if (n == 0) error("repeat count must be positive");
+            return n;
+        }
+
+        void parse_elem(std::vector<PassPipelineEntry> &out) {
+            std::vector<PassPipelineEntry> atom;
+            if (peek('(')) {
+                pos++;
+                atom = parse_pipeline();
+                if (!peek(')')) error("expected ')'");
+                pos++;
+                if (atom.empty()) error("empty group");
+            } else {
+                size_t start = pos;
+                while (pos < text.size() &&
+                       (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-')) {
+                    pos++;
+                }
+                if (start == pos) error("expected a pass name");
+                std::string name = text.substr(start, pos - start);
+                const PassInfo *info = registry.lookup(name);
+                if (!info) {
+                    pos = start;
+                    error("unknown pass '" + name + "' (see -print-passes)");
+                }
+                std::unordered_set<std::string> added;
+                registry.expand(*info, atom, added);
+            }
+
+            if (!peek('*')) {
+                for (auto &entry : atom) out.push_back(std::move(entry));
+                return;
+            }
+            pos++;
+            out.push_back(PassPipelineEntry{ .group = std::move(atom), .repeat = parse_count() });
+        }
+
+      public:
+        Parser(const PassRegistry &r, const std::string &t) : registry(r), text(t) {}
+
+        std::vector<PassPipelineEntry> parse_pipeline() {
+            std::vector<PassPipelineEntry> out;
+            skip_space();
+            if (pos == text.size() || text[pos] == ')') return out;
+            parse_elem(out);
+            while (peek(',')) {
+                pos++;
+                parse_elem(out);
+            }
+            return out;
+        }
+
+        std::vector<PassPipelineEntry> parse() {
+            auto out = parse_pipeline();
+            skip_space();
+            if (pos != text.size()) error("unexpected '" + std::string(1, text[pos]) + "'");
+            return out;
+        }
+    };
+
+  public:
+    static const PassRegistry &instance() {
+        static const PassRegistry registry;
+        return registry;
+    }
+
+    const PassInfo *lookup(const std::string &name) const {
+        for (const auto &info : passes) {
+            if (info.name == name) return &info;
+        }
+        return nullptr;
+    }
+
+    // -O0 .. -O3 对应的流水线字符串
+    // -O3 目前与 -O2 相同：在测试程序上试过再跑一轮外提分支 / 展开（更慢）
+    // 和展开后再跑 LICM（周期不变），都没有收益
+    static std::string level_pipeline(unsigned level) {
+        switch (level) {
+            case 0: return "";
+            case 1: return "sroa,mem2reg,sccp,adce,simplifycfg";
+            case 2:
+            default:
+                return "sroa,mem2reg,sccp,simplifycfg,loop-rotate,(gvn,licm,cvp,sccp)*,"
+                       "loop-unswitch,simplifycfg,loop-unroll,simplifycfg,(gvn,cvp,sccp)*,"
+                       "lcm,lsr,adce,simplifycfg";
+        }
+    }
+
+    /**
+     * @brief 解析流水线字符串并展开依赖
+     * @param for_codegen 为 true 时在末尾追加代码生成前必需的 dessa（cyrilcc-opt 输出 SSA 时不需要）
+     * @throws std::runtime_error 语法错误或未知的 Pass 名
+     */
+    std::vector<PassPipelineEntry> parse(const std::string &text, bool for_codegen = true) const {
+        auto pipeline = Parser(*this, text).parse();
+        if (for_codegen) {
+            std::unordered_set<std::string> added;
+            expand(*lookup("dessa"), pipeline, added);
+        }
+        return pipeline;
+    }
+
+    // -print-passes
+    void print(std::ostream &os) const {
+        os << "Registered passes:\n";
+        for (const auto &info : passes) {
+            os << "  " << std::left << std::setw(18) << info.name << info.description;
+            if (!info.requires_passes.empty()) {
+                os << " (requires";
+                for (const auto &dep : info.requires_passes) os << " " << dep;
+                os << ")";
+            }
+            os << "\n";
+        }
+        os << "Optimization levels:\n";
+        for (unsigned level = 0; level <= 3; ++level) {
+            os << "  -O" << level << "  \"" << level_pipeline(level) << "\"\n";
+        }
+    }
+};
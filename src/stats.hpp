@@ -0,0 +1,206 @@
+// stats.hpp
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 分配统计，由 alloc_stats.cpp 中替换的全局 operator new/delete 维护
+namespace alloc_stats {
+size_t thread_alloc_count(); // 当前线程累计分配次数
+size_t thread_alloc_bytes(); // 当前线程累计分配字节
+size_t current_bytes();      // 进程当前堆占用
+size_t peak_bytes();         // 进程堆占用峰值
+} // namespace alloc_stats
+
+// 函数 IR 规模
+struct IRSize {
+    size_t insts = 0;
+    size_t blocks = 0;
+    size_t phis = 0;
+};
+
+// 一个阶段（前端阶段或某个 Pass 在某个函数上）的一次执行记录
+struct StageRecord {
+    std::string stage;
+    std::string func{}; // 前端阶段为空
+    double ms = 0;
+    size_t allocs = 0;
+    size_t alloc_bytes = 0;
+    size_t peak_bytes = 0; // 阶段结束时的进程堆峰值
+    bool has_ir = false;
+    IRSize before{}, after{};
+    std::map<std::string, long> counters{}; // Pass 自定义计数器
+};
+
+// 测量一个阶段的时间与分配，在同一线程里 start/stop
+class StageMeter {
+  private:
+    std::chrono::steady_clock::time_point t0;
+    size_t count0 = 0;
+    size_t bytes0 = 0;
+
+  public:
+    void start() {
+        count0 = alloc_stats::thread_alloc_count();
+        bytes0 = alloc_stats::thread_alloc_bytes();
+        t0 = std::chrono::steady_clock::now();
+    }
+
+    void stop(StageRecord &rec) const {
+        auto t1 = std::chrono::steady_clock::now();
+        rec.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        rec.allocs = alloc_stats::thread_alloc_count() - count0;
+        rec.alloc_bytes = alloc_stats::thread_alloc_bytes() - bytes0;
+        rec.peak_bytes = alloc_stats::peak_bytes();
+    }
+};
+
+// 编译统计报告：-ftime-report 打印时间/内存/IR 规模表，-stats 打印 Pass 计数器，
+// -report-json=<path> 输出逐阶段逐函数的完整记录
+class CompileReport {
+  private:
+    std::vector<StageRecord> records;
+    std::mutex records_mutex;
+
+    // 按阶段名聚合（保持第一次出现的顺序）
+    struct Summary {
+        std::string stage;
+        size_t runs = 0;
+        double ms = 0;
+        size_t allocs = 0;
+        size_t alloc_bytes = 0;
+        size_t peak_bytes = 0;
+        bool has_ir = false;
+        IRSize before{}, after{};
+        std::map<std::string, long> counters{};
+    };
+
+    std::vector<Summary> summarize() const {
+        std::vector<Summary> out;
+        std::map<std::string, size_t> index;
+        for (const auto &r : records) {
+            auto [it, inserted] = index.try_emplace(r.stage, out.size());
+            if (inserted) out.push_back(Summary{ .stage = r.stage });
+            Summary &s = out[it->second];
+            s.runs++;
+            s.ms += r.ms;
+            s.allocs += r.allocs;
+            s.alloc_bytes += r.alloc_bytes;
+            s.peak_bytes = std::max(s.peak_bytes, r.peak_bytes);
+            if (r.has_ir) {
+                s.has_ir = true;
+                s.before.insts += r.before.insts;
+                s.before.blocks += r.before.blocks;
+                s.before.phis += r.before.phis;
+                s.after.insts += r.after.insts;
+                s.after.blocks += r.after.blocks;
+                s.after.phis += r.after.phis;
+            }
+            for (const auto &[name, n] : r.counters) s.counters[name] += n;
+        }
+        return out;
+    }
+
+    static std::string json_escape(const std::string &s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    static std::string size_delta(size_t before, size_t after) {
+        return std::to_string(before) + "->" + std::to_string(after);
+    }
+
+  public:
+    void add(StageRecord rec) {
+        std::lock_guard<std::mutex> lock(records_mutex);
+        records.push_back(std::move(rec));
+    }
+
+    const std::vector<StageRecord> &get_records() const {
+        return records;
+    }
+
+    void print_time_report(std::ostream &os) const {
+        auto summary = summarize();
+        double total = 0;
+        for (const auto &s : summary) total += s.ms;
+
+        os << "===------------------------------------------------------------------------===\n";
+        os << "                         cyrilcc time / memory report\n";
+        os << "===------------------------------------------------------------------------===\n";
+        os << std::left << std::setw(18) << "Stage" << std::right << std::setw(6) << "Runs"
+           << std::setw(11) << "Time(ms)" << std::setw(7) << "%" << std::setw(9) << "Allocs"
+           << std::setw(11) << "AllocKB" << std::setw(9) << "PeakKB" << std::setw(13) << "Insts"
+           << std::setw(11) << "Blocks" << std::setw(9) << "PHIs" << "\n";
+        for (const auto &s : summary) {
+            std::ostringstream pct;
+            pct << std::fixed << std::setprecision(1) << (total > 0 ? s.ms * 100 / total : 0);
+            os << std::left << std::setw(18) << s.stage << std::right << std::setw(6) << s.runs
+               << std::setw(11) << std::fixed << std::setprecision(3) << s.ms << std::setw(7)
+               << pct.str() << std::setw(9) << s.allocs << std::setw(11)
+               << s.alloc_bytes / 1024 << std::setw(9) << s.peak_bytes / 1024;
+            if (s.has_ir) {
+                os << std::setw(13) << size_delta(s.before.insts, s.after.insts) << std::setw(11)
+                   << size_delta(s.before.blocks, s.after.blocks) << std::setw(9)
+                   << size_delta(s.before.phis, s.after.phis);
+            }
+            os << "\n";
+        }
+        os << std::left << std::setw(18) << "Total" << std::right << std::setw(6) << ""
+           << std::setw(11) << std::fixed << std::setprecision(3) << total << "\n";
+        os << "Peak heap: " << alloc_stats::peak_bytes() / 1024 << " KB\n";
+    }
+
+    void print_stats(std::ostream &os) const {
+        os << "===------------------------------------------------------------------------===\n";
+        os << "                          ... Statistics Collected ...\n";
+        os << "===------------------------------------------------------------------------===\n";
+        for (const auto &s : summarize()) {
+            for (const auto &[name, n] : s.counters) {
+                os << std::right << std::setw(8) << n << " " << s.stage << " - " << name << "\n";
+            }
+        }
+    }
+
+    void print_json(std::ostream &os) const {
+        os << "{\n  \"peak_heap_bytes\": " << alloc_stats::peak_bytes() << ",\n";
+        os << "  \"stages\": [";
+        for (size_t i = 0; i < records.size(); ++i) {
+            const auto &r = records[i];
+            os << (i ? ",\n" : "\n") << "    { \"stage\": \"" << json_escape(r.stage) << "\"";
+            if (!r.func.empty()) os << ", \"function\": \"" << json_escape(r.func) << "\"";
+            os << ", \"ms\": " << std::fixed << std::setprecision(6) << r.ms
+               << ", \"allocs\": " << r.allocs << ", \"alloc_bytes\": " << r.alloc_bytes
+               << ", \"peak_bytes\": " << r.peak_bytes;
+            if (r.has_ir) {
+                os << ", \"before\": { \"insts\": " << r.before.insts
+                   << ", \"blocks\": " << r.before.blocks << ", \"phis\": " << r.before.phis
+                   << " }, \"after\": { \"insts\": " << r.after.insts
+                   << ", \"blocks\": " << r.after.blocks << ", \"phis\": " << r.after.phis
+                   << " }";
+            }
+            if (!r.counters.empty()) {
+                os << ", \"counters\": {";
+                size_t k = 0;
+                for (const auto &[name, n] : r.counters) {
+                    os << (k++ ? ", " : " ") << "\"" << json_escape(name) << "\": " << n;
+                }
+                os << " }";
+            }
+            os << " }";
+        }
+        os << "\n  ]\n}\n";
+    }
+};
@@ -0,0 +1,66 @@
+// thread_pool.hpp
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 简单的固定大小线程池，只提供 parallel_for：
+// 任务按下标领取，结果由调用者写入各自下标的缓冲区，从而保证输出顺序确定。
+class ThreadPool {
+  private:
+    unsigned jobs;
+
+  public:
+    explicit ThreadPool(unsigned n) : jobs(n == 0 ? default_jobs() : n) {}
+
+    static unsigned default_jobs() {
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw == 0 ? 1 : hw;
+    }
+
+    unsigned size() const {
+        return jobs;
+    }
+
+    /**
+     * @brief 对 [0, n) 中的每个下标调用 fn，最多使用 jobs 个线程
+     * 任一任务抛出的第一个异常会在所有线程结束后重新抛出
+     */
+    void parallel_for(size_t n, const std::function<void(size_t)> &fn) {
+        if (n == 0) return;
+        size_t workers = std::min<size_t>(jobs, n);
+        if (workers <= 1) {
+            for (size_t i = 0; i < n; ++i) fn(i);
+            return;
+        }
+
+        std::atomic<size_t> next{ 0 };
+        std::exception_ptr first_error;
+        std::mutex error_mutex;
+
+        auto worker = [&]() {
+            for (size_t i = next++; i < n; i = next++) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!first_error) first_error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (size_t t = 1; t < workers; ++t) threads.emplace_back(worker);
+        worker(); // 当前线程也参与
+        for (auto &t : threads) t.join();
+
+        if (first_error) std::rethrow_exception(first_error);
+    }
+};
@@ -0,0 +1,70 @@
+// trace.hpp
+#pragma once
+
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+// IR 转储 / Pass 跟踪选项，默认全部关闭。
+// 只有在对应选项打开时才会格式化 IR，输出写到独立的 trace 流（默认 stderr）。
+struct TraceOptions {
+    bool print_ast = false;                     // -print-ast
+    bool print_ir = false;                      // -print-ir: 打印最终 IR
+    bool trace_passes = false;                  // -trace-passes: 打印 "Running <pass> on <func>"
+    bool print_after_all = false;               // -print-after-all
+    bool print_changed = false;                 // -print-changed: 只在 IR 发生变化时打印
+    bool print_liveness = false;                // -print-liveness: 汇编标签后注释活跃值与寄存器压力
+    std::unordered_set<std::string> print_after; // -print-after=<pass>[,<pass>...]
+    std::unordered_set<std::string> print_funcs; // -print-func=<name>[,<name>...]
+    std::ostream *os = &std::cerr;              // -trace-file=<path> 可重定向
+
+    // 是否需要在 Pass 之后观察 IR（决定是否需要格式化）
+    bool wants_ir_after(const std::string &pass_name) const {
+        return print_after_all || print_changed || print_after.contains(pass_name);
+    }
+
+    // 函数过滤：未指定 -print-func 时匹配所有函数，名字前的 '@' 可省略
+    bool matches_func(const std::string &func_name) const {
+        if (print_funcs.empty()) return true;
+        if (print_funcs.contains(func_name)) return true;
+        return func_name.starts_with("@") && print_funcs.contains(func_name.substr(1));
+    }
+
+    /**
+     * @brief 解析一个 trace 相关的命令行参数
+     * @return true 如果参数被识别
+     */
+    bool parse_arg(const std::string &arg) {
+        auto add_list = [](std::unordered_set<std::string> &set, const std::string &list) {
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t end = list.find(',', start);
+                if (end == std::string::npos) end = list.size();
+                if (end > start) set.insert(list.substr(start, end - start));
+                start = end + 1;
+            }
+        };
+
+        if (arg == "-print-ast") {
+            print_ast = true;
+        } else if (arg == "-print-ir") {
+            print_ir = true;
+        } else if (arg == "-trace-passes") {
+            trace_passes = true;
+        } else if (arg == "-print-after-all") {
+            print_after_all = true;
+        } else if (arg == "-print-changed") {
+            print_changed = true;
+        } else if (arg == "-print-liveness") {
+            print_liveness = true;
+        } else if (arg.starts_with("-print-after=")) {
+            add_list(print_after, arg.substr(std::string("-print-after=").size()));
+        } else if (arg.starts_with("-print-func=")) {
+            add_list(print_funcs, arg.substr(std::string("-print-func=").size()));
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
@@ -3,9 +3,9 @@
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
-#include <sys/_types/_ucontext.h>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -41,6 +41,18 @@ class IRType {
     // --- 静态缓存 ---
     static std::unordered_map<std::string, std::unique_ptr<IRType>> struct_cache;
 
+    // 按注册顺序记录结构体，打印 IR 时按此顺序输出定义（字段只会引用更早的结构体）
+    static std::vector<IRType *> &struct_order() {
+        static std::vector<IRType *> order;
+        return order;
+    }
+
+    // 所有类型缓存共用一把锁，并行 Pass / 代码生成时也能安全地创建派生类型
+    static std::mutex &cache_mutex() {
+        static std::mutex m;
+        return m;
+    }
+
     // --- 私有构造函数 ---
     explicit IRType(PrimitiveType pt) : kind(TypeKind::PRIMITIVE), prim_type(pt) {}
     explicit IRType(TypeKind k, IRType *base) : kind(k), base_type(base) {}
@@ -204,10 +216,10 @@ class IRType {
     // 持久化的，随便存指针
     static IRType *get_pointer(IRType *base) {
         static std::map<IRType *, std::unique_ptr<IRType>> cache;
-        if (auto it = cache.find(base); it != cache.end()) return it->second.get();
-        // IRType *t = new IRType(TypeKind::POINTER, base);
-        cache[base] = std::unique_ptr<IRType>(new IRType(TypeKind::POINTER, base));
-        return cache[base].get();
+        std::lock_guard<std::mutex> lock(cache_mutex());
+        auto &slot = cache[base];
+        if (!slot) slot = std::unique_ptr<IRType>(new IRType(TypeKind::POINTER, base));
+        return slot.get();
     }
 
     static IRType *get_char_ptr() {
@@ -216,12 +228,14 @@ class IRType {
 
     static IRType *get_array(IRType *base, size_t size) {
         static std::map<std::pair<IRType *, size_t>, std::unique_ptr<IRType>> cache;
-        if (auto it = cache.find({ base, size }); it != cache.end()) return it->second.get();
-        cache[{ base, size }] = std::unique_ptr<IRType>(new IRType(base, size));
-        return cache[{ base, size }].get();
+        std::lock_guard<std::mutex> lock(cache_mutex());
+        auto &slot = cache[{ base, size }];
+        if (!slot) slot = std::unique_ptr<IRType>(new IRType(base, size));
+        return slot.get();
     }
 
     static IRType *register_struct(std::string name, std::vector<StructField> fields) {
+        std::lock_guard<std::mutex> lock(cache_mutex());
         auto it = struct_cache.find(name);
         if (it != struct_cache.end()) {
             return it->second.get();
@@ -232,12 +246,19 @@ class IRType {
         }
         auto *t = new IRType(name, std::move(fields));
         struct_cache[name] = std::unique_ptr<IRType>(t);
+        struct_order().push_back(t);
         return t;
     }
 
     static IRType *get_struct(const std::string &name) {
+        std::lock_guard<std::mutex> lock(cache_mutex());
         auto it = struct_cache.find(name);
         if (it != struct_cache.end()) return it->second.get();
         throw std::runtime_error("Struct type not found: " + name);
     }
+
+    static std::vector<IRType *> get_structs() {
+        std::lock_guard<std::mutex> lock(cache_mutex());
+        return struct_order();
+    }
 };
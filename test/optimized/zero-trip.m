@@ -0,0 +1,32 @@
+main()
+{
+	int n,i,j,s,t;
+	input n;
+	s=0;
+	t=0;
+	for(j=0;j<30;j=j+1)
+	{
+		i=0;
+		while(i<n)
+		{
+			if(i>j)
+			{
+				s=s+i;
+			}
+			else
+			{
+				t=t+j;
+			}
+			i=i+1;
+		}
+		for(i=0;i<n;i=i+1)
+		{
+			s=s+t;
+		}
+		t=t+1;
+	}
+	output s;
+	output " ";
+	output t;
+	output "\n";
+}
@@ -0,0 +1,24 @@
+int g;
+
+main()
+{
+	int n,i;
+	input n;
+	g=5;
+	for(i=0;i<n;i=i+1)
+	{
+		g=g+1;
+		bump(i);
+	}
+	output g;
+	output "\n";
+}
+
+int bump(int k)
+{
+	if(k>3)
+	{
+		g=g+100;
+	}
+	return 0;
+}